@@ -75,7 +75,7 @@ AABB::AABB(std::vector<glm::vec3> &points) {
     depth = maxz - minz;
 }
 
-AABB::AABB(Triangle t, std::vector<glm::vec3> &vertices) {
+AABB::AABB(Triangle t, const std::vector<glm::vec3> &vertices) {
     glm::vec3 points[3] = { vertices[t.tri[0]],
                             vertices[t.tri[1]],
                             vertices[t.tri[2]] };
@@ -385,7 +385,7 @@ bool AABB::_axisTestZ0(glm::vec3 v0, glm::vec3 v1,
 
 // adapted from the method described in this paper: 
 // http://fileadmin.cs.lth.se/cs/Personal/Tomas_Akenine-Moller/pubs/tribox.pdf
-bool AABB::isOverlappingTriangle(Triangle t, std::vector<glm::vec3> &vertices) {
+bool AABB::isOverlappingTriangle(Triangle t, const std::vector<glm::vec3> &vertices) {
     glm::vec3 tv0 = vertices[t.tri[0]];
     glm::vec3 tv1 = vertices[t.tri[1]];
     glm::vec3 tv2 = vertices[t.tri[2]];
@@ -34,14 +34,14 @@ public:
     AABB(glm::vec3 p, double width, double height, double depth);
     AABB(glm::vec3 p1, glm::vec3 p2);
     AABB(std::vector<glm::vec3> &points);
-    AABB(Triangle t, std::vector<glm::vec3> &vertices);
+    AABB(Triangle t, const std::vector<glm::vec3> &vertices);
     AABB(GridIndex g, double dx);
     ~AABB();
 
     void expand(double v);
     bool isPointInside(glm::vec3 p);
     void getOverlappingGridCells(double dx, std::vector<GridIndex> &cells);
-    bool isOverlappingTriangle(Triangle t, std::vector<glm::vec3> &vertices);
+    bool isOverlappingTriangle(Triangle t, const std::vector<glm::vec3> &vertices);
     bool isLineIntersecting(glm::vec3 p1, glm::vec3 p2);
 
     glm::vec3 position;
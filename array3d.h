@@ -144,6 +144,24 @@ public:
         return _grid[_getFlatIndex(g)];;
     }
 
+    // Unchecked accessors for loops where the index is known to be
+    // in range. No out of range value is returned.
+    inline const T &get(int i, int j, int k) const {
+        return _grid[_getFlatIndex(i, j, k)];
+    }
+
+    inline const T &get(GridIndex g) const {
+        return _grid[_getFlatIndex(g)];
+    }
+
+    inline T &at(int i, int j, int k) {
+        return _grid[_getFlatIndex(i, j, k)];
+    }
+
+    inline T &at(GridIndex g) {
+        return _grid[_getFlatIndex(g)];
+    }
+
     void set(int i, int j, int k, T value) {
         assert(_isIndexInRange(i, j, k));
         _grid[_getFlatIndex(i, j, k)] = value;
@@ -194,6 +212,27 @@ public:
         return _grid;
     }
 
+    // Elements (0..width-1, j, k) of a row are contiguous. Rows are
+    // getRowStride() elements apart and slabs are getSlabStride()
+    // elements apart.
+    T *getRowPointer(int j, int k) {
+        assert(_isIndexInRange(0, j, k));
+        return &_grid[_getFlatIndex(0, j, k)];
+    }
+
+    T *getSlabPointer(int k) {
+        assert(_isIndexInRange(0, 0, k));
+        return &_grid[_getFlatIndex(0, 0, k)];
+    }
+
+    inline int getRowStride() const {
+        return width;
+    }
+
+    inline int getSlabStride() const {
+        return width*height;
+    }
+
     int getNumElements() {
         return width*height*depth;
     }
@@ -230,16 +269,16 @@ private:
         _grid = new T[width*height*depth];
     }
 
-    inline bool _isIndexInRange(int i, int j, int k) {
+    inline bool _isIndexInRange(int i, int j, int k) const {
         return i >= 0 && j >= 0 && k >= 0 && i < width && j < height && k < depth;
     }
 
-    inline unsigned int _getFlatIndex(int i, int j, int k) {
+    inline unsigned int _getFlatIndex(int i, int j, int k) const {
         return (unsigned int)i + (unsigned int)width *
                ((unsigned int)j + (unsigned int)height * (unsigned int)k);
     }
 
-    inline unsigned int _getFlatIndex(GridIndex g) {
+    inline unsigned int _getFlatIndex(GridIndex g) const {
         return (unsigned int)g.i + (unsigned int)width *
                ((unsigned int)g.j + (unsigned int)height * (unsigned int)g.k);
     }
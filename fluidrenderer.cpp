@@ -347,7 +347,7 @@ void FluidRenderer::drawBillboardTextures(GLuint tex, double width, Camera3d *ca
 }
 
 void FluidRenderer::drawSurfaceTriangles() {
-    TriangleMesh *surface = _fluidsim->getFluidSurfaceTriangles();
+    const TriangleMesh *surface = _fluidsim->getFluidSurfaceTriangles();
     LevelSet *levelset = _fluidsim->getLevelSet();
     MACVelocityField *vfield = _fluidsim->getVelocityField();
 
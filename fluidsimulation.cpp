@@ -47,6 +47,10 @@ FluidSimulation::~FluidSimulation() {
     for (unsigned int i = 0; i < _fluidSources.size(); i++) {
         delete[] _fluidSources[i];
     }
+
+    for (unsigned int i = 0; i < _kinematicSolidObjects.size(); i++) {
+        delete _kinematicSolidObjects[i];
+    }
 }
 
 /*******************************************************************************
@@ -149,6 +153,121 @@ void FluidSimulation::disableDiffuseMaterialOutput() {
     _isDiffuseMaterialOutputEnabled = false;
 }
 
+void FluidSimulation::enableAPICVelocityTransfer() {
+    if (!_isAPICVelocityTransferEnabled) {
+        _markerParticleAffine.assign(_markerParticles.size(), MarkerParticleAffine());
+    }
+    _isAPICVelocityTransferEnabled = true;
+}
+
+void FluidSimulation::disableAPICVelocityTransfer() {
+    _markerParticleAffine.clear();
+    _markerParticleAffine.shrink_to_fit();
+    _isAPICVelocityTransferEnabled = false;
+}
+
+void FluidSimulation::enableMarkerParticleReseeding() {
+    _isMarkerParticleReseedingEnabled = true;
+}
+
+void FluidSimulation::disableMarkerParticleReseeding() {
+    _isMarkerParticleReseedingEnabled = false;
+}
+
+void FluidSimulation::setMarkerParticleReseedingTarget(int n) {
+    assert(n > 0);
+    _reseedTargetParticlesPerCell = n;
+    _reseedMinParticlesPerCell = (int)fmax(1, n / 2);
+    _reseedMaxParticlesPerCell = 2*n;
+}
+
+void FluidSimulation::enableNarrowBandFLIP() {
+    _isNarrowBandFLIPEnabled = true;
+}
+
+void FluidSimulation::disableNarrowBandFLIP() {
+    _isNarrowBandFLIPEnabled = false;
+}
+
+void FluidSimulation::setNarrowBandWidth(double n) {
+    assert(n >= 1.0);
+    _narrowBandWidth = n;
+}
+
+void FluidSimulation::enableLevelSetFastMarching() {
+    _isLevelSetFastMarchingEnabled = true;
+}
+
+void FluidSimulation::disableLevelSetFastMarching() {
+    _isLevelSetFastMarchingEnabled = false;
+}
+
+void FluidSimulation::enableIncrementalLevelSet() {
+    _isIncrementalLevelSetEnabled = true;
+}
+
+void FluidSimulation::disableIncrementalLevelSet() {
+    _isIncrementalLevelSetEnabled = false;
+}
+
+void FluidSimulation::enableFastVelocityExtrapolation() {
+    _isFastVelocityExtrapolationEnabled = true;
+}
+
+void FluidSimulation::disableFastVelocityExtrapolation() {
+    _isFastVelocityExtrapolationEnabled = false;
+}
+
+void FluidSimulation::enableOutputSurfaceSlabPolygonization() {
+    _isOutputSurfaceSlabPolygonizationEnabled = true;
+}
+
+void FluidSimulation::enableOutputSurfaceSlabPolygonization(int slabDepth) {
+    assert(slabDepth >= 1);
+    _outputSurfaceSlabDepth = slabDepth;
+    _isOutputSurfaceSlabPolygonizationEnabled = true;
+}
+
+void FluidSimulation::disableOutputSurfaceSlabPolygonization() {
+    _isOutputSurfaceSlabPolygonizationEnabled = false;
+}
+
+void FluidSimulation::enableSurfaceMeshDecimation() {
+    _isSurfaceMeshDecimationEnabled = true;
+}
+
+void FluidSimulation::enableSurfaceMeshDecimation(double maxError) {
+    assert(maxError >= 0.0);
+    _surfaceMeshDecimationError = maxError;
+    _isSurfaceMeshDecimationEnabled = true;
+}
+
+void FluidSimulation::disableSurfaceMeshDecimation() {
+    _isSurfaceMeshDecimationEnabled = false;
+}
+
+void FluidSimulation::enableAdaptiveSurfacePolygonization() {
+    _isAdaptiveSurfacePolygonizationEnabled = true;
+}
+
+void FluidSimulation::enableAdaptiveSurfacePolygonization(double tolerance) {
+    assert(tolerance >= 0.0);
+    _adaptiveSurfacePolygonizationTolerance = tolerance;
+    _isAdaptiveSurfacePolygonizationEnabled = true;
+}
+
+void FluidSimulation::disableAdaptiveSurfacePolygonization() {
+    _isAdaptiveSurfacePolygonizationEnabled = false;
+}
+
+void FluidSimulation::enableParticleLevelSet() {
+    _isParticleLevelSetEnabled = true;
+}
+
+void FluidSimulation::disableParticleLevelSet() {
+    _isParticleLevelSetEnabled = false;
+}
+
 void FluidSimulation::enableBrickOutput() {
     AABB brick = AABB(glm::vec3(), _brickWidth, _brickHeight, _brickDepth);
     _fluidBrickGrid = FluidBrickGrid(_isize, _jsize, _ksize, _dx, brick);
@@ -361,6 +480,7 @@ void FluidSimulation::removeSolidCell(int i, int j, int k) {
 
     if (_isCellSolid(i, j, k)) {
         _materialGrid.set(i, j, k, M_AIR);
+        _updateNearSolidCellMasks(GridIndex(i, j, k));
     }
 }
 
@@ -400,6 +520,51 @@ std::vector<glm::vec3> FluidSimulation::getSolidCellPositions() {
     return indices;
 }
 
+KinematicSolidObject* FluidSimulation::addKinematicSolidObject(TriangleMesh mesh) {
+    KinematicSolidObject *obj = new KinematicSolidObject(mesh, _dx);
+    obj->setID(_getUniqueKinematicSolidObjectID());
+    _kinematicSolidObjects.push_back(obj);
+
+    if (!_isKinematicSolidInSimulation) {
+        _kinematicSolidCellCounts = Array3d<int>(_isize, _jsize, _ksize, 0);
+        _isNewKinematicSolidCell = Array3d<bool>(_isize, _jsize, _ksize, false);
+        _solidVelocity = MACVelocityField(_isize, _jsize, _ksize, _dx);
+        _isKinematicSolidInSimulation = true;
+    }
+
+    return obj;
+}
+
+KinematicSolidObject* FluidSimulation::addKinematicSolidObject(std::string OBJFilename, 
+                                                               double scale) {
+    TriangleMesh mesh;
+    bool success = mesh.loadOBJ(OBJFilename, scale);
+    assert(success);
+    mesh.weldVertices(_loadedMeshWeldTolerance*_dx);
+
+    return addKinematicSolidObject(mesh);
+}
+
+void FluidSimulation::removeKinematicSolidObject(KinematicSolidObject *obj) {
+    bool isFound = false;
+    for (unsigned int i = 0; i < _kinematicSolidObjects.size(); i++) {
+        if (obj->getID() == _kinematicSolidObjects[i]->getID()) {
+            std::vector<GridIndex> cells = obj->getSolidCells();
+            _removeKinematicSolidCells(cells);
+            for (unsigned int idx = 0; idx < cells.size(); idx++) {
+                _clearKinematicSolidCellFaceVelocities(cells[idx]);
+            }
+
+            delete (_kinematicSolidObjects[i]);
+            _kinematicSolidObjects.erase(_kinematicSolidObjects.begin() + i);
+            isFound = true;
+            break;
+        }
+    }
+
+    assert(isFound);
+}
+
 unsigned int FluidSimulation::getNumMarkerParticles() {
     return _markerParticles.size();
 }
@@ -442,8 +607,8 @@ LevelSet* FluidSimulation::getLevelSet() {
     return &_levelset; 
 };
 
-TriangleMesh* FluidSimulation::getFluidSurfaceTriangles() {
-    return &_surfaceMesh;
+const TriangleMesh* FluidSimulation::getFluidSurfaceTriangles() {
+    return _surfaceMesh.get();
 }
 
 /********************************************************************************
@@ -473,6 +638,32 @@ void FluidSimulation::_initializeSolidCells() {
     }
 }
 
+void FluidSimulation::_initializeNearSolidCellMasks() {
+    _nearSolidCellMasks = Array3d<int>(_isize, _jsize, _ksize, 0);
+
+    // cells outside of the grid are considered solid
+    int mask;
+    for (int k = 0; k < _ksize; k++) {
+        for (int j = 0; j < _jsize; j++) {
+            for (int i = 0; i < _isize; i++) {
+                mask = 0;
+                for (int dk = -1; dk <= 1; dk++) {
+                    for (int dj = -1; dj <= 1; dj++) {
+                        for (int di = -1; di <= 1; di++) {
+                            if (!Grid3d::isGridIndexInRange(i + di, j + dj, k + dk, 
+                                                            _isize, _jsize, _ksize) ||
+                                    _isCellSolid(i + di, j + dj, k + dk)) {
+                                mask |= _getNearSolidCellMaskBit(di, dj, dk);
+                            }
+                        }
+                    }
+                }
+                _nearSolidCellMasks.set(i, j, k, mask);
+            }
+        }
+    }
+}
+
 void FluidSimulation::_addMarkerParticlesToCell(GridIndex g) {
     _addMarkerParticlesToCell(g, glm::vec3(0.0, 0.0, 0.0));
 }
@@ -501,7 +692,7 @@ void FluidSimulation::_addMarkerParticlesToCell(GridIndex g, glm::vec3 velocity)
                                   _randomFloat(-jitter, jitter));
 
         glm::vec3 p = points[idx] + jit;
-        _markerParticles.push_back(MarkerParticle(p, velocity));
+        _addMarkerParticle(MarkerParticle(p, velocity));
     }
 }
 
@@ -543,20 +734,23 @@ void FluidSimulation::_getInitialFluidCellsFromImplicitSurface(std::vector<GridI
     fluidCells.clear();
 
     polygonizer.polygonizeSurface();
-    _surfaceMesh = polygonizer.getTriangleMesh();
-    _surfaceMesh.setGridDimensions(_isize, _jsize, _ksize, _dx);
-    _surfaceMesh.getCellsInsideMesh(fluidCells);
+    TriangleMesh mesh = polygonizer.takeTriangleMesh();
+    mesh.setGridDimensions(_isize, _jsize, _ksize, _dx);
+    mesh.getCellsInsideMesh(fluidCells);
+    _surfaceMesh = makeTriangleMeshSnapshot(std::move(mesh));
 }
 
 void FluidSimulation::_getInitialFluidCellsFromTriangleMesh(std::vector<GridIndex> &fluidCells) {
-    bool success = _surfaceMesh.loadOBJ(_fluidMeshFilename, _fluidMeshOffset, _fluidMeshScale);
+    TriangleMesh mesh;
+    bool success = mesh.loadOBJ(_fluidMeshFilename, _fluidMeshOffset, _fluidMeshScale);
     assert(success);
-    _surfaceMesh.setGridDimensions(_isize, _jsize, _ksize, _dx);
-    _surfaceMesh.getCellsInsideMesh(fluidCells);
+    mesh.weldVertices(_loadedMeshWeldTolerance*_dx);
+    mesh.setGridDimensions(_isize, _jsize, _ksize, _dx);
+    mesh.getCellsInsideMesh(fluidCells);
 
     LevelSetField field = LevelSetField(_isize, _jsize, _ksize, _dx);
     Polygonizer3d levelsetPolygonizer = Polygonizer3d(&field);
-    _levelset.setSurfaceMesh(_surfaceMesh);
+    _levelset.setSurfaceMesh(makeTriangleMeshSnapshot(std::move(mesh)));
     _levelset.calculateSignedDistanceField();
     field.setMaterialGrid(_materialGrid);
     field.setSignedDistanceField(_levelset.getSignedDistanceField());
@@ -564,9 +758,10 @@ void FluidSimulation::_getInitialFluidCellsFromTriangleMesh(std::vector<GridInde
     levelsetPolygonizer.polygonizeSurface();
 
     fluidCells.clear();
-    _surfaceMesh = levelsetPolygonizer.getTriangleMesh();
-    _surfaceMesh.setGridDimensions(_isize, _jsize, _ksize, _dx);
-    _surfaceMesh.getCellsInsideMesh(fluidCells);
+    mesh = levelsetPolygonizer.takeTriangleMesh();
+    mesh.setGridDimensions(_isize, _jsize, _ksize, _dx);
+    mesh.getCellsInsideMesh(fluidCells);
+    _surfaceMesh = makeTriangleMeshSnapshot(std::move(mesh));
 }
 
 void FluidSimulation::_initializeFluidMaterial() {
@@ -603,6 +798,8 @@ void FluidSimulation::_initializeFluidMaterial() {
 
 void FluidSimulation::_initializeSimulation() {
     _initializeSolidCells();
+    _initializeNearSolidCellMasks();
+    _updateKinematicSolidObjects(0.0);
     _initializeFluidMaterial();
 
     _isSimulationInitialized = true;
@@ -639,7 +836,7 @@ void FluidSimulation::_initializeMarkerParticlesFromSaveState(
     GridIndex g;
     for (unsigned int i = 0; i < positions.size(); i++) {
         p = positions[i];
-        _markerParticles.push_back(MarkerParticle(p));
+        _addMarkerParticle(MarkerParticle(p));
     }
     positions.clear();
     positions.shrink_to_fit();
@@ -674,6 +871,7 @@ void FluidSimulation::_initializeSimulationFromSaveState(FluidSimulationSaveStat
     _markerParticleRadius = pow(3*(_dx*_dx*_dx / 8.0) / (4*3.141592653), 1.0/3.0);
 
     _initializeSolidCellsFromSaveState(state);
+    _initializeNearSolidCellMasks();
     _initializeMarkerParticlesFromSaveState(state);
     _initializeFluidMaterialParticlesFromSaveState();
 
@@ -691,21 +889,34 @@ int FluidSimulation::_getUniqueFluidSourceID() {
     return id;
 }
 
+void FluidSimulation::_addMarkerParticle(MarkerParticle mp) {
+    _markerParticles.push_back(mp);
+    if (_isAPICVelocityTransferEnabled) {
+        _markerParticleAffine.push_back(MarkerParticleAffine());
+    }
+}
+
 void FluidSimulation::_removeMarkerParticlesFromCells(std::vector<GridIndex> &cells) {
-    std::vector<MarkerParticle> newv;
-    newv.reserve(_markerParticles.size());
+    Array3d<bool> isRemovedCell(_isize, _jsize, _ksize, false);
+    isRemovedCell.set(cells, true);
 
-    MarkerParticle p;
+    std::vector<bool> isRemoved(_markerParticles.size(), false);
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
-        if (!_isIndexInList(g, cells)) {
-            newv.push_back(p);
-        }
+        g = Grid3d::positionToGridIndex(_markerParticles[i].position, _dx);
+        isRemoved[i] = isRemovedCell(g);
     }
 
-    _markerParticles = newv;
+    _eraseMarkerParticles(isRemoved);
+    std::vector<GridIndex> freeCells;
+    freeCells.reserve(_particleFreeFluidCells.size());
+    for (unsigned int i = 0; i < _particleFreeFluidCells.size(); i++) {
+        g = _particleFreeFluidCells[i];
+        if (!isRemovedCell(g)) {
+            freeCells.push_back(g);
+        }
+    }
+    _particleFreeFluidCells = freeCells;
 }
 
 void FluidSimulation::_addNewFluidCells(std::vector<GridIndex> &cells, 
@@ -743,29 +954,518 @@ void FluidSimulation::_updateFluidSources() {
 void FluidSimulation::_updateFluidCells() {
     _updateFluidSources();
 
-    _materialGrid.set(_fluidCellIndices, M_AIR);
+    if (_isNarrowBandFLIPEnabled || !_particleFreeFluidCells.empty()) {
+        _updateNarrowBandParticles();
+    }
+
+    // fluid cells may have been taken over by a kinematic solid
+    GridIndex g;
+    for (unsigned int i = 0; i < _fluidCellIndices.size(); i++) {
+        g = _fluidCellIndices[i];
+        if (_isCellFluid(g)) {
+            _materialGrid.set(g, M_AIR);
+        }
+    }
     _fluidCellIndices.clear();
     
     MarkerParticle p;
-    GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
         p = _markerParticles[i];
         g = Grid3d::positionToGridIndex(p.position, _dx);
         assert(!_isCellSolid(g));
         _materialGrid.set(g, M_FLUID);
     }
+    _materialGrid.set(_particleFreeFluidCells, M_FLUID);
 
-    for (int k = 0; k < _materialGrid.depth; k++) {
-        for (int j = 0; j < _materialGrid.height; j++) {
-            for (int i = 0; i < _materialGrid.width; i++) {
-                if (_isCellFluid(i, j, k)) {
+    // surface cells are collected in the same pass so that the output
+    // surface reconstruction does not need to scan the domain
+    _surfaceCellIndices.clear();
+    int *row;
+    for (int k = 0; k < _ksize; k++) {
+        for (int j = 0; j < _jsize; j++) {
+            row = _materialGrid.getRowPointer(j, k);
+            for (int i = 0; i < _isize; i++) {
+                if (row[i] == M_FLUID) {
                     _fluidCellIndices.push_back(GridIndex(i, j, k));
+                    if (_isFluidSurfaceCell(i, j, k)) {
+                        _surfaceCellIndices.push_back(GridIndex(i, j, k));
+                    }
+                }
+            }
+        }
+    }
+    _isSurfaceCellBandOutdated = true;
+}
+
+bool FluidSimulation::_isFluidSurfaceCell(int i, int j, int k) {
+    return !_isCellFluid(i - 1, j, k) || !_isCellFluid(i + 1, j, k) ||
+           !_isCellFluid(i, j - 1, k) || !_isCellFluid(i, j + 1, k) ||
+           !_isCellFluid(i, j, k - 1) || !_isCellFluid(i, j, k + 1);
+}
+
+/********************************************************************************
+    RESEED MARKER PARTICLES
+********************************************************************************/
+
+bool FluidSimulation::_isCellInteriorFluid(GridIndex g) {
+    if (!_isCellFluid(g)) {
+        return false;
+    }
+
+    GridIndex nbs[6];
+    Grid3d::getNeighbourGridIndices6(g, nbs);
+    for (int i = 0; i < 6; i++) {
+        if (_isCellAir(nbs[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FluidSimulation::_reseedMarkerParticlesInCell(GridIndex g, int n) {
+    glm::vec3 gpos = Grid3d::GridIndexToPosition(g, _dx);
+
+    double eps = 10e-6;
+    MarkerParticle mp;
+    for (int i = 0; i < n; i++) {
+        mp.position = gpos + glm::vec3(_randomFloat(eps, _dx - eps),
+                                       _randomFloat(eps, _dx - eps),
+                                       _randomFloat(eps, _dx - eps));
+
+        if (_isAPICVelocityTransferEnabled) {
+            mp.velocity = _MACVelocity.evaluateVelocityAtPositionLinear(mp.position);
+            _markerParticles.push_back(mp);
+            _markerParticleAffine.push_back(_evaluateAffineVelocityAtPosition(mp.position));
+        } else {
+            mp.velocity = _MACVelocity.evaluateVelocityAtPosition(mp.position);
+            _markerParticles.push_back(mp);
+        }
+    }
+}
+
+void FluidSimulation::_removeMarkerParticlesFromOverSampledCells(Array3d<int> &countGrid) {
+    // Each over-sampled cell keeps a uniformly random selection
+    // of _reseedTargetParticlesPerCell particles
+    Array3d<int> keepGrid = Array3d<int>(_isize, _jsize, _ksize, -1);
+    GridIndex g;
+    for (unsigned int i = 0; i < _fluidCellIndices.size(); i++) {
+        g = _fluidCellIndices[i];
+        if (countGrid(g) > _reseedMaxParticlesPerCell) {
+            keepGrid.set(g, _reseedTargetParticlesPerCell);
+        }
+    }
+
+    std::vector<bool> isRemoved(_markerParticles.size(), false);
+    int remaining, needed;
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        g = Grid3d::positionToGridIndex(_markerParticles[i].position, _dx);
+
+        needed = keepGrid(g);
+        if (needed < 0) {
+            continue;
+        }
+
+        remaining = countGrid(g);
+        if (_randomFloat(0.0, remaining) < needed) {
+            keepGrid.set(g, needed - 1);
+        } else {
+            isRemoved[i] = true;
+        }
+        countGrid.set(g, remaining - 1);
+    }
+
+    _eraseMarkerParticles(isRemoved);
+}
+
+void FluidSimulation::_reseedMarkerParticles() {
+    Array3d<int> countGrid = Array3d<int>(_isize, _jsize, _ksize, 0);
+    GridIndex g;
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        g = Grid3d::positionToGridIndex(_markerParticles[i].position, _dx);
+        countGrid.add(g, 1);
+    }
+
+    // Particle-free narrow band cells are not under-sampled
+    countGrid.set(_particleFreeFluidCells, _reseedTargetParticlesPerCell);
+
+    // Cells on the fluid surface are not reseeded since they
+    // are only partially filled with fluid
+    std::vector<GridIndex> reseedCells;
+    bool isOverSampled = false;
+    int count;
+    for (unsigned int i = 0; i < _fluidCellIndices.size(); i++) {
+        g = _fluidCellIndices[i];
+        count = countGrid(g);
+        if (count > _reseedMaxParticlesPerCell) {
+            isOverSampled = true;
+        } else if (count < _reseedMinParticlesPerCell && _isCellInteriorFluid(g)) {
+            reseedCells.push_back(g);
+        }
+    }
+
+    int numReseedParticles = 0;
+    for (unsigned int i = 0; i < reseedCells.size(); i++) {
+        numReseedParticles += _reseedTargetParticlesPerCell - countGrid(reseedCells[i]);
+    }
+
+    if (isOverSampled) {
+        _removeMarkerParticlesFromOverSampledCells(countGrid);
+    }
+
+    _markerParticles.reserve(_markerParticles.size() + numReseedParticles);
+    for (unsigned int i = 0; i < reseedCells.size(); i++) {
+        g = reseedCells[i];
+        _reseedMarkerParticlesInCell(g, _reseedTargetParticlesPerCell - countGrid(g));
+    }
+}
+
+/********************************************************************************
+    NARROW BAND FLIP
+********************************************************************************/
+
+void FluidSimulation::_updateNarrowBandParticles() {
+    // Cells are classified using the level set of the previous time step.
+    // Fluid cells deeper than the band become particle-free.
+    Array3d<bool> isParticleFree(_isize, _jsize, _ksize, false);
+    std::vector<GridIndex> freeCells;
+    GridIndex g;
+    if (_isNarrowBandFLIPEnabled) {
+        // Level set distances are only calculated to a depth of
+        // _getNumLevelSetLayers() cells, which changes with the CFL number
+        double width = fmin(_narrowBandWidth, _getNumLevelSetLayers() - 1);
+        double depth = width*_dx;
+        double d;
+        for (unsigned int i = 0; i < _fluidCellIndices.size(); i++) {
+            g = _fluidCellIndices[i];
+            if (!_isCellFluid(g)) {
+                continue;
+            }
+
+            d = _levelset.getSignedDistance(g);
+            if (d > depth && !std::isinf(d)) {
+                isParticleFree.set(g, true);
+                freeCells.push_back(g);
+            }
+        }
+    }
+
+    // Cells that have come within the band of the surface are reseeded
+    // with particles sampled from the grid velocity field
+    for (unsigned int i = 0; i < _particleFreeFluidCells.size(); i++) {
+        g = _particleFreeFluidCells[i];
+        if (!isParticleFree(g) && !_isCellSolid(g)) {
+            _reseedMarkerParticlesInCell(g, _narrowBandReseedParticlesPerCell);
+        }
+    }
+    _particleFreeFluidCells = freeCells;
+
+    if (freeCells.empty()) {
+        return;
+    }
+
+    std::vector<bool> isRemoved(_markerParticles.size(), false);
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        g = Grid3d::positionToGridIndex(_markerParticles[i].position, _dx);
+        isRemoved[i] = isParticleFree(g);
+    }
+
+    _eraseMarkerParticles(isRemoved);
+}
+
+double FluidSimulation::_advectFaceVelocity(MACVelocityField &prevMACVelocity, 
+                                            glm::vec3 p, int dir, double dt) {
+    // Semi-Lagrangian backtrace using a midpoint step
+    glm::vec3 v1 = prevMACVelocity.evaluateVelocityAtPositionLinear(p);
+    glm::vec3 pmid = p - (float)(0.5*dt)*v1;
+    glm::vec3 v2 = prevMACVelocity.evaluateVelocityAtPositionLinear(pmid);
+    glm::vec3 p0 = p - (float)dt*v2;
+
+    glm::vec3 v;
+    if (Grid3d::isPositionInGrid(p0, _dx, _isize, _jsize, _ksize)) {
+        v = prevMACVelocity.evaluateVelocityAtPositionLinear(p0);
+    } else {
+        v = v1;
+    }
+
+    if (dir == 0) {
+        return v.x;
+    } else if (dir == 1) {
+        return v.y;
+    }
+    return v.z;
+}
+
+void FluidSimulation::_advectParticleFreeVelocities(MACVelocityField &prevMACVelocity, 
+                                                    double dt) {
+    Array3d<bool> isParticleFree(_isize, _jsize, _ksize, false);
+    isParticleFree.set(_particleFreeFluidCells, true);
+
+    // Faces shared by two particle-free cells are only updated once
+    GridIndex g;
+    glm::vec3 p;
+    double v;
+    for (unsigned int idx = 0; idx < _particleFreeFluidCells.size(); idx++) {
+        g = _particleFreeFluidCells[idx];
+        int i = g.i;
+        int j = g.j;
+        int k = g.k;
+
+        p = _MACVelocity.velocityIndexToPositionU(i, j, k);
+        v = _advectFaceVelocity(prevMACVelocity, p, 0, dt);
+        _MACVelocity.setU(i, j, k, v);
+        if (!isParticleFree(i + 1, j, k)) {
+            p = _MACVelocity.velocityIndexToPositionU(i + 1, j, k);
+            v = _advectFaceVelocity(prevMACVelocity, p, 0, dt);
+            _MACVelocity.setU(i + 1, j, k, v);
+        }
+
+        p = _MACVelocity.velocityIndexToPositionV(i, j, k);
+        v = _advectFaceVelocity(prevMACVelocity, p, 1, dt);
+        _MACVelocity.setV(i, j, k, v);
+        if (!isParticleFree(i, j + 1, k)) {
+            p = _MACVelocity.velocityIndexToPositionV(i, j + 1, k);
+            v = _advectFaceVelocity(prevMACVelocity, p, 1, dt);
+            _MACVelocity.setV(i, j + 1, k, v);
+        }
+
+        p = _MACVelocity.velocityIndexToPositionW(i, j, k);
+        v = _advectFaceVelocity(prevMACVelocity, p, 2, dt);
+        _MACVelocity.setW(i, j, k, v);
+        if (!isParticleFree(i, j, k + 1)) {
+            p = _MACVelocity.velocityIndexToPositionW(i, j, k + 1);
+            v = _advectFaceVelocity(prevMACVelocity, p, 2, dt);
+            _MACVelocity.setW(i, j, k + 1, v);
+        }
+    }
+}
+
+/********************************************************************************
+    UPDATE KINEMATIC SOLID OBJECTS
+********************************************************************************/
+
+int FluidSimulation::_getUniqueKinematicSolidObjectID() {
+    int id = _uniqueKinematicSolidObjectID;
+    _uniqueKinematicSolidObjectID++;
+    return id;
+}
+
+void FluidSimulation::_addKinematicSolidCells(std::vector<GridIndex> &cells) {
+    GridIndex g;
+    int count;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        if (Grid3d::isGridIndexOnBorder(g, _isize, _jsize, _ksize)) {
+            continue;
+        }
+
+        // static solid cells are never claimed by a kinematic object
+        count = _kinematicSolidCellCounts(g);
+        if (count == 0 && _isCellSolid(g)) {
+            continue;
+        }
+
+        if (count == 0) {
+            _materialGrid.set(g, M_SOLID);
+            _updateNearSolidCellMasks(g);
+        }
+        _kinematicSolidCellCounts.set(g, count + 1);
+    }
+}
+
+void FluidSimulation::_removeKinematicSolidCells(std::vector<GridIndex> &cells) {
+    GridIndex g;
+    int count;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        if (Grid3d::isGridIndexOnBorder(g, _isize, _jsize, _ksize)) {
+            continue;
+        }
+
+        count = _kinematicSolidCellCounts(g);
+        if (count == 0) {
+            continue;
+        }
+
+        count--;
+        _kinematicSolidCellCounts.set(g, count);
+        if (count == 0) {
+            _materialGrid.set(g, M_AIR);
+            _updateNearSolidCellMasks(g);
+        }
+    }
+}
+
+void FluidSimulation::_updateNearSolidCellMasks(GridIndex g) {
+    if (_nearSolidCellMasks.width == 0) {
+        return;
+    }
+
+    // The bit for cell g is stored in the masks of its 26 neighbours
+    // at the offset of g relative to the neighbour
+    bool isSolid = _isCellSolid(g);
+    int bit, mask;
+    GridIndex n;
+    for (int dk = -1; dk <= 1; dk++) {
+        for (int dj = -1; dj <= 1; dj++) {
+            for (int di = -1; di <= 1; di++) {
+                n = GridIndex(g.i - di, g.j - dj, g.k - dk);
+                if (!Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize)) {
+                    continue;
                 }
+
+                bit = _getNearSolidCellMaskBit(di, dj, dk);
+                mask = _nearSolidCellMasks(n);
+                _nearSolidCellMasks.set(n, isSolid ? (mask | bit) : (mask & ~bit));
             }
         }
     }
 }
 
+void FluidSimulation::_setKinematicSolidCellFaceVelocities(GridIndex g, 
+                                                           KinematicSolidObject *obj,
+                                                           double dt) {
+    int i = g.i; int j = g.j; int k = g.k;
+    glm::vec3 v;
+
+    v = obj->getVelocityAtPosition(_solidVelocity.velocityIndexToPositionU(i, j, k), dt);
+    _solidVelocity.setU(i, j, k, v.x);
+    v = obj->getVelocityAtPosition(_solidVelocity.velocityIndexToPositionU(i + 1, j, k), dt);
+    _solidVelocity.setU(i + 1, j, k, v.x);
+
+    v = obj->getVelocityAtPosition(_solidVelocity.velocityIndexToPositionV(i, j, k), dt);
+    _solidVelocity.setV(i, j, k, v.y);
+    v = obj->getVelocityAtPosition(_solidVelocity.velocityIndexToPositionV(i, j + 1, k), dt);
+    _solidVelocity.setV(i, j + 1, k, v.y);
+
+    v = obj->getVelocityAtPosition(_solidVelocity.velocityIndexToPositionW(i, j, k), dt);
+    _solidVelocity.setW(i, j, k, v.z);
+    v = obj->getVelocityAtPosition(_solidVelocity.velocityIndexToPositionW(i, j, k + 1), dt);
+    _solidVelocity.setW(i, j, k + 1, v.z);
+}
+
+bool FluidSimulation::_isCellKinematicSolid(int i, int j, int k) {
+    return Grid3d::isGridIndexInRange(i, j, k, _isize, _jsize, _ksize) &&
+           _kinematicSolidCellCounts(i, j, k) > 0;
+}
+
+void FluidSimulation::_clearKinematicSolidCellFaceVelocities(GridIndex g) {
+    int i = g.i; int j = g.j; int k = g.k;
+    if (_isCellKinematicSolid(i, j, k)) {
+        return;
+    }
+
+    // A face shared with a cell that is still covered by an object keeps 
+    // that object's velocity
+    if (!_isCellKinematicSolid(i - 1, j, k)) { _solidVelocity.setU(i, j, k, 0.0); }
+    if (!_isCellKinematicSolid(i + 1, j, k)) { _solidVelocity.setU(i + 1, j, k, 0.0); }
+    if (!_isCellKinematicSolid(i, j - 1, k)) { _solidVelocity.setV(i, j, k, 0.0); }
+    if (!_isCellKinematicSolid(i, j + 1, k)) { _solidVelocity.setV(i, j + 1, k, 0.0); }
+    if (!_isCellKinematicSolid(i, j, k - 1)) { _solidVelocity.setW(i, j, k, 0.0); }
+    if (!_isCellKinematicSolid(i, j, k + 1)) { _solidVelocity.setW(i, j, k + 1, 0.0); }
+}
+
+void FluidSimulation::_updateKinematicSolidVelocities(KinematicSolidObject *obj,
+                                                      std::vector<GridIndex> &removedCells,
+                                                      double dt) {
+    for (unsigned int i = 0; i < removedCells.size(); i++) {
+        _clearKinematicSolidCellFaceVelocities(removedCells[i]);
+    }
+
+    if (!obj->isVelocityChanged()) {
+        return;
+    }
+
+    std::vector<GridIndex> cells = obj->getSolidCells();
+    GridIndex g;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        if (_kinematicSolidCellCounts(g) > 0) {
+            _setKinematicSolidCellFaceVelocities(g, obj, dt);
+        }
+    }
+}
+
+void FluidSimulation::_displaceMarkerParticlesFromKinematicSolids(
+                                        std::vector<GridIndex> &addedCells, double dt) {
+    // Marker particles overtaken by a solid are carried along with the
+    // solid's motion. Particles that remain inside the solid are removed.
+    // Only particles in cells that became solid this step are moved.
+    GridIndex g;
+    for (unsigned int i = 0; i < addedCells.size(); i++) {
+        g = addedCells[i];
+        if (_isCellKinematicSolid(g.i, g.j, g.k)) {
+            _isNewKinematicSolidCell.set(g, true);
+        }
+    }
+
+    std::vector<bool> isRemoved(_markerParticles.size(), false);
+    MarkerParticle p;
+    glm::vec3 v;
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        p = _markerParticles[i];
+        g = Grid3d::positionToGridIndex(p.position, _dx);
+        if (!_isNewKinematicSolidCell(g)) {
+            continue;
+        }
+
+        v = _solidVelocity.evaluateVelocityAtPositionLinear(p.position);
+        p.position += v * (float)dt;
+        g = Grid3d::positionToGridIndex(p.position, _dx);
+        if (_isCellSolid(g)) {
+            isRemoved[i] = true;
+            continue;
+        }
+
+        p.velocity = v;
+        _markerParticles[i] = p;
+    }
+
+    _eraseMarkerParticles(isRemoved);
+
+    for (unsigned int i = 0; i < addedCells.size(); i++) {
+        g = addedCells[i];
+        if (_isCellKinematicSolid(g.i, g.j, g.k)) {
+            _isNewKinematicSolidCell.set(g, false);
+        }
+    }
+}
+
+void FluidSimulation::_updateKinematicSolidObjects(double dt) {
+    if (_kinematicSolidObjects.size() == 0) {
+        return;
+    }
+
+    // objects reach their target pose at the end of the frame
+    double fraction = 1.0;
+    if (dt + _frameTimeLeft > 0.0) {
+        fraction = dt / (dt + _frameTimeLeft);
+    }
+
+    std::vector<GridIndex> addedCells;
+    std::vector<GridIndex> removedCells;
+    std::vector<GridIndex> newSolidCells;
+    KinematicSolidObject *obj;
+    for (unsigned int i = 0; i < _kinematicSolidObjects.size(); i++) {
+        obj = _kinematicSolidObjects[i];
+        obj->advance(fraction);
+
+        addedCells.clear();
+        removedCells.clear();
+        obj->getSolidCellDelta(_isize, _jsize, _ksize, addedCells, removedCells);
+
+        _removeKinematicSolidCells(removedCells);
+        _addKinematicSolidCells(addedCells);
+        _updateKinematicSolidVelocities(obj, removedCells, dt);
+
+        newSolidCells.insert(newSolidCells.end(), addedCells.begin(), addedCells.end());
+    }
+
+    if (newSolidCells.size() > 0 && _markerParticles.size() > 0) {
+        _displaceMarkerParticlesFromKinematicSolids(newSolidCells, dt);
+    }
+}
+
 /********************************************************************************
     FLUID SURFACE RECONSTRUCTION
 ********************************************************************************/
@@ -775,39 +1475,109 @@ TriangleMesh FluidSimulation::_polygonizeSurface() {
                                                                   _jsize + 1, 
                                                                   _ksize + 1, _dx);
     field.setMaterialGrid(_materialGrid);
+    field.enableSurfaceCellDetection();
 
     double r = _markerParticleRadius*_markerParticleScale;
     field.setPointRadius(r);
 
+    // Particle-free cells are filled so that all 8 cell vertices
+    // are inside of the surface. These are added before the particles
+    // so that the surface cells found during the splat account for them.
     glm::vec3 p;
+    double eps = 10e-6;
+    double w = _dx + 2*eps;
+    glm::vec3 offset = glm::vec3(eps, eps, eps);
+    for (unsigned int i = 0; i < _particleFreeFluidCells.size(); i++) {
+        p = Grid3d::GridIndexToPosition(_particleFreeFluidCells[i], _dx);
+        field.addCuboid(p - offset, w, w, w);
+    }
+
+    std::vector<glm::vec3> points;
+    points.reserve(_markerParticles.size());
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i].position;
-        field.addPoint(p);
+        points.push_back(_markerParticles[i].position);
     }
+    field.addPoints(points);
+
+    std::vector<GridIndex> surfaceCells;
+    field.getSurfaceCells(surfaceCells);
 
     Polygonizer3d polygonizer = Polygonizer3d(field);
-    polygonizer.setInsideCellIndices(_fluidCellIndices);
+    polygonizer.setSurfaceCells(surfaceCells);
+    if (_isAdaptiveSurfacePolygonizationEnabled) {
+        polygonizer.enableAdaptivePolygonization(_adaptiveSurfacePolygonizationTolerance);
+    }
 
     polygonizer.polygonizeSurface();
-    return polygonizer.getTriangleMesh();
+    return polygonizer.takeTriangleMesh();
 }
 
 void FluidSimulation::_reconstructFluidSurface() {
-    _surfaceMesh = _polygonizeSurface();
+    _surfaceMesh = makeTriangleMeshSnapshot(_polygonizeSurface());
+}
+
+bool FluidSimulation::_isParticleLevelSetInUse() {
+    return _isParticleLevelSetEnabled;
+}
+
+bool FluidSimulation::_isFluidSurfaceMeshRequired() {
+    if (!_isParticleLevelSetInUse()) {
+        return true;
+    }
+
+    // Output meshes without subdivision are taken from the fluid surface mesh
+    return _isLastTimeStepForFrame && _isSurfaceMeshOutputEnabled && 
+           _outputFluidSurfaceSubdivisionLevel == 1;
 }
 
 /********************************************************************************
     UPDATE LEVEL SET
 ********************************************************************************/
 
-void FluidSimulation::_updateLevelSetSignedDistance() {
-    _levelset.setSurfaceMesh(_surfaceMesh);
+void FluidSimulation::_updateLevelSetSignedDistanceFromParticles(int numLayers) {
+    std::vector<glm::vec3> points;
+    points.reserve(_markerParticles.size() + _particleFreeFluidCells.size());
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        points.push_back(_markerParticles[i].position);
+    }
+
+    // Particle-free narrow band cells are represented by their cell centers
+    for (unsigned int i = 0; i < _particleFreeFluidCells.size(); i++) {
+        points.push_back(Grid3d::GridIndexToCellCenter(_particleFreeFluidCells[i], _dx));
+    }
 
+    double r = _markerParticleRadius*_markerParticleScale;
+    _levelset.calculateSignedDistanceField(points, r, numLayers);
+}
+
+int FluidSimulation::_getNumLevelSetLayers() {
+    return (int)ceil(_CFLConditionNumber) + 3;
+}
+
+void FluidSimulation::_updateLevelSetSignedDistance() {
     // Velocities are extrapolated to (_CFLConditionNumber + 2) layers.
     // In order find velocities at the fluid surface for all extrapolated
     // velocity layers, the level set will need to calculate signed distance 
     // for (_CFLConditionNumber + 3) layers
-    _levelset.calculateSignedDistanceField((int)ceil(_CFLConditionNumber) + 3);
+    int numLayers = _getNumLevelSetLayers();
+
+    if (_isParticleLevelSetInUse()) {
+        _updateLevelSetSignedDistanceFromParticles(numLayers);
+        return;
+    }
+
+    if (_isIncrementalLevelSetEnabled) {
+        _levelset.enableIncrementalUpdate();
+    } else {
+        _levelset.disableIncrementalUpdate();
+    }
+    _levelset.setSurfaceMesh(_surfaceMesh);
+    if (_isLevelSetFastMarchingEnabled) {
+        _levelset.enableFastMarching();
+    } else {
+        _levelset.disableFastMarching();
+    }
+    _levelset.calculateSignedDistanceField(numLayers);
 }
 
 /********************************************************************************
@@ -930,45 +1700,34 @@ void FluidSimulation::_writeSurfaceMeshToFile(TriangleMesh &mesh) {
 
 bool FluidSimulation::_isVertexNearSolid(glm::vec3 v, double eps) {
     GridIndex g = Grid3d::positionToGridIndex(v, _dx);
-    if (_isCellSolid(g)) {
+    if (!Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize)) {
         return true;
     }
-    
-    // is v near the solid boundary?
-    glm::vec3 e = glm::vec3(eps, eps, eps);
-    if (g.i == 1 || g.i == _isize - 2 || 
-        g.j == 1 || g.j == _jsize - 2 || 
-        g.k == 1 || g.k == _ksize - 2) {
 
-        glm::vec3 min = Grid3d::GridIndexToPosition(1, 1, 1, _dx);
-        glm::vec3 max = Grid3d::GridIndexToPosition(_isize - 2, 
-                                                    _jsize - 2, 
-                                                    _ksize - 2, _dx);
-        AABB bbox = AABB(min + e, max + glm::vec3(_dx, _dx, _dx) - e);
-        if (!bbox.isPointInside(v)) {
-            return true;
-        }
-    }
-
-    // is v near a solid cell?
-    glm::vec3 gp = Grid3d::GridIndexToPosition(g, _dx);
-    AABB bbox = AABB(gp + e, gp + glm::vec3(_dx, _dx, _dx) - e);
-    if (bbox.isPointInside(v)) {
+    int mask = _nearSolidCellMasks(g);
+    if (mask == 0) {
         return false;
     }
+    if (mask & _getNearSolidCellMaskBit(0, 0, 0)) {
+        return true;
+    }
 
-    glm::vec3 points[26] {
-        v-e.x, v+e.x, v-e.y, v+e.y, v-e.z, v+e.z, v-e.x-e.y, v-e.x+e.y,
-        v+e.x-e.y, v+e.x+e.y, v-e.x-e.z, v-e.x+e.z, v+e.x-e.z, v+e.x+e.z, 
-        v-e.y-e.z, v-e.y+e.z, v+e.y-e.z, v+e.y+e.z, v-e.x-e.y-e.z,
-        v-e.x-e.y+e.z, v-e.x+e.y-e.z, v-e.x+e.y+e.z, v+e.x-e.y-e.z,
-        v+e.x-e.y+e.z, v+e.x+e.y-e.z, v+e.x+e.y+e.z};
-    
-    int i, j, k;
-    for (int idx = 0; idx < 26; idx++) {
-        Grid3d::positionToGridIndex(points[idx], _dx, &i, &j, &k);
-        if (_isCellSolid(i, j, k)) {
-            return true;
+    // only neighbours that are within eps of v need to be tested
+    glm::vec3 gp = Grid3d::GridIndexToPosition(g, _dx);
+    int imin = v.x - gp.x < eps ? -1 : 0;
+    int jmin = v.y - gp.y < eps ? -1 : 0;
+    int kmin = v.z - gp.z < eps ? -1 : 0;
+    int imax = gp.x + _dx - v.x < eps ? 1 : 0;
+    int jmax = gp.y + _dx - v.y < eps ? 1 : 0;
+    int kmax = gp.z + _dx - v.z < eps ? 1 : 0;
+
+    for (int dk = kmin; dk <= kmax; dk++) {
+        for (int dj = jmin; dj <= jmax; dj++) {
+            for (int di = imin; di <= imax; di++) {
+                if (mask & _getNearSolidCellMaskBit(di, dj, dk)) {
+                    return true;
+                }
+            }
         }
     }
 
@@ -1022,23 +1781,40 @@ void FluidSimulation::_smoothSurfaceMesh(TriangleMesh &mesh) {
     _updateSmoothTriangleList(mesh, smoothVertices);
 }
 
+void FluidSimulation::_decimateSurfaceMesh(TriangleMesh &mesh) {
+    double dx = _dx / _outputFluidSurfaceSubdivisionLevel;
+
+    MeshDecimator decimator;
+    decimator.setMaxError(_surfaceMeshDecimationError*dx);
+    decimator.setMaxNormalDeviation(_surfaceMeshDecimationNormalDeviation);
+    decimator.decimate(mesh, _isSurfaceTriangleSmooth);
+}
+
 void FluidSimulation::_getSubdividedSurfaceCells(std::vector<GridIndex> &cells) {
+    _getSubdividedSurfaceCells(0, _ksize - 1, cells);
+}
+
+void FluidSimulation::_getSubdividedSurfaceCells(int kmin, int kmax, 
+                                                 std::vector<GridIndex> &cells) {
+    _updateSurfaceCellBand();
+
     int subd = _outputFluidSurfaceSubdivisionLevel;
     int numSubdivisions = subd*subd*subd;
     GridIndex *subdivisions = new GridIndex[numSubdivisions];
 
+    int radius = _getOutputSurfaceCellBandRadius();
     double width = _outputFluidSurfaceCellNarrowBandSize*_dx;
     GridIndex g;
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                g = GridIndex(i, j, k);
-                if (_levelset.getDistance(g) <= width) {
-                    Grid3d::getSubdividedGridIndices(g, subd, subdivisions);
-                    for (int idx = 0; idx < numSubdivisions; idx++) {
-                        cells.push_back(subdivisions[idx]);
-                    }
-                }
+    for (unsigned int i = 0; i < _surfaceCellBandIndices.size(); i++) {
+        g = _surfaceCellBandIndices[i];
+        if (g.k < kmin || g.k > kmax || _surfaceCellBandDistances(g) > radius) {
+            continue;
+        }
+
+        if (_levelset.getDistance(g) <= width) {
+            Grid3d::getSubdividedGridIndices(g, subd, subdivisions);
+            for (int idx = 0; idx < numSubdivisions; idx++) {
+                cells.push_back(subdivisions[idx]);
             }
         }
     }
@@ -1047,40 +1823,143 @@ void FluidSimulation::_getSubdividedSurfaceCells(std::vector<GridIndex> &cells)
 }
 
 void FluidSimulation::_getSubdividedSolidCells(std::vector<GridIndex> &cells) {
+    _getSubdividedSolidCells(0, _ksize - 1, cells);
+}
+
+/*
+    Solid cells only affect the output field near the output particles, so
+    only the solid cells within the surface cell band are subdivided.
+*/
+void FluidSimulation::_getSubdividedSolidCells(int kmin, int kmax, 
+                                               std::vector<GridIndex> &cells) {
+    _updateSurfaceCellBand();
+
     int subd = _outputFluidSurfaceSubdivisionLevel;
     int numSubdivisions = subd*subd*subd;
     GridIndex *subdivisions = new GridIndex[numSubdivisions];
 
     GridIndex g;
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                g = GridIndex(i, j, k);
-                if (_isCellSolid(g)) {
-                    Grid3d::getSubdividedGridIndices(g, subd, subdivisions);
-                    for (int idx = 0; idx < numSubdivisions; idx++) {
-                        cells.push_back(subdivisions[idx]);
-                    }
+    for (unsigned int i = 0; i < _surfaceCellBandIndices.size(); i++) {
+        g = _surfaceCellBandIndices[i];
+        if (g.k < kmin || g.k > kmax || !_isCellSolid(g)) {
+            continue;
+        }
+
+        Grid3d::getSubdividedGridIndices(g, subd, subdivisions);
+        for (int idx = 0; idx < numSubdivisions; idx++) {
+            cells.push_back(subdivisions[idx]);
+        }
+    }
+
+    delete[] subdivisions;
+}
+
+void FluidSimulation::_getOutputSurfaceParticles(std::vector<glm::vec3> &particles) {
+    _updateSurfaceCellBand();
+
+    // The band lookup rejects particles far from the surface before
+    // the level set distance is interpolated
+    int radius = _getOutputSurfaceParticleBandRadius();
+    double width = _outputFluidSurfaceParticleNarrowBandSize*_dx;
+    int d;
+    glm::vec3 p;
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        p = _markerParticles[i].position;
+        d = _surfaceCellBandDistances(Grid3d::positionToGridIndex(p, _dx));
+        if (d == -1 || d > radius) {
+            continue;
+        }
+
+        if (_levelset.getDistance(p) <= width) {
+            particles.push_back(p);
+        }
+    }
+}
+
+/*
+    The level set surface is polygonized from particles within the fluid 
+    cells, so it lies within a particle radius of a fluid cell that borders 
+    a non-fluid cell. Band radii are the number of cells from a surface cell 
+    that a cell or particle within the narrow band widths can be.
+*/
+int FluidSimulation::_getOutputSurfaceCellBandRadius() {
+    double r = _markerParticleRadius*_markerParticleScale;
+    double width = _outputFluidSurfaceCellNarrowBandSize*_dx;
+    return (int)floor((r + width) / _dx + 0.5);
+}
+
+int FluidSimulation::_getOutputSurfaceParticleBandRadius() {
+    double r = _markerParticleRadius*_markerParticleScale;
+    double width = _outputFluidSurfaceParticleNarrowBandSize*_dx;
+    return (int)floor((r + width) / _dx) + 1;
+}
+
+int FluidSimulation::_getOutputSolidCellBandRadius() {
+    double r = _markerParticleRadius*_markerParticleScale;
+    int radius = _getOutputSurfaceParticleBandRadius() + (int)ceil(r / _dx) + 1;
+    return (int)fmax(radius, _getOutputSurfaceCellBandRadius());
+}
+
+bool compareGridIndexByPosition(const GridIndex g1, const GridIndex g2) {
+    if (g1.k != g2.k) { return g1.k < g2.k; }
+    if (g1.j != g2.j) { return g1.j < g2.j; }
+    return g1.i < g2.i;
+}
+
+/*
+    Grows the surface cells outward one layer of 26-neighbours at a time.
+    Cost is proportional to the number of cells in the band.
+*/
+void FluidSimulation::_updateSurfaceCellBand() {
+    int radius = _getOutputSolidCellBandRadius();
+    if (!_isSurfaceCellBandOutdated && radius == _surfaceCellBandRadius) {
+        return;
+    }
+
+    if (_surfaceCellBandDistances.width == 0) {
+        _surfaceCellBandDistances = Array3d<int>(_isize, _jsize, _ksize, -1);
+    }
+    _surfaceCellBandDistances.set(_surfaceCellBandIndices, -1);
+    _surfaceCellBandIndices.clear();
+
+    std::vector<GridIndex> layer = _surfaceCellIndices;
+    std::vector<GridIndex> nextLayer;
+    _surfaceCellBandDistances.set(layer, 0);
+    _surfaceCellBandIndices.insert(_surfaceCellBandIndices.end(), layer.begin(), layer.end());
+
+    GridIndex nbs[26];
+    GridIndex n;
+    for (int d = 1; d <= radius; d++) {
+        nextLayer.clear();
+        for (unsigned int i = 0; i < layer.size(); i++) {
+            Grid3d::getNeighbourGridIndices26(layer[i], nbs);
+            for (int idx = 0; idx < 26; idx++) {
+                n = nbs[idx];
+                if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
+                        _surfaceCellBandDistances(n) == -1) {
+                    _surfaceCellBandDistances.set(n, d);
+                    nextLayer.push_back(n);
                 }
             }
         }
+
+        _surfaceCellBandIndices.insert(_surfaceCellBandIndices.end(), 
+                                       nextLayer.begin(), nextLayer.end());
+        layer.swap(nextLayer);
     }
 
-    delete[] subdivisions;
-}
+    // keep the grid scan order of the full domain loops that this replaces
+    std::sort(_surfaceCellBandIndices.begin(), _surfaceCellBandIndices.end(), 
+              compareGridIndexByPosition);
 
-void FluidSimulation::_getOutputSurfaceParticles(std::vector<glm::vec3> &particles) {
-    double width = _outputFluidSurfaceParticleNarrowBandSize*_dx;
-    glm::vec3 p;
-    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i].position;
-        if (_levelset.getDistance(p) <= width) {
-            particles.push_back(p);
-        }
-    }
+    _surfaceCellBandRadius = radius;
+    _isSurfaceCellBandOutdated = false;
 }
 
 TriangleMesh FluidSimulation::_polygonizeOutputSurface() {
+    if (_isOutputSurfaceSlabPolygonizationEnabled) {
+        return _polygonizeOutputSurfaceInSlabs();
+    }
 
     std::vector<GridIndex> surfaceCells;
     std::vector<GridIndex> solidCells;
@@ -1111,9 +1990,136 @@ TriangleMesh FluidSimulation::_polygonizeOutputSurface() {
 
     SparsePolygonizer3d polygonizer = SparsePolygonizer3d(field);
     polygonizer.setSurfaceCellIndices(surfaceCells);
+    if (_isAdaptiveSurfacePolygonizationEnabled) {
+        polygonizer.enableAdaptivePolygonization(_adaptiveSurfacePolygonizationTolerance);
+    }
+    polygonizer.polygonizeSurface();
+
+    return polygonizer.takeTriangleMesh();
+}
+
+/*
+    Particles are reordered by the k index of the cell they are in. 
+    binOffsets[k] is the index of the first particle in layer k.
+*/
+void FluidSimulation::_sortOutputParticlesByLayer(std::vector<glm::vec3> &particles,
+                                                  std::vector<int> &binOffsets) {
+    binOffsets.assign(_ksize + 1, 0);
+    std::vector<int> layers(particles.size());
+    int k;
+    for (unsigned int i = 0; i < particles.size(); i++) {
+        k = (int)floor(particles[i].z / _dx);
+        k = (int)fmin(fmax(k, 0), _ksize - 1);
+        layers[i] = k;
+        binOffsets[k + 1]++;
+    }
+    for (int i = 0; i < _ksize; i++) {
+        binOffsets[i + 1] += binOffsets[i];
+    }
+
+    std::vector<int> cursor(binOffsets.begin(), binOffsets.end() - 1);
+    std::vector<glm::vec3> sorted(particles.size());
+    for (unsigned int i = 0; i < particles.size(); i++) {
+        sorted[cursor[layers[i]]++] = particles[i];
+    }
+    particles.swap(sorted);
+}
+
+TriangleMesh FluidSimulation::_polygonizeOutputSlab(int kmin, int kmax, 
+                                                   std::vector<glm::vec3> &particles,
+                                                   std::vector<int> &binOffsets) {
+    std::vector<GridIndex> surfaceCells;
+    std::vector<GridIndex> solidCells;
+    _getSubdividedSurfaceCells(kmin, kmax, surfaceCells);
+    _getSubdividedSolidCells((int)fmax(kmin - 1, 0), (int)fmin(kmax + 1, _ksize - 1), solidCells);
+
+    int subd = _outputFluidSurfaceSubdivisionLevel;
+    int width = _isize*subd;
+    int height = _jsize*subd;
+    int depth = _ksize*subd;
+    double dx = _dx / subd;
+
+    // The field has the dimensions of the full domain so that vertices on
+    // the slab boundaries are evaluated identically by both slabs. Storage 
+    // is only allocated around the particles splatted for this slab.
+    SparseImplicitSurfaceScalarField field = SparseImplicitSurfaceScalarField(width + 1, 
+                                                                              height + 1, 
+                                                                              depth + 1, dx);
+    field.setSolidCells(solidCells);
+
+    double r = _markerParticleRadius*_markerParticleScale;
+    field.setPointRadius(r);
+
+    // only the layers within a particle radius of the slab are visited
+    double zmin = kmin*_dx - r;
+    double zmax = (kmax + 1)*_dx + r;
+    int startbin = (int)fmax(floor(zmin / _dx), 0);
+    int endbin = (int)fmin(floor(zmax / _dx), _ksize - 1);
+    for (int i = binOffsets[startbin]; i < binOffsets[endbin + 1]; i++) {
+        if (particles[i].z >= zmin && particles[i].z <= zmax) {
+            field.addPoint(particles[i]);
+        }
+    }
+
+    SparsePolygonizer3d polygonizer = SparsePolygonizer3d(field);
+    polygonizer.setSurfaceCellIndices(surfaceCells);
+    if (_isAdaptiveSurfacePolygonizationEnabled) {
+        polygonizer.enableAdaptivePolygonization(_adaptiveSurfacePolygonizationTolerance);
+    }
+    polygonizer.setCellBounds(GridIndex(0, 0, kmin*subd), 
+                              GridIndex(width - 1, height - 1, (kmax + 1)*subd - 1));
     polygonizer.polygonizeSurface();
 
-    return polygonizer.getTriangleMesh();
+    return polygonizer.takeTriangleMesh();
+}
+
+void FluidSimulation::_appendOutputSlabMesh(TriangleMesh &slabMesh, TriangleMesh &mesh) {
+    int offset = (int)mesh.vertices.size();
+    mesh.vertices.insert(mesh.vertices.end(), 
+                         slabMesh.vertices.begin(), slabMesh.vertices.end());
+
+    Triangle t;
+    for (unsigned int i = 0; i < slabMesh.triangles.size(); i++) {
+        t = slabMesh.triangles[i];
+        mesh.triangles.push_back(Triangle(t.tri[0] + offset, 
+                                          t.tri[1] + offset, 
+                                          t.tri[2] + offset));
+    }
+}
+
+/*
+    Polygonizes the subdivided output surface one slab of 
+    _outputSurfaceSlabDepth grid cells at a time. Only the particles within 
+    range of a slab are splatted, so the size of the scalar field and 
+    polygonizer is bounded by the slab rather than by the whole domain. 
+    The welded output mesh is still built in memory so that it can be 
+    smoothed and decimated. Vertices on the plane between two slabs are 
+    computed from the same field values by both slabs and are welded.
+*/
+TriangleMesh FluidSimulation::_polygonizeOutputSurfaceInSlabs() {
+    std::vector<glm::vec3> particles;
+    _getOutputSurfaceParticles(particles);
+
+    std::vector<int> binOffsets;
+    _sortOutputParticlesByLayer(particles, binOffsets);
+
+    int subd = _outputFluidSurfaceSubdivisionLevel;
+    double dx = _dx / subd;
+
+    TriangleMesh mesh;
+    int slabDepth = (int)fmax(_outputSurfaceSlabDepth, 1);
+    for (int kmin = 0; kmin < _ksize; kmin += slabDepth) {
+        int kmax = (int)fmin(kmin + slabDepth - 1, _ksize - 1);
+        TriangleMesh slabMesh = _polygonizeOutputSlab(kmin, kmax, particles, binOffsets);
+        _appendOutputSlabMesh(slabMesh, mesh);
+    }
+
+    // The tolerance is below the smallest spacing between distinct vertices
+    // of the polygonizer, so only the shared boundary vertices are merged
+    mesh.weldVertices(_outputSlabWeldTolerance*dx);
+    mesh.updateVertexNormals();
+
+    return mesh;
 }
 
 void FluidSimulation::_updateBrickGrid(double dt) {
@@ -1131,11 +2137,17 @@ void FluidSimulation::_reconstructOutputFluidSurface(double dt) {
     TriangleMesh mesh;
     if (_isSurfaceMeshOutputEnabled) {
         if (_outputFluidSurfaceSubdivisionLevel == 1) {
-            mesh = _surfaceMesh;
+            // The simulation mesh is shared with the level set, so output
+            // smoothing works on a copy
+            mesh = *_surfaceMesh;
         } else {
             mesh = _polygonizeOutputSurface();
         }
         _smoothSurfaceMesh(mesh);
+
+        if (_isSurfaceMeshDecimationEnabled) {
+            _decimateSurfaceMesh(mesh);
+        }
     }
 
     if (_isBrickOutputEnabled) {
@@ -1173,9 +2185,25 @@ void FluidSimulation::_computeVelocityScalarField(Array3d<float> &field,
     }
 
     MarkerParticle p;
-    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        grid.addPointValue(p.position - offset, p.velocity[dir]);
+    if (_isAPICVelocityTransferEnabled) {
+        glm::vec3 affine;
+        for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+            p = _markerParticles[i];
+            if (dir == U) {
+                affine = _markerParticleAffine[i].U;
+            } else if (dir == V) {
+                affine = _markerParticleAffine[i].V;
+            } else {
+                affine = _markerParticleAffine[i].W;
+            }
+
+            grid.addPointValue(p.position - offset, p.velocity[dir], affine);
+        }
+    } else {
+        for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+            p = _markerParticles[i];
+            grid.addPointValue(p.position - offset, p.velocity[dir]);
+        }
     }
     grid.applyWeightField();
 
@@ -1192,14 +2220,18 @@ void FluidSimulation::_advectVelocityFieldU() {
 
     std::vector<GridIndex> extrapolationIndices;
     double eps = 10e-9;
+    int *mrow0;
+    float *vrow;
     for (int k = 0; k < ugrid.depth; k++) {
         for (int j = 0; j < ugrid.height; j++) {
+            mrow0 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerU(j, k);
             for (int i = 0; i < ugrid.width; i++) {
-                if (_isFaceBorderingMaterialU(i, j, k, M_FLUID)) {
-                    if (weightfield(i, j, k) < eps) {
+                if (_isFaceBorderingMaterialRowU(mrow0, i, M_FLUID)) {
+                    if (weightfield.get(i, j, k) < eps) {
                         extrapolationIndices.push_back(GridIndex(i, j, k));
                     } else {
-                        _MACVelocity.setU(i, j, k, ugrid(i, j, k));
+                        vrow[i] = ugrid.get(i, j, k);
                     }
                 }
             }
@@ -1238,14 +2270,19 @@ void FluidSimulation::_advectVelocityFieldV() {
     
     std::vector<GridIndex> extrapolationIndices;
     double eps = 10e-9;
+    int *mrow0, *mrow1;
+    float *vrow;
     for (int k = 0; k < vgrid.depth; k++) {
         for (int j = 0; j < vgrid.height; j++) {
+            mrow0 = _getMaterialRow(j - 1, k);
+            mrow1 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerV(j, k);
             for (int i = 0; i < vgrid.width; i++) {
-                if (_isFaceBorderingMaterialV(i, j, k, M_FLUID)) {
-                    if (weightfield(i, j, k) < eps) {
+                if (_isFaceBorderingMaterialRows(mrow0, mrow1, i, M_FLUID)) {
+                    if (weightfield.get(i, j, k) < eps) {
                         extrapolationIndices.push_back(GridIndex(i, j, k));
                     } else {
-                        _MACVelocity.setV(i, j, k, vgrid(i, j, k));
+                        vrow[i] = vgrid.get(i, j, k);
                     }
                 }
             }
@@ -1284,14 +2321,19 @@ void FluidSimulation::_advectVelocityFieldW() {
     
     std::vector<GridIndex> extrapolationIndices;
     double eps = 10e-9;
+    int *mrow0, *mrow1;
+    float *vrow;
     for (int k = 0; k < wgrid.depth; k++) {
         for (int j = 0; j < wgrid.height; j++) {
+            mrow0 = _getMaterialRow(j, k - 1);
+            mrow1 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerW(j, k);
             for (int i = 0; i < wgrid.width; i++) {
-                if (_isFaceBorderingMaterialW(i, j, k, M_FLUID)) {
-                    if (weightfield(i, j, k) < eps) {
+                if (_isFaceBorderingMaterialRows(mrow0, mrow1, i, M_FLUID)) {
+                    if (weightfield.get(i, j, k) < eps) {
                         extrapolationIndices.push_back(GridIndex(i, j, k));
                     } else {
-                        _MACVelocity.setW(i, j, k, wgrid(i, j, k));
+                        vrow[i] = wgrid.get(i, j, k);
                     }
                 }
             }
@@ -1321,10 +2363,19 @@ void FluidSimulation::_advectVelocityFieldW() {
     }
 }
 
-void FluidSimulation::_advectVelocityField() {
+void FluidSimulation::_advectVelocityField(double dt) {
+    if (_particleFreeFluidCells.empty()) {
+        _advectVelocityFieldU();
+        _advectVelocityFieldV();
+        _advectVelocityFieldW();
+        return;
+    }
+
+    MACVelocityField prevMACVelocity = _MACVelocity;
     _advectVelocityFieldU();
     _advectVelocityFieldV();
     _advectVelocityFieldW();
+    _advectParticleFreeVelocities(prevMACVelocity, dt);
 }
 
 /********************************************************************************
@@ -1332,12 +2383,17 @@ void FluidSimulation::_advectVelocityField() {
 ********************************************************************************/
 
 void FluidSimulation::_applyBodyForcesToVelocityField(double dt) {
+    int *mrow0, *mrow1;
+    float *vrow;
     if (fabs(_bodyForce.x) > 0.0) {
+        float fx = (float)(_bodyForce.x * dt);
         for (int k = 0; k < _ksize; k++) {
             for (int j = 0; j < _jsize; j++) {
+                mrow0 = _getMaterialRow(j, k);
+                vrow = _MACVelocity.getRowPointerU(j, k);
                 for (int i = 0; i < _isize + 1; i++) {
-                    if (_isFaceBorderingMaterialU(i, j, k, M_FLUID)) {
-                        _MACVelocity.addU(i, j, k, _bodyForce.x * dt);
+                    if (_isFaceBorderingMaterialRowU(mrow0, i, M_FLUID)) {
+                        vrow[i] += fx;
                     }
                 }
             }
@@ -1345,11 +2401,15 @@ void FluidSimulation::_applyBodyForcesToVelocityField(double dt) {
     }
 
     if (fabs(_bodyForce.y) > 0.0) {
+        float fy = (float)(_bodyForce.y * dt);
         for (int k = 0; k < _ksize; k++) {
             for (int j = 0; j < _jsize + 1; j++) {
+                mrow0 = _getMaterialRow(j - 1, k);
+                mrow1 = _getMaterialRow(j, k);
+                vrow = _MACVelocity.getRowPointerV(j, k);
                 for (int i = 0; i < _isize; i++) {
-                    if (_isFaceBorderingMaterialV(i, j, k, M_FLUID)) {
-                        _MACVelocity.addV(i, j, k, _bodyForce.y * dt);
+                    if (_isFaceBorderingMaterialRows(mrow0, mrow1, i, M_FLUID)) {
+                        vrow[i] += fy;
                     }
                 }
             }
@@ -1357,11 +2417,15 @@ void FluidSimulation::_applyBodyForcesToVelocityField(double dt) {
     }
 
     if (fabs(_bodyForce.z) > 0.0) {
+        float fz = (float)(_bodyForce.z * dt);
         for (int k = 0; k < _ksize + 1; k++) {
             for (int j = 0; j < _jsize; j++) {
+                mrow0 = _getMaterialRow(j, k - 1);
+                mrow1 = _getMaterialRow(j, k);
+                vrow = _MACVelocity.getRowPointerW(j, k);
                 for (int i = 0; i < _isize; i++) {
-                    if (_isFaceBorderingMaterialW(i, j, k, M_FLUID)) {
-                        _MACVelocity.addW(i, j, k, _bodyForce.z * dt);
+                    if (_isFaceBorderingMaterialRows(mrow0, mrow1, i, M_FLUID)) {
+                        vrow[i] += fz;
                     }
                 }
             }
@@ -1392,10 +2456,6 @@ double FluidSimulation::_calculateNegativeDivergenceVector(VectorCoefficients &b
         b.vector.set(i, j, k, (float)value);
     }
 
-    // solid cells are stationary right now
-    float usolid = 0.0;
-    float vsolid = 0.0;
-    float wsolid = 0.0;
     float maxDivergence = 0.0;
     for (unsigned int idx = 0; idx < _fluidCellIndices.size(); idx++) {
         int i = _fluidCellIndices[idx].i;
@@ -1403,29 +2463,35 @@ double FluidSimulation::_calculateNegativeDivergenceVector(VectorCoefficients &b
         int k = _fluidCellIndices[idx].k;
 
         if (_isCellSolid(i-1, j, k)) {
-            float value = b.vector(i, j, k) - (float)scale*(_MACVelocity.U(i, j, k) - usolid);
+            float value = b.vector(i, j, k) - (float)scale*(_MACVelocity.U(i, j, k) -
+                                                            _getSolidFaceVelocityU(i, j, k));
             b.vector.set(i, j, k, value);
         }
         if (_isCellSolid(i+1, j, k)) {
-            float value = b.vector(i, j, k) + (float)scale*(_MACVelocity.U(i+1, j, k) - usolid);
+            float value = b.vector(i, j, k) + (float)scale*(_MACVelocity.U(i+1, j, k) -
+                                                            _getSolidFaceVelocityU(i+1, j, k));
             b.vector.set(i, j, k, value);
         }
 
         if (_isCellSolid(i, j-1, k)) {
-            float value = b.vector(i, j, k) - (float)scale*(_MACVelocity.V(i, j, k) - usolid);
+            float value = b.vector(i, j, k) - (float)scale*(_MACVelocity.V(i, j, k) -
+                                                            _getSolidFaceVelocityV(i, j, k));
             b.vector.set(i, j, k, value);
         }
         if (_isCellSolid(i, j+1, k)) {
-            float value = b.vector(i, j, k) + (float)scale*(_MACVelocity.V(i, j+1, k) - usolid);
+            float value = b.vector(i, j, k) + (float)scale*(_MACVelocity.V(i, j+1, k) -
+                                                            _getSolidFaceVelocityV(i, j+1, k));
             b.vector.set(i, j, k, value);
         }
 
         if (_isCellSolid(i, j, k-1)) {
-            float value = b.vector(i, j, k) - (float)scale*(_MACVelocity.W(i, j, k) - usolid);
+            float value = b.vector(i, j, k) - (float)scale*(_MACVelocity.W(i, j, k) -
+                                                            _getSolidFaceVelocityW(i, j, k));
             b.vector.set(i, j, k, value);
         }
         if (_isCellSolid(i, j, k+1)) {
-            float value = b.vector(i, j, k) + (float)scale*(_MACVelocity.W(i, j, k+1) - usolid);
+            float value = b.vector(i, j, k) + (float)scale*(_MACVelocity.W(i, j, k+1) -
+                                                            _getSolidFaceVelocityW(i, j, k+1));
             b.vector.set(i, j, k, value);
         }
 
@@ -1760,7 +2826,7 @@ void FluidSimulation::_updatePressureGrid(Array3d<float> &pressureGrid, double d
 void FluidSimulation::_applyPressureToFaceU(int i, int j, int k, 
                                             Array3d<float> &pressureGrid,
                                             MACVelocityField &tempMACVelocity, double dt) {
-    double usolid = 0.0;   // solids are stationary
+    double usolid = _getSolidFaceVelocityU(i, j, k);
     double scale = dt / (_density * _dx);
     double invscale = 1.0 / scale;
 
@@ -1787,7 +2853,7 @@ void FluidSimulation::_applyPressureToFaceU(int i, int j, int k,
 void FluidSimulation::_applyPressureToFaceV(int i, int j, int k, 
                                             Array3d<float> &pressureGrid,
                                             MACVelocityField &tempMACVelocity, double dt) {
-    double usolid = 0.0;   // solids are stationary
+    double usolid = _getSolidFaceVelocityV(i, j, k);
     double scale = dt / (_density * _dx);
     double invscale = 1.0 / scale;
 
@@ -1816,7 +2882,7 @@ void FluidSimulation::_applyPressureToFaceV(int i, int j, int k,
 void FluidSimulation::_applyPressureToFaceW(int i, int j, int k, 
                                             Array3d<float> &pressureGrid,
                                             MACVelocityField &tempMACVelocity, double dt) {
-    double usolid = 0.0;   // solids are stationary
+    double usolid = _getSolidFaceVelocityW(i, j, k);
     double scale = dt / (_density * _dx);
     double invscale = 1.0 / scale;
 
@@ -1843,11 +2909,16 @@ void FluidSimulation::_applyPressureToFaceW(int i, int j, int k,
 }
 
 void FluidSimulation::_commitTemporaryVelocityFieldValues(MACVelocityField &tempMACVelocity) {
+    int *mrow0, *mrow1;
+    float *vrow, *trow;
     for (int k = 0; k < _ksize; k++) {
         for (int j = 0; j < _jsize; j++) {
+            mrow0 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerU(j, k);
+            trow = tempMACVelocity.getRowPointerU(j, k);
             for (int i = 0; i < _isize + 1; i++) {
-                if (_isFaceBorderingMaterialU(i, j, k, M_FLUID)) {
-                    _MACVelocity.setU(i, j, k, tempMACVelocity.U(i, j, k));
+                if (_isFaceBorderingMaterialRowU(mrow0, i, M_FLUID)) {
+                    vrow[i] = trow[i];
                 }
             }
         }
@@ -1855,9 +2926,13 @@ void FluidSimulation::_commitTemporaryVelocityFieldValues(MACVelocityField &temp
 
     for (int k = 0; k < _ksize; k++) {
         for (int j = 0; j < _jsize + 1; j++) {
+            mrow0 = _getMaterialRow(j - 1, k);
+            mrow1 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerV(j, k);
+            trow = tempMACVelocity.getRowPointerV(j, k);
             for (int i = 0; i < _isize; i++) {
-                if (_isFaceBorderingMaterialV(i, j, k, M_FLUID)) {
-                    _MACVelocity.setV(i, j, k, tempMACVelocity.V(i, j, k));
+                if (_isFaceBorderingMaterialRows(mrow0, mrow1, i, M_FLUID)) {
+                    vrow[i] = trow[i];
                 }
             }
         }
@@ -1865,9 +2940,13 @@ void FluidSimulation::_commitTemporaryVelocityFieldValues(MACVelocityField &temp
 
     for (int k = 0; k < _ksize + 1; k++) {
         for (int j = 0; j < _jsize; j++) {
+            mrow0 = _getMaterialRow(j, k - 1);
+            mrow1 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerW(j, k);
+            trow = tempMACVelocity.getRowPointerW(j, k);
             for (int i = 0; i < _isize; i++) {
-                if (_isFaceBorderingMaterialW(i, j, k, M_FLUID)) {
-                    _MACVelocity.setW(i, j, k, tempMACVelocity.W(i, j, k));
+                if (_isFaceBorderingMaterialRows(mrow0, mrow1, i, M_FLUID)) {
+                    vrow[i] = trow[i];
                 }
             }
         }
@@ -1881,7 +2960,7 @@ void FluidSimulation::_applyPressureToVelocityField(Array3d<float> &pressureGrid
         for (int j = 0; j < _jsize; j++) {
             for (int i = 0; i < _isize + 1; i++) {
                 if (_isFaceBorderingMaterialU(i, j, k, M_SOLID)) {
-                    tempMACVelocity.setU(i, j, k, 0.0);
+                    tempMACVelocity.setU(i, j, k, _getSolidFaceVelocityU(i, j, k));
                 }
 
                 if (_isFaceBorderingMaterialU(i, j, k, M_FLUID) &&
@@ -1896,7 +2975,7 @@ void FluidSimulation::_applyPressureToVelocityField(Array3d<float> &pressureGrid
         for (int j = 0; j < _jsize + 1; j++) {
             for (int i = 0; i < _isize; i++) {
                 if (_isFaceBorderingMaterialV(i, j, k, M_SOLID)) {
-                    tempMACVelocity.setV(i, j, k, 0.0);
+                    tempMACVelocity.setV(i, j, k, _getSolidFaceVelocityV(i, j, k));
                 }
 
                 if (_isFaceBorderingMaterialV(i, j, k, M_FLUID) &&
@@ -1911,7 +2990,7 @@ void FluidSimulation::_applyPressureToVelocityField(Array3d<float> &pressureGrid
         for (int j = 0; j < _jsize; j++) {
             for (int i = 0; i < _isize; i++) {
                 if (_isFaceBorderingMaterialW(i, j, k, M_SOLID)) {
-                    tempMACVelocity.setW(i, j, k, 0.0);
+                    tempMACVelocity.setW(i, j, k, _getSolidFaceVelocityW(i, j, k));
                 }
 
                 if (_isFaceBorderingMaterialW(i, j, k, M_FLUID) &&
@@ -1929,42 +3008,90 @@ void FluidSimulation::_applyPressureToVelocityField(Array3d<float> &pressureGrid
     EXTRAPOLATE FLUID VELOCITIES
 ********************************************************************************/
 
-void FluidSimulation::_updateExtrapolationLayer(int layerIndex, Array3d<int> &layerGrid) {
+void FluidSimulation::_findExtrapolationLayerCandidates(int startidx, int endidx,
+                                                       std::vector<GridIndex> *frontier,
+                                                       Array3d<int> *layerGrid,
+                                                       std::vector<GridIndex> *candidates) {
     GridIndex neighbours[6];
     GridIndex n;
+    for (int i = startidx; i <= endidx; i++) {
+        Grid3d::getNeighbourGridIndices6(frontier->at(i), neighbours);
+        for (int idx = 0; idx < 6; idx++) {
+            n = neighbours[idx];
+            if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
+                    layerGrid->get(n) == -1 && !_isCellSolid(n)) {
+                candidates->push_back(n);
+            }
+        }
+    }
+}
 
-    for (int k = 0; k < layerGrid.depth; k++) {
-        for (int j = 0; j < layerGrid.height; j++) {
-            for (int i = 0; i < layerGrid.width; i++) {
-                if (layerGrid(i, j, k) == layerIndex - 1 && !_isCellSolid(i, j, k)) {
-                    Grid3d::getNeighbourGridIndices6(i, j, k, neighbours);
-                    for (int idx = 0; idx < 6; idx++) {
-                        n = neighbours[idx];
-
-                        if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
-                                layerGrid(n) == -1 && !_isCellSolid(n)) {
-                            layerGrid.set(n, layerIndex);
-                        }
-                    }
-                }
+void FluidSimulation::_updateExtrapolationLayer(int layerIndex, 
+                                                std::vector<GridIndex> &frontier,
+                                                std::vector<GridIndex> &layer,
+                                                Array3d<int> &layerGrid) {
+    if (frontier.size() == 0) {
+        return;
+    }
+
+    // Threads collect unlabeled neighbours of the frontier. Cells found by
+    // more than one thread are removed when the layer is labeled.
+    int numThreads = (int)fmin(_numExtrapolationThreads, frontier.size());
+    std::vector<int> startIndices;
+    std::vector<int> endIndices;
+    int chunksize = (int)floor(frontier.size() / numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startIdx = (i == 0) ? 0 : endIndices[i - 1] + 1;
+        int endIdx = (i == numThreads - 1) ? (int)frontier.size() - 1 : startIdx + chunksize - 1;
+
+        startIndices.push_back(startIdx);
+        endIndices.push_back(endIdx);
+    }
+
+    std::vector<std::vector<GridIndex> > candidates(numThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&FluidSimulation::_findExtrapolationLayerCandidates,
+                                      this,
+                                      startIndices[i],
+                                      endIndices[i],
+                                      &frontier,
+                                      &layerGrid,
+                                      &candidates[i]));
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+    }
+
+    GridIndex g;
+    for (unsigned int i = 0; i < candidates.size(); i++) {
+        for (unsigned int j = 0; j < candidates[i].size(); j++) {
+            g = candidates[i][j];
+            if (layerGrid(g) == -1) {
+                layerGrid.set(g, layerIndex);
+                layer.push_back(g);
             }
         }
     }
 }
 
-int FluidSimulation::_updateExtrapolationLayers(Array3d<int> &layerGrid) {
+int FluidSimulation::_updateExtrapolationLayers(Array3d<int> &layerGrid, 
+                                                std::vector<std::vector<GridIndex> > &layers) {
+    // add 2 extra layers to account for extra values needed during cubic 
+    // interpolation calculations
+    int numLayers = (int)ceil(_CFLConditionNumber) + 2;
+    layers = std::vector<std::vector<GridIndex> >(numLayers + 1);
 
     GridIndex idx;
     for (unsigned int i = 0; i < _fluidCellIndices.size(); i++) {
         idx = _fluidCellIndices[i];
         layerGrid.set(idx, 0);
+        layers[0].push_back(idx);
     }
 
-    // add 2 extra layers to account for extra values needed during cubic 
-    // interpolation calculations
-    int numLayers = (int)ceil(_CFLConditionNumber) + 2;
     for (int layer = 1; layer <= numLayers; layer++) {
-        _updateExtrapolationLayer(layer, layerGrid);
+        _updateExtrapolationLayer(layer, layers[layer - 1], layers[layer], layerGrid);
     }
 
     return numLayers;
@@ -1975,12 +3102,6 @@ double FluidSimulation::_getExtrapolatedVelocityForFaceU(int i, int j, int k, in
 
     // First two layers are calculate by averaging neighbours so that values exist for tricubic
     // interpolation at the fluid boundary for layers > 2
-    if (layerIdx > 2) {
-        glm::vec3 pos = _MACVelocity.velocityIndexToPositionU(i, j, k);
-        glm::vec3 v = _getVelocityAtNearestPointOnFluidSurface(pos);
-        return v.x;
-    }
-
     GridIndex n[6];
     Grid3d::getNeighbourGridIndices6(i, j, k, n);
 
@@ -2006,12 +3127,6 @@ double FluidSimulation::_getExtrapolatedVelocityForFaceU(int i, int j, int k, in
 double FluidSimulation::_getExtrapolatedVelocityForFaceV(int i, int j, int k, int layerIdx,
                                                          Array3d<int> &layerGrid) {
 
-    if (layerIdx > 2) {
-        glm::vec3 pos = _MACVelocity.velocityIndexToPositionV(i, j, k);
-        glm::vec3 v = _getVelocityAtNearestPointOnFluidSurface(pos);
-        return v.y;
-    }
-
     GridIndex n[6];
     Grid3d::getNeighbourGridIndices6(i, j, k, n);
 
@@ -2037,12 +3152,6 @@ double FluidSimulation::_getExtrapolatedVelocityForFaceV(int i, int j, int k, in
 double FluidSimulation::_getExtrapolatedVelocityForFaceW(int i, int j, int k, int layerIdx,
                                                          Array3d<int> &layerGrid) {
 
-    if (layerIdx > 2) {
-        glm::vec3 pos = _MACVelocity.velocityIndexToPositionW(i, j, k);
-        glm::vec3 v = _getVelocityAtNearestPointOnFluidSurface(pos);
-        return v.z;
-    }
-
     GridIndex n[6];
     Grid3d::getNeighbourGridIndices6(i, j, k, n);
 
@@ -2065,95 +3174,284 @@ double FluidSimulation::_getExtrapolatedVelocityForFaceW(int i, int j, int k, in
     return sum / weightsum;
 }
 
-glm::vec3 FluidSimulation::_getVelocityAtNearestPointOnFluidSurface(glm::vec3 p) {
-    p = _levelset.getClosestPointOnSurface(p);
-    return _getVelocityAtPosition(p);
+int FluidSimulation::_getFaceLayer(int dir, GridIndex g, Array3d<int> &layerGrid) {
+    // Lowest layer of the two cells bordering the face, or -1 if neither
+    // cell has a layer
+    GridIndex c1 = g;
+    GridIndex c0 = dir == 0 ? GridIndex(g.i - 1, g.j, g.k) :
+                  (dir == 1 ? GridIndex(g.i, g.j - 1, g.k) : GridIndex(g.i, g.j, g.k - 1));
+
+    int l0 = Grid3d::isGridIndexInRange(c0, _isize, _jsize, _ksize) ? layerGrid(c0) : -1;
+    int l1 = Grid3d::isGridIndexInRange(c1, _isize, _jsize, _ksize) ? layerGrid(c1) : -1;
+    if (l0 == -1) {
+        return l1;
+    }
+    if (l1 == -1) {
+        return l0;
+    }
+
+    return l0 < l1 ? l0 : l1;
 }
 
-void FluidSimulation::_extrapolateVelocitiesForLayerIndexU(int idx, Array3d<int> &layerGrid) {
-    Array3d<float> tempMACVelocityU = Array3d<float>(_isize + 1, _jsize, _ksize);
-    std::vector<GridIndex> tempIndices;
+double FluidSimulation::_getFaceSignedDistance(int dir, GridIndex g) {
+    GridIndex c1 = g;
+    GridIndex c0 = dir == 0 ? GridIndex(g.i - 1, g.j, g.k) :
+                  (dir == 1 ? GridIndex(g.i, g.j - 1, g.k) : GridIndex(g.i, g.j, g.k - 1));
 
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize + 1; i++) {
-                bool isExtrapolated = _isFaceBorderingLayerIndexU(i, j, k, idx, layerGrid) && 
-                                     !_isFaceBorderingLayerIndexU(i, j, k, idx-1, layerGrid) &&
-                                    (!_isFaceBorderingMaterialU(i, j, k, M_SOLID));
-                if (isExtrapolated) {
-                    double v = _getExtrapolatedVelocityForFaceU(i, j, k, idx, layerGrid);
-                    tempMACVelocityU.set(i, j, k, (float)v);
-                    tempIndices.push_back(GridIndex(i, j, k));
-                }
-            }
+    bool isInRange0 = Grid3d::isGridIndexInRange(c0, _isize, _jsize, _ksize);
+    bool isInRange1 = Grid3d::isGridIndexInRange(c1, _isize, _jsize, _ksize);
+    if (isInRange0 && isInRange1) {
+        return 0.5*(_levelset.getSignedDistance(c0) + _levelset.getSignedDistance(c1));
+    } else if (isInRange0) {
+        return _levelset.getSignedDistance(c0);
+    }
+
+    return _levelset.getSignedDistance(c1);
+}
+
+double FluidSimulation::_getExtrapolatedVelocityAlongGradient(int dir, GridIndex g, 
+                                                              int layerIdx,
+                                                              Array3d<int> &layerGrid) {
+    // Upwind discretization of grad(phi) . grad(v) = 0. Velocity is carried
+    // outward from faces of earlier layers that are closer to the fluid 
+    // surface, weighted by how far the distance field decreases from the 
+    // neighbour to this face. Layers are visited in order of distance, so
+    // each layer is a single sweep.
+    GridIndex n[6];
+    Grid3d::getNeighbourGridIndices6(g, n);
+
+    double phi = _getFaceSignedDistance(dir, g);
+    double sum = 0.0;
+    double weightsum = 0.0;
+    double avgsum = 0.0;
+    double avgcount = 0.0;
+    GridIndex c;
+    for (int idx = 0; idx < 6; idx++) {
+        c = n[idx];
+        bool isInRange = dir == 0 ? _MACVelocity.isIndexInRangeU(c) :
+                        (dir == 1 ? _MACVelocity.isIndexInRangeV(c) : 
+                                    _MACVelocity.isIndexInRangeW(c));
+        if (!isInRange) {
+            continue;
+        }
+
+        int layer = _getFaceLayer(dir, c, layerGrid);
+        if (layer < 0 || layer >= layerIdx) {
+            continue;
         }
+
+        double v = dir == 0 ? _MACVelocity.U(c) : 
+                  (dir == 1 ? _MACVelocity.V(c) : _MACVelocity.W(c));
+        avgsum += v;
+        avgcount++;
+
+        // distance is positive inside the fluid
+        double w = _getFaceSignedDistance(dir, c) - phi;
+        if (w > 0.0 && w < std::numeric_limits<double>::infinity()) {
+            sum += w*v;
+            weightsum += w;
+        }
+    }
+
+    if (weightsum > 0.0) {
+        return sum / weightsum;
+    }
+    if (avgcount > 0.0) {
+        return avgsum / avgcount;
     }
 
-    for (unsigned int i = 0; i < tempIndices.size(); i++) {
-        _MACVelocity.setU(tempIndices[i], tempMACVelocityU(tempIndices[i]));
+    return 0.0;
+}
+
+void FluidSimulation::_getExtrapolationFacesU(int idx, std::vector<GridIndex> &cells,
+                                              Array3d<int> &layerGrid,
+                                              std::vector<GridIndex> &faces) {
+    // Faces of the layer cells that do not border the previous layer or a
+    // solid. A face shared by two cells of the layer is taken from the cell
+    // on its positive side.
+    GridIndex g, f;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        f = g;
+        if (!_isFaceBorderingLayerIndexU(f, idx - 1, layerGrid) && 
+                !_isFaceBorderingMaterialU(f.i, f.j, f.k, M_SOLID)) {
+            faces.push_back(f);
+        }
+
+        f = GridIndex(g.i + 1, g.j, g.k);
+        if ((f.i == _isize || layerGrid(f) != idx) &&
+                !_isFaceBorderingLayerIndexU(f, idx - 1, layerGrid) && 
+                !_isFaceBorderingMaterialU(f.i, f.j, f.k, M_SOLID)) {
+            faces.push_back(f);
+        }
     }
 }
 
-void FluidSimulation::_extrapolateVelocitiesForLayerIndexV(int idx, Array3d<int> &layerGrid) {
-    Array3d<float> tempMACVelocityV = Array3d<float>(_isize, _jsize + 1, _ksize);
-    std::vector<GridIndex> tempIndices;
+void FluidSimulation::_getExtrapolationFacesV(int idx, std::vector<GridIndex> &cells,
+                                              Array3d<int> &layerGrid,
+                                              std::vector<GridIndex> &faces) {
+    GridIndex g, f;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        f = g;
+        if (!_isFaceBorderingLayerIndexV(f, idx - 1, layerGrid) && 
+                !_isFaceBorderingMaterialV(f.i, f.j, f.k, M_SOLID)) {
+            faces.push_back(f);
+        }
 
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize + 1; j++) {
-            for (int i = 0; i < _isize; i++) {
-                bool isExtrapolated = _isFaceBorderingLayerIndexV(i, j, k, idx, layerGrid) && 
-                                     !_isFaceBorderingLayerIndexV(i, j, k, idx-1, layerGrid) &&
-                                    (!_isFaceBorderingMaterialV(i, j, k, M_SOLID));
-                if (isExtrapolated) {
-                    double v = _getExtrapolatedVelocityForFaceV(i, j, k, idx, layerGrid);
-                    tempMACVelocityV.set(i, j, k, (float)v);
-                    tempIndices.push_back(GridIndex(i, j, k));
-                }
-            }
+        f = GridIndex(g.i, g.j + 1, g.k);
+        if ((f.j == _jsize || layerGrid(f) != idx) &&
+                !_isFaceBorderingLayerIndexV(f, idx - 1, layerGrid) && 
+                !_isFaceBorderingMaterialV(f.i, f.j, f.k, M_SOLID)) {
+            faces.push_back(f);
         }
     }
+}
 
-    for (unsigned int i = 0; i < tempIndices.size(); i++) {
-        _MACVelocity.setV(tempIndices[i], tempMACVelocityV(tempIndices[i]));
+void FluidSimulation::_getExtrapolationFacesW(int idx, std::vector<GridIndex> &cells,
+                                              Array3d<int> &layerGrid,
+                                              std::vector<GridIndex> &faces) {
+    GridIndex g, f;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        f = g;
+        if (!_isFaceBorderingLayerIndexW(f, idx - 1, layerGrid) && 
+                !_isFaceBorderingMaterialW(f.i, f.j, f.k, M_SOLID)) {
+            faces.push_back(f);
+        }
+
+        f = GridIndex(g.i, g.j, g.k + 1);
+        if ((f.k == _ksize || layerGrid(f) != idx) &&
+                !_isFaceBorderingLayerIndexW(f, idx - 1, layerGrid) && 
+                !_isFaceBorderingMaterialW(f.i, f.j, f.k, M_SOLID)) {
+            faces.push_back(f);
+        }
     }
 }
 
-void FluidSimulation::_extrapolateVelocitiesForLayerIndexW(int idx, Array3d<int> &layerGrid) {
-    Array3d<float> tempMACVelocityW = Array3d<float>(_isize, _jsize, _ksize + 1);
-    std::vector<GridIndex> tempIndices;
+void FluidSimulation::_calculateExtrapolatedFaceVelocities(int dir, int idx,
+                                                           int startidx, int endidx,
+                                                           std::vector<GridIndex> *faces,
+                                                           std::vector<glm::vec3> *surfacePoints,
+                                                           Array3d<int> *layerGrid,
+                                                           std::vector<float> *values) {
+    GridIndex g;
+    double v;
+    for (int i = startidx; i <= endidx; i++) {
+        g = faces->at(i);
+        if (idx > 2 && _isFastVelocityExtrapolationEnabled) {
+            v = _getExtrapolatedVelocityAlongGradient(dir, g, idx, *layerGrid);
+        } else if (idx > 2) {
+            glm::vec3 sv = _getVelocityAtPosition(surfacePoints->at(i));
+            v = dir == 0 ? sv.x : (dir == 1 ? sv.y : sv.z);
+        } else if (dir == 0) {
+            v = _getExtrapolatedVelocityForFaceU(g.i, g.j, g.k, idx, *layerGrid);
+        } else if (dir == 1) {
+            v = _getExtrapolatedVelocityForFaceV(g.i, g.j, g.k, idx, *layerGrid);
+        } else {
+            v = _getExtrapolatedVelocityForFaceW(g.i, g.j, g.k, idx, *layerGrid);
+        }
 
-    for (int k = 0; k < _ksize + 1; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                bool isExtrapolated = _isFaceBorderingLayerIndexW(i, j, k, idx, layerGrid) && 
-                                     !_isFaceBorderingLayerIndexW(i, j, k, idx-1, layerGrid) &&
-                                    (!_isFaceBorderingMaterialW(i, j, k, M_SOLID));
-                if (isExtrapolated) {
-                    double v = _getExtrapolatedVelocityForFaceW(i, j, k, idx, layerGrid);
-                    tempMACVelocityW.set(i, j, k, (float)v);
-                    tempIndices.push_back(GridIndex(i, j, k));
-                }
+        values->at(i) = (float)v;
+    }
+}
+
+void FluidSimulation::_extrapolateFaceVelocities(int dir, int idx, 
+                                                 std::vector<GridIndex> &faces,
+                                                 Array3d<int> &layerGrid) {
+    if (faces.size() == 0) {
+        return;
+    }
+
+    // Faces beyond the averaged layers take the velocity at the nearest
+    // point on the fluid surface. These queries are done as a batch.
+    std::vector<glm::vec3> surfacePoints;
+    if (idx > 2 && !_isFastVelocityExtrapolationEnabled) {
+        std::vector<glm::vec3> positions;
+        positions.reserve(faces.size());
+        for (unsigned int i = 0; i < faces.size(); i++) {
+            GridIndex g = faces[i];
+            if (dir == 0) {
+                positions.push_back(_MACVelocity.velocityIndexToPositionU(g.i, g.j, g.k));
+            } else if (dir == 1) {
+                positions.push_back(_MACVelocity.velocityIndexToPositionV(g.i, g.j, g.k));
+            } else {
+                positions.push_back(_MACVelocity.velocityIndexToPositionW(g.i, g.j, g.k));
             }
         }
+        _levelset.getClosestPointsOnSurface(positions, surfacePoints);
+    }
+
+    // Values are only read from faces of earlier layers, so faces
+    // of this layer can be computed in parallel
+    std::vector<float> values(faces.size(), 0.0f);
+    int numThreads = (int)fmin(_numExtrapolationThreads, faces.size());
+    std::vector<int> startIndices;
+    std::vector<int> endIndices;
+    int chunksize = (int)floor(faces.size() / numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startIdx = (i == 0) ? 0 : endIndices[i - 1] + 1;
+        int endIdx = (i == numThreads - 1) ? (int)faces.size() - 1 : startIdx + chunksize - 1;
+
+        startIndices.push_back(startIdx);
+        endIndices.push_back(endIdx);
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&FluidSimulation::_calculateExtrapolatedFaceVelocities,
+                                      this,
+                                      dir,
+                                      idx,
+                                      startIndices[i],
+                                      endIndices[i],
+                                      &faces,
+                                      &surfacePoints,
+                                      &layerGrid,
+                                      &values));
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
     }
 
-    for (unsigned int i = 0; i < tempIndices.size(); i++) {
-        _MACVelocity.setW(tempIndices[i], tempMACVelocityW(tempIndices[i]));
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        if (dir == 0) {
+            _MACVelocity.setU(faces[i], values[i]);
+        } else if (dir == 1) {
+            _MACVelocity.setV(faces[i], values[i]);
+        } else {
+            _MACVelocity.setW(faces[i], values[i]);
+        }
     }
 }
 
-void FluidSimulation::_extrapolateVelocitiesForLayerIndex(int idx, Array3d<int> &layerGrid) {
-    _extrapolateVelocitiesForLayerIndexU(idx, layerGrid);
-    _extrapolateVelocitiesForLayerIndexV(idx, layerGrid);
-    _extrapolateVelocitiesForLayerIndexW(idx, layerGrid);
+void FluidSimulation::_extrapolateVelocitiesForLayerIndex(int idx, 
+                                                          std::vector<GridIndex> &cells,
+                                                          Array3d<int> &layerGrid) {
+    std::vector<GridIndex> faces;
+    _getExtrapolationFacesU(idx, cells, layerGrid, faces);
+    _extrapolateFaceVelocities(0, idx, faces, layerGrid);
+
+    faces.clear();
+    _getExtrapolationFacesV(idx, cells, layerGrid, faces);
+    _extrapolateFaceVelocities(1, idx, faces, layerGrid);
+
+    faces.clear();
+    _getExtrapolationFacesW(idx, cells, layerGrid, faces);
+    _extrapolateFaceVelocities(2, idx, faces, layerGrid);
 }
 
 void FluidSimulation::_resetExtrapolatedFluidVelocities() {
+    int *mrow0, *mrow1;
+    float *vrow;
     for (int k = 0; k < _ksize; k++) {
         for (int j = 0; j < _jsize; j++) {
+            mrow0 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerU(j, k);
             for (int i = 0; i < _isize + 1; i++) {
-                if (!_isFaceBorderingMaterialU(i, j, k, M_FLUID)) {
-                    _MACVelocity.setU(i, j, k, 0.0);
+                if (!_isFaceBorderingMaterialRowU(mrow0, i, M_FLUID)) {
+                    vrow[i] = 0.0f;
                 }
             }
         }
@@ -2161,9 +3459,12 @@ void FluidSimulation::_resetExtrapolatedFluidVelocities() {
 
     for (int k = 0; k < _ksize; k++) {
         for (int j = 0; j < _jsize + 1; j++) {
+            mrow0 = _getMaterialRow(j - 1, k);
+            mrow1 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerV(j, k);
             for (int i = 0; i < _isize; i++) {
-                if (!_isFaceBorderingMaterialV(i, j, k, M_FLUID)) {
-                    _MACVelocity.setV(i, j, k, 0.0);
+                if (!_isFaceBorderingMaterialRows(mrow0, mrow1, i, M_FLUID)) {
+                    vrow[i] = 0.0f;
                 }
             }
         }
@@ -2171,9 +3472,12 @@ void FluidSimulation::_resetExtrapolatedFluidVelocities() {
 
     for (int k = 0; k < _ksize + 1; k++) {
         for (int j = 0; j < _jsize; j++) {
+            mrow0 = _getMaterialRow(j, k - 1);
+            mrow1 = _getMaterialRow(j, k);
+            vrow = _MACVelocity.getRowPointerW(j, k);
             for (int i = 0; i < _isize; i++) {
-                if (!_isFaceBorderingMaterialW(i, j, k, M_FLUID)) {
-                    _MACVelocity.setW(i, j, k, 0.0);
+                if (!_isFaceBorderingMaterialRows(mrow0, mrow1, i, M_FLUID)) {
+                    vrow[i] = 0.0f;
                 }
             }
         }
@@ -2181,13 +3485,14 @@ void FluidSimulation::_resetExtrapolatedFluidVelocities() {
 }
 
 void FluidSimulation::_extrapolateFluidVelocities() {
-    Array3d<int> layerGrid = Array3d<int>(_isize, _jsize, _ksize, -1);
+    Array3d<int> layerGrid(_isize, _jsize, _ksize, -1);
+    std::vector<std::vector<GridIndex> > layers;
 
     _resetExtrapolatedFluidVelocities();
-    int numLayers = _updateExtrapolationLayers(layerGrid);
+    int numLayers = _updateExtrapolationLayers(layerGrid, layers);
 
     for (int i = 1; i <= numLayers; i++) {
-        _extrapolateVelocitiesForLayerIndex(i, layerGrid);
+        _extrapolateVelocitiesForLayerIndex(i, layers[i], layerGrid);
     }
 }
 
@@ -2558,7 +3863,7 @@ void FluidSimulation::_updateDiffuseMaterial(double dt) {
     UPDATE MARKER PARTICLE VELOCITIES
 ********************************************************************************/
 
-void FluidSimulation::_updateMarkerParticleVelocities(MACVelocityField &savedField) {
+void FluidSimulation::_updateMarkerParticleVelocitiesPICFLIP(MACVelocityField &savedField) {
     MarkerParticle p;
     glm::vec3 vPIC, vFLIP;
     glm::vec3 dv;
@@ -2577,6 +3882,29 @@ void FluidSimulation::_updateMarkerParticleVelocities(MACVelocityField &savedFie
     }
 }
 
+MarkerParticleAffine FluidSimulation::_evaluateAffineVelocityAtPosition(glm::vec3 p) {
+    return MarkerParticleAffine(_MACVelocity.evaluateVelocityGradientU(p),
+                                _MACVelocity.evaluateVelocityGradientV(p),
+                                _MACVelocity.evaluateVelocityGradientW(p));
+}
+
+void FluidSimulation::_updateMarkerParticleVelocitiesAPIC() {
+    glm::vec3 p;
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        p = _markerParticles[i].position;
+        _markerParticles[i].velocity = _MACVelocity.evaluateVelocityAtPositionLinear(p);
+        _markerParticleAffine[i] = _evaluateAffineVelocityAtPosition(p);
+    }
+}
+
+void FluidSimulation::_updateMarkerParticleVelocities(MACVelocityField &savedField) {
+    if (_isAPICVelocityTransferEnabled) {
+        _updateMarkerParticleVelocitiesAPIC();
+    } else {
+        _updateMarkerParticleVelocitiesPICFLIP(savedField);
+    }
+}
+
 /********************************************************************************
     ADVANCE MARKER PARTICLES
 ********************************************************************************/
@@ -2897,11 +4225,18 @@ void FluidSimulation::_advanceRangeOfMarkerParticles(int startIdx, int endIdx, d
 
 void FluidSimulation::_shuffleMarkerParticleOrder() {
     MarkerParticle mi;
+    MarkerParticleAffine ai;
     for (int i = _markerParticles.size() - 2; i >= 0; i--) {
         int j = (rand() % (int)(i - 0 + 1));
         mi = _markerParticles[i];
         _markerParticles[i] = _markerParticles[j];
         _markerParticles[j] = mi;
+
+        if (_isAPICVelocityTransferEnabled) {
+            ai = _markerParticleAffine[i];
+            _markerParticleAffine[i] = _markerParticleAffine[j];
+            _markerParticleAffine[j] = ai;
+        }
     }
 }
 
@@ -2912,8 +4247,52 @@ bool compareByMarkerParticlePosition(const MarkerParticle p1, MarkerParticle p2)
     return false;
 }
 
+bool compareByMarkerParticleAffinePairPosition(
+                    const std::pair<MarkerParticle, MarkerParticleAffine> p1, 
+                    std::pair<MarkerParticle, MarkerParticleAffine> p2) {
+    return compareByMarkerParticlePosition(p1.first, p2.first);
+}
+
 void FluidSimulation::_sortMarkerParticlesByGridIndex() {
-    std::sort(_markerParticles.begin(), _markerParticles.end(), compareByMarkerParticlePosition);
+    if (!_isAPICVelocityTransferEnabled) {
+        std::sort(_markerParticles.begin(), _markerParticles.end(), 
+                  compareByMarkerParticlePosition);
+        return;
+    }
+
+    // Affine velocities follow their particles through the sort
+    std::vector<std::pair<MarkerParticle, MarkerParticleAffine> > pairs;
+    pairs.reserve(_markerParticles.size());
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        pairs.push_back(std::make_pair(_markerParticles[i], _markerParticleAffine[i]));
+    }
+
+    std::sort(pairs.begin(), pairs.end(), compareByMarkerParticleAffinePairPosition);
+
+    for (unsigned int i = 0; i < pairs.size(); i++) {
+        _markerParticles[i] = pairs[i].first;
+        _markerParticleAffine[i] = pairs[i].second;
+    }
+}
+
+void FluidSimulation::_eraseMarkerParticles(std::vector<bool> &isRemoved) {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
+        if (isRemoved[i]) {
+            continue;
+        }
+
+        _markerParticles[count] = _markerParticles[i];
+        if (_isAPICVelocityTransferEnabled) {
+            _markerParticleAffine[count] = _markerParticleAffine[i];
+        }
+        count++;
+    }
+
+    _markerParticles.resize(count);
+    if (_isAPICVelocityTransferEnabled) {
+        _markerParticleAffine.resize(count);
+    }
 }
 
 void FluidSimulation::_removeMarkerParticles() {
@@ -2923,8 +4302,8 @@ void FluidSimulation::_removeMarkerParticles() {
     Array3d<int> countGrid = Array3d<int>(_isize, _jsize, _ksize, 0);
     _shuffleMarkerParticleOrder();
 
-    std::vector<MarkerParticle> aliveParticles;
-    aliveParticles.reserve(_markerParticles.size());
+    std::vector<bool> isRemoved(_markerParticles.size(), false);
+    int dead = 0;
 
     MarkerParticle mp;
     GridIndex g;
@@ -2933,22 +4312,23 @@ void FluidSimulation::_removeMarkerParticles() {
 
         double speedsq = glm::dot(mp.velocity, mp.velocity);
         if (speedsq > maxspeedsq) {
+            isRemoved[i] = true;
+            dead++;
             continue;
         }
 
         g = Grid3d::positionToGridIndex(mp.position, _dx);
         if (countGrid(g) >= _maxMarkerParticlesPerCell) {
+            isRemoved[i] = true;
+            dead++;
             continue;
         }
         countGrid.add(g, 1);
-
-        aliveParticles.push_back(mp);
     }
 
-    int dead = _markerParticles.size() - aliveParticles.size();
     std::cout << "\t\tDEAD: " << dead << std::endl;
 
-    _markerParticles = aliveParticles;
+    _eraseMarkerParticles(isRemoved);
     _sortMarkerParticlesByGridIndex();
 }
 
@@ -3015,14 +4395,20 @@ void FluidSimulation::_stepFluid(double dt) {
     timer1.start();
 
     timer2.start();
+    _updateKinematicSolidObjects(dt);
     _updateFluidCells();
+    if (_isMarkerParticleReseedingEnabled) {
+        _reseedMarkerParticles();
+    }
     timer2.stop();
 
     _logfile.log("Update Fluid Cells:          \t", timer4.getTime(), 4);
     _logfile.log("Num Fluid Cells: \t", (int)_fluidCellIndices.size(), 4, 1);
 
     timer3.start();
-    _reconstructFluidSurface();
+    if (_isFluidSurfaceMeshRequired()) {
+        _reconstructFluidSurface();
+    }
     timer3.stop();
 
     _logfile.log("Reconstruct Fluid Surface:  \t", timer3.getTime(), 4);
@@ -3042,7 +4428,7 @@ void FluidSimulation::_stepFluid(double dt) {
     _logfile.log("Reconstruct Output Surface: \t", timer5.getTime(), 4);
 
     timer6.start();
-    _advectVelocityField();
+    _advectVelocityField(dt);
     timer6.stop();
 
     _logfile.log("Advect Velocity Field:       \t", timer6.getTime(), 4);
@@ -3180,6 +4566,7 @@ void FluidSimulation::update(double dt) {
             timestep = timeleft;
         }
         timeleft -= timestep;
+        _frameTimeLeft = timeleft;
 
         double eps = 10e-9;
         _isLastTimeStepForFrame = fabs(timeleft) < eps;
@@ -55,6 +55,8 @@ freely, subject to the following restrictions:
 #include "cuboidfluidsource.h"
 #include "turbulencefield.h"
 #include "fluidbrickgrid.h"
+#include "kinematicsolidobject.h"
+#include "meshdecimator.h"
 #include "glm/glm.hpp"
 
 struct MarkerParticle {
@@ -75,6 +77,21 @@ struct MarkerParticle {
                                   velocity(0.0, 0.0, 0.0) {}
 };
 
+// APIC affine velocity of a marker particle. Each vector is the gradient
+// of one velocity component.
+struct MarkerParticleAffine {
+    glm::vec3 U;
+    glm::vec3 V;
+    glm::vec3 W;
+
+    MarkerParticleAffine() : U(0.0, 0.0, 0.0), 
+                             V(0.0, 0.0, 0.0), 
+                             W(0.0, 0.0, 0.0) {}
+
+    MarkerParticleAffine(glm::vec3 u, glm::vec3 v, glm::vec3 w) : 
+                             U(u), V(v), W(w) {}
+};
+
 struct DiffuseParticle {
     glm::vec3 position;
     glm::vec3 velocity;
@@ -125,6 +142,33 @@ public:
     void disableSurfaceMeshOutput();
     void enableDiffuseMaterialOutput();
     void disableDiffuseMaterialOutput();
+    void enableAPICVelocityTransfer();
+    void disableAPICVelocityTransfer();
+    void enableMarkerParticleReseeding();
+    void disableMarkerParticleReseeding();
+    void setMarkerParticleReseedingTarget(int particlesPerCell);
+    void enableNarrowBandFLIP();
+    void disableNarrowBandFLIP();
+    // Width is limited to one cell less than the depth of the level set, 
+    // ceil(CFL) + 3 cells
+    void setNarrowBandWidth(double numCells);
+    void enableLevelSetFastMarching();
+    void disableLevelSetFastMarching();
+    void enableIncrementalLevelSet();
+    void disableIncrementalLevelSet();
+    void enableFastVelocityExtrapolation();
+    void disableFastVelocityExtrapolation();
+    void enableOutputSurfaceSlabPolygonization();
+    void enableOutputSurfaceSlabPolygonization(int slabDepth);
+    void disableOutputSurfaceSlabPolygonization();
+    void enableSurfaceMeshDecimation();
+    void enableSurfaceMeshDecimation(double maxError);
+    void disableSurfaceMeshDecimation();
+    void enableAdaptiveSurfacePolygonization();
+    void enableAdaptiveSurfacePolygonization(double tolerance);
+    void disableAdaptiveSurfacePolygonization();
+    void enableParticleLevelSet();
+    void disableParticleLevelSet();
     void enableBrickOutput();
     void enableBrickOutput(double width, double height, double depth);
     void disableBrickOutput();
@@ -159,6 +203,10 @@ public:
     std::vector<glm::vec3> getSolidCells();
     std::vector<glm::vec3> getSolidCellPositions();
 
+    KinematicSolidObject *addKinematicSolidObject(TriangleMesh mesh);
+    KinematicSolidObject *addKinematicSolidObject(std::string OBJFilename, double scale);
+    void removeKinematicSolidObject(KinematicSolidObject *obj);
+
     unsigned int getNumMarkerParticles();
     std::vector<glm::vec3> getMarkerParticlePositions();
     std::vector<glm::vec3> getMarkerParticleVelocities();
@@ -166,7 +214,7 @@ public:
     Array3d<float> getDensityGrid();
     MACVelocityField* getVelocityField();
     LevelSet* getLevelSet();
-    TriangleMesh* getFluidSurfaceTriangles();
+    const TriangleMesh* getFluidSurfaceTriangles();
 
 private:
 
@@ -289,7 +337,23 @@ private:
     void _updateFluidSources();
     void _updateFluidSource(FluidSource *source);
     void _addNewFluidCells(std::vector<GridIndex> &cells, glm::vec3 velocity);
+    void _addMarkerParticle(MarkerParticle mp);
     void _removeMarkerParticlesFromCells(std::vector<GridIndex> &cells);
+    bool _isFluidSurfaceCell(int i, int j, int k);
+
+    // Add marker particles to under-sampled fluid cells and remove marker
+    // particles from over-sampled fluid cells
+    void _reseedMarkerParticles();
+    void _reseedMarkerParticlesInCell(GridIndex g, int numParticles);
+    void _removeMarkerParticlesFromOverSampledCells(Array3d<int> &countGrid);
+    bool _isCellInteriorFluid(GridIndex g);
+
+    // Narrow band FLIP. Marker particles are only kept within a band
+    // of the liquid surface. Fluid cells deeper than the band are
+    // particle-free and carried by the grid velocity field.
+    void _updateNarrowBandParticles();
+    void _advectParticleFreeVelocities(MACVelocityField &prevMACVelocity, double dt);
+    double _advectFaceVelocity(MACVelocityField &prevMACVelocity, glm::vec3 p, int dir, double dt);
     inline bool _isIndexInList(GridIndex g, std::vector<GridIndex> &list) {
         GridIndex c;
         for (unsigned int idx = 0; idx < list.size(); idx++) {
@@ -301,12 +365,40 @@ private:
         return false;
     }
 
+    // Move kinematic solid objects. Only cells that an object has entered
+    // or left since the previous time step are updated in the material grid
+    int _getUniqueKinematicSolidObjectID();
+    void _updateKinematicSolidObjects(double dt);
+    void _addKinematicSolidCells(std::vector<GridIndex> &cells);
+    void _removeKinematicSolidCells(std::vector<GridIndex> &cells);
+    void _updateKinematicSolidVelocities(KinematicSolidObject *obj,
+                                         std::vector<GridIndex> &removedCells, 
+                                         double dt);
+    void _setKinematicSolidCellFaceVelocities(GridIndex g, KinematicSolidObject *obj, 
+                                              double dt);
+    void _clearKinematicSolidCellFaceVelocities(GridIndex g);
+    bool _isCellKinematicSolid(int i, int j, int k);
+    void _displaceMarkerParticlesFromKinematicSolids(std::vector<GridIndex> &addedCells,
+                                                     double dt);
+
+    // Each cell stores a bit mask of which cells in its surrounding 3x3x3
+    // block are solid. Masks are updated only around cells that change.
+    void _initializeNearSolidCellMasks();
+    void _updateNearSolidCellMasks(GridIndex g);
+    inline int _getNearSolidCellMaskBit(int di, int dj, int dk) {
+        return 1 << ((di + 1) + 3*(dj + 1) + 9*(dk + 1));
+    }
+
     // Convert marker particles to fluid surface
     void _reconstructFluidSurface();
     TriangleMesh _polygonizeSurface();
+    bool _isParticleLevelSetInUse();
+    bool _isFluidSurfaceMeshRequired();
 
     // Update level set surface
     void _updateLevelSetSignedDistance();
+    int _getNumLevelSetLayers();
+    void _updateLevelSetSignedDistanceFromParticles(int numLayers);
 
     // Reconstruct output fluid surface
     void _reconstructOutputFluidSurface(double dt);
@@ -318,17 +410,30 @@ private:
     void _writeBrickColorListToFile(TriangleMesh &mesh, std::string filename);
     void _writeBrickMaterialToFile(std::string brickfile, std::string colorfile);
     void _smoothSurfaceMesh(TriangleMesh &mesh);
+    void _decimateSurfaceMesh(TriangleMesh &mesh);
     void _getSmoothVertices(TriangleMesh &mesh, std::vector<int> &smoothVertices);
     bool _isVertexNearSolid(glm::vec3 v, double eps);
     void _updateSmoothTriangleList(TriangleMesh &mesh, std::vector<int> &smoothVertices);
     TriangleMesh _polygonizeOutputSurface();
+    TriangleMesh _polygonizeOutputSurfaceInSlabs();
+    TriangleMesh _polygonizeOutputSlab(int kmin, int kmax, std::vector<glm::vec3> &particles,
+                                       std::vector<int> &binOffsets);
+    void _sortOutputParticlesByLayer(std::vector<glm::vec3> &particles, 
+                                     std::vector<int> &binOffsets);
+    void _appendOutputSlabMesh(TriangleMesh &slabMesh, TriangleMesh &mesh);
     void _getSubdividedSurfaceCells(std::vector<GridIndex> &cells);
+    void _getSubdividedSurfaceCells(int kmin, int kmax, std::vector<GridIndex> &cells);
     void _getSubdividedSolidCells(std::vector<GridIndex> &cells);
+    void _getSubdividedSolidCells(int kmin, int kmax, std::vector<GridIndex> &cells);
     void _getOutputSurfaceParticles(std::vector<glm::vec3> &particles);
+    void _updateSurfaceCellBand();
+    int _getOutputSurfaceCellBandRadius();
+    int _getOutputSurfaceParticleBandRadius();
+    int _getOutputSolidCellBandRadius();
     void _updateBrickGrid(double dt);
 
     // Advect fluid velocities
-    void _advectVelocityField();
+    void _advectVelocityField(double dt);
     void _advectVelocityFieldU();
     void _advectVelocityFieldV();
     void _advectVelocityFieldW();
@@ -344,19 +449,41 @@ private:
     // outside of current fluid region
     void _extrapolateFluidVelocities();
     void _resetExtrapolatedFluidVelocities();
-    int _updateExtrapolationLayers(Array3d<int> &layerGrid);
-    void _updateExtrapolationLayer(int layerIndex, Array3d<int> &layerGrid);
-    void _extrapolateVelocitiesForLayerIndex(int layerIndex, Array3d<int> &layerGrid);
-    void _extrapolateVelocitiesForLayerIndexU(int layerIndex, Array3d<int> &layerGrid);
-    void _extrapolateVelocitiesForLayerIndexV(int layerIndex, Array3d<int> &layerGrid);
-    void _extrapolateVelocitiesForLayerIndexW(int layerIndex, Array3d<int> &layerGrid);
+    int _updateExtrapolationLayers(Array3d<int> &layerGrid, 
+                                   std::vector<std::vector<GridIndex> > &layers);
+    void _updateExtrapolationLayer(int layerIndex, std::vector<GridIndex> &frontier,
+                                                   std::vector<GridIndex> &layer,
+                                                   Array3d<int> &layerGrid);
+    void _findExtrapolationLayerCandidates(int startidx, int endidx,
+                                           std::vector<GridIndex> *frontier,
+                                           Array3d<int> *layerGrid,
+                                           std::vector<GridIndex> *candidates);
+    void _extrapolateVelocitiesForLayerIndex(int layerIndex, std::vector<GridIndex> &cells,
+                                                             Array3d<int> &layerGrid);
+    void _getExtrapolationFacesU(int layerIndex, std::vector<GridIndex> &cells,
+                                 Array3d<int> &layerGrid, std::vector<GridIndex> &faces);
+    void _getExtrapolationFacesV(int layerIndex, std::vector<GridIndex> &cells,
+                                 Array3d<int> &layerGrid, std::vector<GridIndex> &faces);
+    void _getExtrapolationFacesW(int layerIndex, std::vector<GridIndex> &cells,
+                                 Array3d<int> &layerGrid, std::vector<GridIndex> &faces);
+    void _extrapolateFaceVelocities(int dir, int layerIndex, std::vector<GridIndex> &faces,
+                                    Array3d<int> &layerGrid);
+    void _calculateExtrapolatedFaceVelocities(int dir, int layerIndex,
+                                              int startidx, int endidx,
+                                              std::vector<GridIndex> *faces,
+                                              std::vector<glm::vec3> *surfacePoints,
+                                              Array3d<int> *layerGrid,
+                                              std::vector<float> *values);
+    double _getExtrapolatedVelocityAlongGradient(int dir, GridIndex g, int layerIndex,
+                                                 Array3d<int> &layerGrid);
+    int _getFaceLayer(int dir, GridIndex g, Array3d<int> &layerGrid);
+    double _getFaceSignedDistance(int dir, GridIndex g);
     double _getExtrapolatedVelocityForFaceU(int i, int j, int k, int layerIndex,
                                             Array3d<int> &layerGrid);
     double _getExtrapolatedVelocityForFaceV(int i, int j, int k, int layerIndex,
                                             Array3d<int> &layerGrid);
     double _getExtrapolatedVelocityForFaceW(int i, int j, int k, int layerIndex,
                                             Array3d<int> &layerGrid);
-    glm::vec3 _getVelocityAtNearestPointOnFluidSurface(glm::vec3 p);
     glm::vec3 _getVelocityAtPosition(glm::vec3 p);
 
     // Calculate pressure values to satisfy incompressibility condition
@@ -426,11 +553,15 @@ private:
 
     // Transfer grid velocity to marker particles
     void _updateMarkerParticleVelocities(MACVelocityField &savedField);
+    void _updateMarkerParticleVelocitiesPICFLIP(MACVelocityField &savedField);
+    void _updateMarkerParticleVelocitiesAPIC();
+    MarkerParticleAffine _evaluateAffineVelocityAtPosition(glm::vec3 p);
 
     // Move marker particles through the velocity field
     void _advanceMarkerParticles(double dt);
     void _advanceRangeOfMarkerParticles(int startIdx, int endIdx, double dt);
     void _removeMarkerParticles();
+    void _eraseMarkerParticles(std::vector<bool> &isRemoved);
     void _shuffleMarkerParticleOrder();
     void _sortMarkerParticlesByGridIndex();
 
@@ -458,6 +589,16 @@ private:
     inline bool _isCellAir(GridIndex g) { return _materialGrid(g) == M_AIR; }
     inline bool _isCellFluid(GridIndex g) { return _materialGrid(g) == M_FLUID; }
     inline bool _isCellSolid(GridIndex g) { return _materialGrid(g) == M_SOLID; }
+
+    inline float _getSolidFaceVelocityU(int i, int j, int k) {
+        return _isKinematicSolidInSimulation ? _solidVelocity.U(i, j, k) : 0.0f;
+    }
+    inline float _getSolidFaceVelocityV(int i, int j, int k) {
+        return _isKinematicSolidInSimulation ? _solidVelocity.V(i, j, k) : 0.0f;
+    }
+    inline float _getSolidFaceVelocityW(int i, int j, int k) {
+        return _isKinematicSolidInSimulation ? _solidVelocity.W(i, j, k) : 0.0f;
+    }
     
 
     inline bool _isFaceBorderingGridValueU(int i, int j, int k, int value, Array3d<int> &grid) {
@@ -486,6 +627,19 @@ private:
         return _isFaceBorderingGridValueW(g.i, g.j, g.k, value, grid);
     }
 
+    // Row access for loops over the velocity grids. A material row is NULL
+    // when (j, k) is outside of the grid.
+    inline int* _getMaterialRow(int j, int k) {
+        if (j < 0 || k < 0 || j >= _jsize || k >= _ksize) { return NULL; }
+        return _materialGrid.getRowPointer(j, k);
+    }
+    inline bool _isFaceBorderingMaterialRowU(int *row, int i, int mat) {
+        return (i > 0 && row[i - 1] == mat) || (i < _isize && row[i] == mat);
+    }
+    inline bool _isFaceBorderingMaterialRows(int *row0, int *row1, int i, int mat) {
+        return (row0 != NULL && row0[i] == mat) || (row1 != NULL && row1[i] == mat);
+    }
+
     inline bool _isFaceBorderingMaterialU(int i, int j, int k, int mat) {
         return _isFaceBorderingGridValueU(i, j, k, mat, _materialGrid);
     }
@@ -543,6 +697,7 @@ private:
     int _currentFrame = 0;
     int _currentTimeStep = 0;
     double _frameTimeStep = 0.0;
+    double _frameTimeLeft = 0.0;
     bool _isCurrentFrameFinished = true;
     bool _isLastTimeStepForFrame = false;
     double _simulationTime = 0;
@@ -562,6 +717,7 @@ private:
     double _pressureSolveTolerance = 10e-6;
     int _maxPressureSolveIterations = 150;
     int _numAdvanceMarkerParticleThreads = 8;
+    int _numExtrapolationThreads = 8;
 
     double _surfaceReconstructionSmoothingValue = 0.85;
     int _surfaceReconstructionSmoothingIterations = 3;
@@ -571,10 +727,19 @@ private:
     int _outputFluidSurfaceSubdivisionLevel = 1;
     double _outputFluidSurfaceCellNarrowBandSize = 0.5;
     double _outputFluidSurfaceParticleNarrowBandSize = 1.0;
+    int _outputSurfaceSlabDepth = 16;         // in number of grid cells
+    double _outputSlabWeldTolerance = 10e-7;  // in number of output grid cells
+    double _adaptiveSurfacePolygonizationTolerance = 0.1;  // in number of grid cells
+    double _surfaceMeshDecimationError = 0.05;  // in number of output grid cells
+    double _surfaceMeshDecimationNormalDeviation = 0.35;  // in radians
 
     double _diffuseSurfaceNarrowBandSize = 0.25; // size in # of cells
-    double _minWavecrestCurvature = 0.20;
-    double _maxWavecrestCurvature = 1.0;
+
+    // Curvatures are the level set mean curvature scaled by the cell size. 
+    // A sphere with a radius of r cells has a curvature of 2/r and concave 
+    // regions are negative.
+    double _minWavecrestCurvature = 0.10;     // radius of 20 cells
+    double _maxWavecrestCurvature = 0.25;     // radius of 8 cells
     double _minParticleEnergy = 0.0;
     double _maxParticleEnergy = 20.0;
     double _minTurbulence = 100.0;
@@ -586,7 +751,7 @@ private:
     double _minBubbleToSurfaceDistance = 1.0; // in number of grid cells
     double _bubbleBouyancyCoefficient = 4.0;
     double _bubbleDragCoefficient = 1.0;
-    double _maxFlatCurvature = 0.05;
+    double _maxFlatCurvature = 0.05;          // radius of 40 cells
 
     double _minBrickNeighbourRatio = 0.10;
     double _maxBrickNeighbourRatio = 0.50;
@@ -596,8 +761,27 @@ private:
     int _maxInactiveBrickFrames = 0;
 
     double _ratioPICFLIP = 0.35f;
+    bool _isAPICVelocityTransferEnabled = false;
     int _maxMarkerParticlesPerCell = 50;
 
+    bool _isMarkerParticleReseedingEnabled = false;
+    int _reseedTargetParticlesPerCell = 8;
+    int _reseedMinParticlesPerCell = 4;
+    int _reseedMaxParticlesPerCell = 16;
+
+    bool _isNarrowBandFLIPEnabled = false;
+    double _narrowBandWidth = 6.0;            // in number of grid cells
+    int _narrowBandReseedParticlesPerCell = 8;
+    std::vector<GridIndex> _particleFreeFluidCells;
+
+    bool _isLevelSetFastMarchingEnabled = false;
+    bool _isIncrementalLevelSetEnabled = false;
+    bool _isFastVelocityExtrapolationEnabled = false;
+    bool _isParticleLevelSetEnabled = false;
+    bool _isOutputSurfaceSlabPolygonizationEnabled = false;
+    bool _isSurfaceMeshDecimationEnabled = false;
+    bool _isAdaptiveSurfacePolygonizationEnabled = false;
+
     bool _isSurfaceMeshOutputEnabled = true;
     bool _isDiffuseMaterialOutputEnabled = false;
     bool _isBrickOutputEnabled = false;
@@ -614,13 +798,30 @@ private:
     std::string _fluidMeshFilename;
     glm::vec3 _fluidMeshOffset;
     double _fluidMeshScale = 1.0;
+    double _loadedMeshWeldTolerance = 10e-4;  // in number of grid cells
 
     MACVelocityField _MACVelocity;
     Array3d<int> _materialGrid;
     std::vector<MarkerParticle> _markerParticles;
+
+    // Parallel to _markerParticles while APIC transfer is enabled and
+    // empty otherwise
+    std::vector<MarkerParticleAffine> _markerParticleAffine;
     std::vector<GridIndex> _fluidCellIndices;
+    Array3d<int> _nearSolidCellMasks;
+
+    // Fluid cells that border a non-fluid cell, found in _updateFluidCells.
+    // The band stores the distance in cells from the nearest surface cell
+    // (-1 outside of the band) so that the output surface can be gathered
+    // without scanning the whole domain.
+    std::vector<GridIndex> _surfaceCellIndices;
+    std::vector<GridIndex> _surfaceCellBandIndices;
+    Array3d<int> _surfaceCellBandDistances;
+    int _surfaceCellBandRadius = 0;
+    bool _isSurfaceCellBandOutdated = true;
+
     LogFile _logfile;
-    TriangleMesh _surfaceMesh;
+    TriangleMeshSnapshot _surfaceMesh = std::make_shared<const TriangleMesh>();
     LevelSet _levelset;
     std::vector<bool> _isSurfaceTriangleSmooth;
     
@@ -630,6 +831,13 @@ private:
     std::vector<SphericalFluidSource*> _sphericalFluidSources;
     std::vector<CuboidFluidSource*> _cuboidFluidSources;
     int _uniqueFluidSourceID = 0;
+
+    std::vector<KinematicSolidObject*> _kinematicSolidObjects;
+    int _uniqueKinematicSolidObjectID = 0;
+    bool _isKinematicSolidInSimulation = false;
+    Array3d<int> _kinematicSolidCellCounts;
+    Array3d<bool> _isNewKinematicSolidCell;   // only set during displacement
+    MACVelocityField _solidVelocity;
     TurbulenceField _turbulenceField;
     std::vector<DiffuseParticle> _diffuseParticles;
 
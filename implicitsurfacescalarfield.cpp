@@ -28,7 +28,6 @@ ImplicitSurfaceScalarField::ImplicitSurfaceScalarField(int i, int j, int k, doub
                                                        _isize(i), _jsize(j), _ksize(k), _dx(dx),
                                                        _field(i, j, k, 0.0),
                                                        _centerField(0, 0, 0, 0.0),
-                                                       _isVertexSolid(i, j, k, false),
                                                        _weightField(0, 0, 0, 0.0),
                                                        _weightCountField(0, 0, 0, 0){
 }
@@ -39,6 +38,8 @@ ImplicitSurfaceScalarField::~ImplicitSurfaceScalarField() {
 void ImplicitSurfaceScalarField::clear() {
     _field.fill(0.0);
     _centerField.fill(0.0);
+    _touchedVertices.clear();
+    _surfaceCells.clear();
 }
 
 void ImplicitSurfaceScalarField::setPointRadius(double r) {
@@ -70,6 +71,10 @@ void ImplicitSurfaceScalarField::enableWeightField() {
     _isWeightFieldEnabled = true;
 }
 
+void ImplicitSurfaceScalarField::enableSurfaceCellDetection() {
+    _isSurfaceCellDetectionEnabled = true;
+}
+
 void ImplicitSurfaceScalarField::applyWeightField() {
     if (!_isWeightFieldEnabled) {
         return;
@@ -122,7 +127,94 @@ void ImplicitSurfaceScalarField::addPoint(glm::vec3 p, double r) {
 void ImplicitSurfaceScalarField::addPoint(glm::vec3 p) {
     GridIndex gmin, gmax;
     Grid3d::getGridIndexBounds(p, _radius, _dx, _isize, _jsize, _ksize, &gmin, &gmax);
+    _addPoint(p, gmin, gmax, _isSurfaceCellDetectionEnabled ? &_touchedVertices : NULL);
+}
+
+/*
+    Points are binned by the k index of the grid layer they fall in. Each
+    thread splats into its own range of k layers, using only the bins within
+    a point radius of that range, so no two threads write the same value.
+    If surface cell detection is enabled, each thread records the vertices
+    that its splats touch for the first time. Only the cells around those
+    vertices can straddle the surface threshold, and they are classified
+    once all points are splatted. Points and cuboids should be added before
+    this call for the surface cells to account for them.
+*/
+void ImplicitSurfaceScalarField::addPoints(std::vector<glm::vec3> &points) {
+    std::vector<int> binOffsets(_ksize + 1, 0);
+    std::vector<int> binIndices(points.size());
+    std::vector<int> pointBins(points.size());
+
+    int k;
+    for (unsigned int i = 0; i < points.size(); i++) {
+        k = (int)floor(points[i].z / _dx);
+        k = k < 0 ? 0 : k;
+        k = k > _ksize - 1 ? _ksize - 1 : k;
+        pointBins[i] = k;
+        binOffsets[k + 1]++;
+    }
+    for (int i = 0; i < _ksize; i++) {
+        binOffsets[i + 1] += binOffsets[i];
+    }
+
+    std::vector<int> cursor(binOffsets.begin(), binOffsets.end() - 1);
+    for (unsigned int i = 0; i < points.size(); i++) {
+        binIndices[cursor[pointBins[i]]++] = i;
+    }
+
+    int numThreads = (int)fmin(_numSplatThreads, _ksize);
+    numThreads = numThreads < 1 ? 1 : numThreads;
+    std::vector<std::thread> threads(numThreads);
+    std::vector<std::vector<GridIndex> > threadVertices(numThreads);
+    int chunksize = (int)floor((double)_ksize / (double)numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startk = i*chunksize;
+        int endk = i == numThreads - 1 ? _ksize - 1 : startk + chunksize - 1;
+        std::vector<GridIndex> *touched = NULL;
+        if (_isSurfaceCellDetectionEnabled) {
+            touched = &(threadVertices[i]);
+        }
+        threads[i] = std::thread(&ImplicitSurfaceScalarField::_addPointsInSlab, this,
+                                 startk, endk, &points, &binOffsets, &binIndices, touched);
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+        _touchedVertices.insert(_touchedVertices.end(), 
+                                threadVertices[i].begin(), threadVertices[i].end());
+    }
+
+    if (_isSurfaceCellDetectionEnabled) {
+        _findSurfaceCells();
+    }
+}
+
+void ImplicitSurfaceScalarField::_addPointsInSlab(int startk, int endk, 
+                                                  std::vector<glm::vec3> *points,
+                                                  std::vector<int> *binOffsets, 
+                                                  std::vector<int> *binIndices,
+                                                  std::vector<GridIndex> *touchedVertices) {
+    double rcells = _radius / _dx;
+    int startbin = (int)fmax(floor(startk - rcells), 0);
+    int endbin = (int)fmin(floor(endk + rcells), _ksize - 1);
+
+    glm::vec3 p;
+    GridIndex gmin, gmax;
+    for (int idx = binOffsets->at(startbin); idx < binOffsets->at(endbin + 1); idx++) {
+        p = points->at(binIndices->at(idx));
+        Grid3d::getGridIndexBounds(p, _radius, _dx, _isize, _jsize, _ksize, &gmin, &gmax);
+        gmin.k = (int)fmax(gmin.k, startk);
+        gmax.k = (int)fmin(gmax.k, endk);
+        if (gmin.k > gmax.k) {
+            continue;
+        }
+
+        _addPoint(p, gmin, gmax, touchedVertices);
+    }
+}
 
+void ImplicitSurfaceScalarField::_addPoint(glm::vec3 p, GridIndex gmin, GridIndex gmax,
+                                           std::vector<GridIndex> *touchedVertices) {
     glm::vec3 gpos;
     glm::vec3 v;
     double rsq = _radius*_radius;
@@ -141,6 +233,9 @@ void ImplicitSurfaceScalarField::addPoint(glm::vec3 p) {
                         weight = _evaluateTrilinearFieldFunction(v);
                     }
 
+                    if (touchedVertices != NULL && _field(i, j, k) == 0.0f) {
+                        touchedVertices->push_back(GridIndex(i, j, k));
+                    }
                     _field.add(i, j, k, (float)weight);
 
                     if (_isWeightFieldEnabled) {
@@ -198,6 +293,45 @@ void ImplicitSurfaceScalarField::addPointValue(glm::vec3 p, double scale) {
 
 }
 
+// Value at each grid point is extrapolated from the point using a gradient
+void ImplicitSurfaceScalarField::addPointValue(glm::vec3 p, double scale, 
+                                               glm::vec3 gradient) {
+    GridIndex gmin, gmax;
+    Grid3d::getGridIndexBounds(p, _radius, _dx, _isize, _jsize, _ksize, &gmin, &gmax);
+
+    glm::vec3 gpos;
+    glm::vec3 v;
+    double rsq = _radius*_radius;
+    double distsq;
+    double weight;
+    double value;
+    for (int k = gmin.k; k <= gmax.k; k++) {
+        for (int j = gmin.j; j <= gmax.j; j++) {
+            for (int i = gmin.i; i <= gmax.i; i++) {
+                gpos = Grid3d::GridIndexToPosition(i, j, k, _dx);
+                v = gpos - p;
+                distsq = glm::dot(v, v);
+                if (distsq < rsq) {
+                    if (_weightType == WEIGHT_TRICUBIC) {
+                        weight = _evaluateTricubicFieldFunctionForRadiusSquared(distsq);
+                    } else {
+                        weight = _evaluateTrilinearFieldFunction(v);
+                    }
+
+                    value = scale + glm::dot(gradient, v);
+                    _field.add(i, j, k, (float)(weight*value));
+
+                    if (_isWeightFieldEnabled) {
+                        _weightField.add(i, j, k, (float)weight);
+                        _weightCountField.add(i, j, k, 1);
+                    }
+                }
+            }
+        }
+    }
+
+}
+
 void ImplicitSurfaceScalarField::addCuboid(glm::vec3 pos, double w, double h, double d) {
     GridIndex gmin = Grid3d::positionToGridIndex(pos, _dx);
     GridIndex gmax = Grid3d::positionToGridIndex(pos + glm::vec3(w, h, d), _dx);
@@ -210,6 +344,9 @@ void ImplicitSurfaceScalarField::addCuboid(glm::vec3 pos, double w, double h, do
             for (int i = gmin.i; i <= gmax.i; i++) {
                 gpos = Grid3d::GridIndexToPosition(i, j, k, _dx);
                 if (bbox.isPointInside(gpos)) {
+                    if (_isSurfaceCellDetectionEnabled && _field(i, j, k) == 0.0f) {
+                        _touchedVertices.push_back(GridIndex(i, j, k));
+                    }
                     _field.add(i, j, k, (float)(_surfaceThreshold + eps));
 
                     if (_isWeightFieldEnabled) {
@@ -231,19 +368,91 @@ void ImplicitSurfaceScalarField::setMaterialGrid(Array3d<int> &matGrid) {
            matGrid.height == _jsize-1 && 
            matGrid.depth == _ksize-1);
 
+    _materialGrid = &matGrid;
+}
+
+void ImplicitSurfaceScalarField::getSurfaceCells(std::vector<GridIndex> &cells) {
+    cells.insert(cells.end(), _surfaceCells.begin(), _surfaceCells.end());
+}
+
+/*
+    Untouched vertices have a value of zero and are outside of the surface,
+    so a surface cell must have at least one touched vertex.
+*/
+void ImplicitSurfaceScalarField::_findSurfaceCells() {
+    _surfaceCells.clear();
+    if (_isize <= 1 || _jsize <= 1 || _ksize <= 1) {
+        return;
+    }
+
+    Array3d<bool> isCandidate(_isize - 1, _jsize - 1, _ksize - 1, false);
+    GridIndex cells[8];
+    GridIndex c;
+    for (unsigned int i = 0; i < _touchedVertices.size(); i++) {
+        Grid3d::getVertexGridIndexNeighbours(_touchedVertices[i], cells);
+        for (int idx = 0; idx < 8; idx++) {
+            c = cells[idx];
+            if (!isCandidate.isIndexInRange(c) || isCandidate(c)) {
+                continue;
+            }
+
+            isCandidate.set(c, true);
+            if (_isCellOnSurface(c.i, c.j, c.k)) {
+                _surfaceCells.push_back(c);
+            }
+        }
+    }
+}
+
+bool ImplicitSurfaceScalarField::_isCellOnSurface(int i, int j, int k) {
     GridIndex vertices[8];
-    for (int k = 0; k < _ksize-1; k++) {
-        for (int j = 0; j < _jsize-1; j++) {
-            for (int i = 0; i < _isize-1; i++) {
-                if (matGrid(i, j, k) == M_SOLID) {
-                    Grid3d::getGridIndexVertices(i, j, k, vertices);
-                    for (int idx = 0; idx < 8; idx++) {
-                        _isVertexSolid.set(vertices[idx], true);
-                    }
+    Grid3d::getGridIndexVertices(i, j, k, vertices);
+
+    bool hasInside = false;
+    bool hasOutside = false;
+    for (int idx = 0; idx < 8; idx++) {
+        GridIndex v = vertices[idx];
+        if (_getClampedFieldValue(v.i, v.j, v.k) > _surfaceThreshold) {
+            hasInside = true;
+        } else {
+            hasOutside = true;
+        }
+    }
+
+    return hasInside && hasOutside;
+}
+
+/*
+    A vertex is solid if any of the cells that it is a corner of is solid.
+    The material grid is read in place instead of being copied into a
+    vertex grid.
+*/
+bool ImplicitSurfaceScalarField::_isVertexSolid(int i, int j, int k) {
+    if (_materialGrid == NULL) {
+        return false;
+    }
+
+    for (int ck = k - 1; ck <= k; ck++) {
+        for (int cj = j - 1; cj <= j; cj++) {
+            for (int ci = i - 1; ci <= i; ci++) {
+                if (_materialGrid->isIndexInRange(ci, cj, ck) && 
+                        (*_materialGrid)(ci, cj, ck) == M_SOLID) {
+                    return true;
                 }
             }
         }
     }
+
+    return false;
+}
+
+double ImplicitSurfaceScalarField::_getClampedFieldValue(int i, int j, int k) {
+    double val = _field(i, j, k);
+    if (val > _surfaceThreshold && _isVertexSolid(i, j, k)) {
+        val = _surfaceThreshold;
+    }
+
+    return val;
 }
 
 void ImplicitSurfaceScalarField::getWeightField(Array3d<float> &field) {
@@ -269,16 +478,10 @@ void ImplicitSurfaceScalarField::getScalarField(Array3d<float> &field) {
            field.height == _field.height && 
            field.depth == _field.depth);
 
-    double val;
     for (int k = 0; k < field.depth; k++) {
         for (int j = 0; j < field.height; j++) {
             for (int i = 0; i < field.width; i++) {
-                val = _field(i, j, k);
-                if (_isVertexSolid(i, j, k) && val > _surfaceThreshold) {
-                    val = _surfaceThreshold;
-                } 
-
-                field.set(i, j, k, (float)val);
+                field.set(i, j, k, (float)_getClampedFieldValue(i, j, k));
             }
         }
     }
@@ -21,6 +21,8 @@ freely, subject to the following restrictions:
 
 #include <stdio.h>
 #include <iostream>
+#include <vector>
+#include <thread>
 
 #include "glm/glm.hpp"
 #include "array3d.h"
@@ -41,15 +43,19 @@ public:
     void setPointRadius(double r);
     void enableCellCenterValues();
     void enableWeightField();
+    void enableSurfaceCellDetection();
     void applyWeightField();
     void addPoint(glm::vec3 pos, double radius);
     void addPoint(glm::vec3 pos);
+    void addPoints(std::vector<glm::vec3> &points);
     void addPointValue(glm::vec3 pos, double radius, double value);
     void addPointValue(glm::vec3 pos, double value);
+    void addPointValue(glm::vec3 pos, double value, glm::vec3 gradient);
     void addCuboid(glm::vec3 pos, double w, double h, double d);
     void setSurfaceThreshold(double t) { _surfaceThreshold = t; }
     double getSurfaceThreshold() { return _surfaceThreshold; }
     void setMaterialGrid(Array3d<int> &matGrid);
+    void getSurfaceCells(std::vector<GridIndex> &cells);
     void getScalarField(Array3d<float> &field);
     bool isCellInsideSurface(int i, int j, int k);
     void setTricubicWeighting();
@@ -72,6 +78,15 @@ private:
         return 0.0;
     }
 
+    void _addPoint(glm::vec3 p, GridIndex gmin, GridIndex gmax,
+                   std::vector<GridIndex> *touchedVertices);
+    void _addPointsInSlab(int startk, int endk, std::vector<glm::vec3> *points,
+                          std::vector<int> *binOffsets, std::vector<int> *binIndices,
+                          std::vector<GridIndex> *touchedVertices);
+    void _findSurfaceCells();
+    bool _isCellOnSurface(int i, int j, int k);
+    bool _isVertexSolid(int i, int j, int k);
+    double _getClampedFieldValue(int i, int j, int k);
     double _evaluateTricubicFieldFunctionForRadiusSquared(double rsq);
     double _evaluateTrilinearFieldFunction(glm::vec3 v);
 
@@ -98,11 +113,18 @@ private:
 
     Array3d<float> _field;
     Array3d<float> _centerField;
-    Array3d<bool> _isVertexSolid;
+
+    // Not owned. Must outlive the field while values are read.
+    Array3d<int> *_materialGrid = NULL;
     Array3d<float> _weightField;
     Array3d<int> _weightCountField;
 
     bool _isCenterFieldEnabled = false;
     bool _isWeightFieldEnabled = false;
+    bool _isSurfaceCellDetectionEnabled = false;
+
+    int _numSplatThreads = 8;
+    std::vector<GridIndex> _touchedVertices;
+    std::vector<GridIndex> _surfaceCells;
 };
 
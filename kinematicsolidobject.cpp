@@ -0,0 +1,312 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "kinematicsolidobject.h"
+
+
+KinematicSolidObject::KinematicSolidObject() {
+}
+
+KinematicSolidObject::KinematicSolidObject(TriangleMesh mesh, double dx) : _dx(dx) {
+    _voxelizeMesh(mesh);
+}
+
+KinematicSolidObject::~KinematicSolidObject() {
+}
+
+void KinematicSolidObject::setPosition(glm::vec3 p) {
+    _previousPose.position = p;
+    _currentPose.position = p;
+    _targetPose.position = p;
+    _isSolidCellsOutdated = true;
+}
+
+void KinematicSolidObject::setRotation(glm::vec3 axis, double angle) {
+    Quaternion q = _axisAngleToQuaternion(axis, angle);
+    _previousPose.rotation = q;
+    _currentPose.rotation = q;
+    _targetPose.rotation = q;
+    _updatePoseAxes(_previousPose);
+    _updatePoseAxes(_currentPose);
+    _updatePoseAxes(_targetPose);
+    _isSolidCellsOutdated = true;
+}
+
+void KinematicSolidObject::setTransform(glm::vec3 p, glm::vec3 axis, double angle) {
+    setPosition(p);
+    setRotation(axis, angle);
+}
+
+void KinematicSolidObject::setTargetPosition(glm::vec3 p) {
+    _targetPose.position = p;
+}
+
+void KinematicSolidObject::setTargetRotation(glm::vec3 axis, double angle) {
+    _targetPose.rotation = _axisAngleToQuaternion(axis, angle);
+    _updatePoseAxes(_targetPose);
+}
+
+void KinematicSolidObject::setTargetTransform(glm::vec3 p, glm::vec3 axis, double angle) {
+    setTargetPosition(p);
+    setTargetRotation(axis, angle);
+}
+
+glm::vec3 KinematicSolidObject::getPosition() {
+    return _currentPose.position;
+}
+
+glm::vec3 KinematicSolidObject::getTargetPosition() {
+    return _targetPose.position;
+}
+
+int KinematicSolidObject::getID() {
+    return _id;
+}
+
+void KinematicSolidObject::setID(int identifier) {
+    _id = identifier;
+}
+
+void KinematicSolidObject::advance(double fraction) {
+    fraction = fmin(fmax(fraction, 0.0), 1.0);
+
+    _previousPose = _currentPose;
+    _currentPose.position = _currentPose.position +
+                            (float)fraction*(_targetPose.position - _currentPose.position);
+    _currentPose.rotation = _interpolateQuaternion(_currentPose.rotation,
+                                                   _targetPose.rotation, fraction);
+    _updatePoseAxes(_currentPose);
+
+    _wasMoving = _isMoving;
+    _isMoving = !_isPoseEqual(_previousPose, _currentPose);
+    if (_isMoving) {
+        _isSolidCellsOutdated = true;
+    }
+}
+
+bool KinematicSolidObject::isMoving() {
+    return _isMoving;
+}
+
+bool KinematicSolidObject::isVelocityChanged() {
+    return _isMoving || _wasMoving;
+}
+
+glm::vec3 KinematicSolidObject::getVelocityAtPosition(glm::vec3 p, double dt) {
+    if (!_isMoving || dt <= 0.0) {
+        return glm::vec3(0.0, 0.0, 0.0);
+    }
+
+    glm::vec3 local = _worldToLocal(_currentPose, p);
+    glm::vec3 prev = _localToWorld(_previousPose, local);
+
+    return (p - prev) / (float)dt;
+}
+
+void KinematicSolidObject::getSolidCellDelta(int isize, int jsize, int ksize,
+                                             std::vector<GridIndex> &addedCells,
+                                             std::vector<GridIndex> &removedCells) {
+    if (!_isSolidCellsOutdated) {
+        return;
+    }
+
+    std::vector<GridIndex> cells;
+    _getOccupiedCells(_currentPose, isize, jsize, ksize, cells);
+
+    std::unordered_map<GridIndex, bool, GridIndexHasher> oldCells;
+    oldCells.reserve(_solidCells.size());
+    for (unsigned int i = 0; i < _solidCells.size(); i++) {
+        oldCells.insert(std::pair<GridIndex, bool>(_solidCells[i], true));
+    }
+
+    std::unordered_map<GridIndex, bool, GridIndexHasher> newCells;
+    newCells.reserve(cells.size());
+    GridIndex g;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        newCells.insert(std::pair<GridIndex, bool>(g, true));
+        if (oldCells.find(g) == oldCells.end()) {
+            addedCells.push_back(g);
+        }
+    }
+
+    for (unsigned int i = 0; i < _solidCells.size(); i++) {
+        g = _solidCells[i];
+        if (newCells.find(g) == newCells.end()) {
+            removedCells.push_back(g);
+        }
+    }
+
+    _solidCells = cells;
+    _isSolidCellsOutdated = false;
+}
+
+std::vector<GridIndex> KinematicSolidObject::getSolidCells() {
+    return _solidCells;
+}
+
+void KinematicSolidObject::_voxelizeMesh(TriangleMesh &mesh) {
+    if (mesh.vertices.size() == 0) {
+        return;
+    }
+
+    // pad by a cell on each side so that the mesh surface
+    // does not touch the border of the occupancy grid
+    AABB bbox = AABB(mesh.vertices);
+    bbox.expand(2.0*_dx);
+
+    int isize = (int)ceil(bbox.width / _dx);
+    int jsize = (int)ceil(bbox.height / _dx);
+    int ksize = (int)ceil(bbox.depth / _dx);
+    _localGridPosition = bbox.position;
+
+    for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
+        mesh.vertices[i] -= _localGridPosition;
+    }
+
+    std::vector<GridIndex> cells;
+    mesh.setGridDimensions(isize, jsize, ksize, _dx);
+    mesh.getCellsInsideMesh(cells);
+
+    Array3d<bool> occupancy(isize, jsize, ksize, false);
+    occupancy.set(cells, true);
+    _localOccupancy = occupancy;
+}
+
+KinematicSolidObject::Quaternion KinematicSolidObject::_axisAngleToQuaternion(glm::vec3 axis,
+                                                                              double angle) {
+    double len = glm::length(axis);
+    if (len == 0.0) {
+        return Quaternion();
+    }
+    axis = axis / (float)len;
+
+    double s = sin(0.5*angle);
+    return Quaternion(cos(0.5*angle), s*axis.x, s*axis.y, s*axis.z);
+}
+
+KinematicSolidObject::Quaternion KinematicSolidObject::_interpolateQuaternion(Quaternion q1,
+                                                                              Quaternion q2,
+                                                                              double t) {
+    if (t <= 0.0) {
+        return q1;
+    }
+    if (t >= 1.0) {
+        return q2;
+    }
+
+    // take the shortest path between orientations
+    double dot = q1.w*q2.w + q1.x*q2.x + q1.y*q2.y + q1.z*q2.z;
+    if (dot < 0.0) {
+        q2 = Quaternion(-q2.w, -q2.x, -q2.y, -q2.z);
+    }
+
+    Quaternion q = Quaternion(q1.w + t*(q2.w - q1.w),
+                              q1.x + t*(q2.x - q1.x),
+                              q1.y + t*(q2.y - q1.y),
+                              q1.z + t*(q2.z - q1.z));
+    double len = sqrt(q.w*q.w + q.x*q.x + q.y*q.y + q.z*q.z);
+
+    return Quaternion(q.w / len, q.x / len, q.y / len, q.z / len);
+}
+
+void KinematicSolidObject::_updatePoseAxes(Pose &pose) {
+    double w = pose.rotation.w;
+    double x = pose.rotation.x;
+    double y = pose.rotation.y;
+    double z = pose.rotation.z;
+
+    pose.xaxis = glm::vec3(1.0 - 2.0*(y*y + z*z), 2.0*(x*y + w*z), 2.0*(x*z - w*y));
+    pose.yaxis = glm::vec3(2.0*(x*y - w*z), 1.0 - 2.0*(x*x + z*z), 2.0*(y*z + w*x));
+    pose.zaxis = glm::vec3(2.0*(x*z + w*y), 2.0*(y*z - w*x), 1.0 - 2.0*(x*x + y*y));
+}
+
+bool KinematicSolidObject::_isPoseEqual(Pose &p1, Pose &p2) {
+    double eps = 10e-9;
+    glm::vec3 dp = p2.position - p1.position;
+    return fabs(dp.x) < eps && fabs(dp.y) < eps && fabs(dp.z) < eps &&
+           fabs(p2.rotation.w - p1.rotation.w) < eps &&
+           fabs(p2.rotation.x - p1.rotation.x) < eps &&
+           fabs(p2.rotation.y - p1.rotation.y) < eps &&
+           fabs(p2.rotation.z - p1.rotation.z) < eps;
+}
+
+glm::vec3 KinematicSolidObject::_localToWorld(Pose &pose, glm::vec3 p) {
+    return pose.position + p.x*pose.xaxis + p.y*pose.yaxis + p.z*pose.zaxis;
+}
+
+glm::vec3 KinematicSolidObject::_worldToLocal(Pose &pose, glm::vec3 p) {
+    glm::vec3 v = p - pose.position;
+    return glm::vec3(glm::dot(v, pose.xaxis),
+                     glm::dot(v, pose.yaxis),
+                     glm::dot(v, pose.zaxis));
+}
+
+AABB KinematicSolidObject::_getWorldBoundingBox(Pose &pose) {
+    double w = _localOccupancy.width*_dx;
+    double h = _localOccupancy.height*_dx;
+    double d = _localOccupancy.depth*_dx;
+
+    std::vector<glm::vec3> corners;
+    corners.reserve(8);
+    for (int k = 0; k < 2; k++) {
+        for (int j = 0; j < 2; j++) {
+            for (int i = 0; i < 2; i++) {
+                glm::vec3 c = _localGridPosition + glm::vec3(i*w, j*h, k*d);
+                corners.push_back(_localToWorld(pose, c));
+            }
+        }
+    }
+
+    return AABB(corners);
+}
+
+bool KinematicSolidObject::_isLocalPositionOccupied(glm::vec3 p) {
+    GridIndex g = Grid3d::positionToGridIndex(p - _localGridPosition, _dx);
+    if (!_localOccupancy.isIndexInRange(g)) {
+        return false;
+    }
+
+    return _localOccupancy(g);
+}
+
+void KinematicSolidObject::_getOccupiedCells(Pose &pose, int isize, int jsize, int ksize,
+                                             std::vector<GridIndex> &cells) {
+    if (_localOccupancy.width == 0) {
+        return;
+    }
+
+    // Only cells within the world space bounds of the posed
+    // occupancy grid are tested
+    GridIndex gmin, gmax;
+    AABB bbox = _getWorldBoundingBox(pose);
+    Grid3d::getGridIndexBounds(bbox, _dx, isize, jsize, ksize, &gmin, &gmax);
+
+    glm::vec3 c;
+    for (int k = gmin.k; k <= gmax.k; k++) {
+        for (int j = gmin.j; j <= gmax.j; j++) {
+            for (int i = gmin.i; i <= gmax.i; i++) {
+                c = Grid3d::GridIndexToCellCenter(i, j, k, _dx);
+                if (_isLocalPositionOccupied(_worldToLocal(pose, c))) {
+                    cells.push_back(GridIndex(i, j, k));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,121 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <assert.h>
+
+#include "glm/glm.hpp"
+#include "array3d.h"
+#include "grid3d.h"
+#include "aabb.h"
+#include "trianglemesh.h"
+
+/*
+    A rigid solid obstacle that is moved by the user instead of the fluid.
+
+    The mesh is voxelized once in object space. Each substep the object is
+    moved toward its target pose and only the cells that the obstacle has
+    entered or left since the previous substep are reported so that the
+    simulation can update its material grid incrementally.
+*/
+class KinematicSolidObject
+{
+public:
+    KinematicSolidObject();
+    KinematicSolidObject(TriangleMesh mesh, double dx);
+    ~KinematicSolidObject();
+
+    // Move immediately. The object will not impart a velocity on the fluid.
+    void setPosition(glm::vec3 p);
+    void setRotation(glm::vec3 axis, double angle);
+    void setTransform(glm::vec3 p, glm::vec3 axis, double angle);
+
+    // Pose that the object will reach at the end of the next frame
+    void setTargetPosition(glm::vec3 p);
+    void setTargetRotation(glm::vec3 axis, double angle);
+    void setTargetTransform(glm::vec3 p, glm::vec3 axis, double angle);
+
+    glm::vec3 getPosition();
+    glm::vec3 getTargetPosition();
+    int getID();
+    void setID(int identifier);
+
+    // Interpolate the current pose a fraction of the way to the target pose
+    void advance(double fraction);
+    bool isMoving();
+    bool isVelocityChanged();
+    glm::vec3 getVelocityAtPosition(glm::vec3 p, double dt);
+
+    void getSolidCellDelta(int isize, int jsize, int ksize,
+                           std::vector<GridIndex> &addedCells,
+                           std::vector<GridIndex> &removedCells);
+    std::vector<GridIndex> getSolidCells();
+
+private:
+    struct Quaternion {
+        double w, x, y, z;
+
+        Quaternion() : w(1.0), x(0.0), y(0.0), z(0.0) {}
+        Quaternion(double qw, double qx, double qy, double qz) :
+                       w(qw), x(qx), y(qy), z(qz) {}
+    };
+
+    struct Pose {
+        glm::vec3 position;
+        Quaternion rotation;
+        glm::vec3 xaxis, yaxis, zaxis;
+
+        Pose() : position(0.0, 0.0, 0.0),
+                 xaxis(1.0, 0.0, 0.0),
+                 yaxis(0.0, 1.0, 0.0),
+                 zaxis(0.0, 0.0, 1.0) {}
+    };
+
+    void _voxelizeMesh(TriangleMesh &mesh);
+    Quaternion _axisAngleToQuaternion(glm::vec3 axis, double angle);
+    Quaternion _interpolateQuaternion(Quaternion q1, Quaternion q2, double t);
+    void _updatePoseAxes(Pose &pose);
+    bool _isPoseEqual(Pose &p1, Pose &p2);
+    glm::vec3 _localToWorld(Pose &pose, glm::vec3 p);
+    glm::vec3 _worldToLocal(Pose &pose, glm::vec3 p);
+    AABB _getWorldBoundingBox(Pose &pose);
+    void _getOccupiedCells(Pose &pose, int isize, int jsize, int ksize,
+                           std::vector<GridIndex> &cells);
+    bool _isLocalPositionOccupied(glm::vec3 p);
+
+    double _dx = 0.0;
+    int _id = 0;
+
+    Pose _previousPose;
+    Pose _currentPose;
+    Pose _targetPose;
+    bool _isMoving = false;
+    bool _wasMoving = false;
+
+    // Object space occupancy grid. Cell (0, 0, 0) has its
+    // minimum corner at _localGridPosition.
+    glm::vec3 _localGridPosition;
+    Array3d<bool> _localOccupancy;
+
+    bool _isSolidCellsOutdated = true;
+    std::vector<GridIndex> _solidCells;
+};
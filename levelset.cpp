@@ -25,18 +25,59 @@ LevelSet::LevelSet()
 
 LevelSet::LevelSet(int i, int j, int k, double dx) : 
                                  _isize(i), _jsize(j), _ksize(k), _dx(dx),
-                                 _signedDistance(Array3d<float>(i, j, k, 0.0f)),
-                                 _indexGrid(Array3d<int>(i, j, k, -1)),
-                                 _isDistanceSet(Array3d<bool>(i, j, k, false)),
-                                 _distanceField(LevelSetField(i, j, k, dx)) {
+                                 _signedDistance(i, j, k, 0.0f),
+                                 _indexGrid(i, j, k, -1),
+                                 _isDistanceSet(i, j, k, false),
+                                 _distanceField(LevelSetField(i, j, k, dx)),
+                                 _curvatureGrid(i, j, k, 0.0f) {
 }
 
 LevelSet::~LevelSet()
 {
 }
 
-void LevelSet::setSurfaceMesh(TriangleMesh m) {
-    _surfaceMesh = m;
+void LevelSet::setSurfaceMesh(TriangleMesh &mesh) {
+    setSurfaceMesh(std::make_shared<const TriangleMesh>(mesh));
+}
+
+void LevelSet::setSurfaceMesh(TriangleMeshSnapshot mesh) {
+    if (_isIncrementalUpdateEnabled) {
+        _previousSurfaceMesh = _surfaceMesh;
+    }
+    _surfaceMesh = mesh;
+    _surfaceBVH.clear();
+}
+
+void LevelSet::enableFastMarching() {
+    _isFastMarchingEnabled = true;
+}
+
+void LevelSet::disableFastMarching() {
+    _isFastMarchingEnabled = false;
+}
+
+void LevelSet::enableIncrementalUpdate() {
+    _isIncrementalUpdateEnabled = true;
+}
+
+void LevelSet::disableIncrementalUpdate() {
+    _isIncrementalUpdateEnabled = false;
+    _isIncrementalDataValid = false;
+    _previousSurfaceMesh = std::make_shared<const TriangleMesh>();
+    _tileSignatures.clear();
+}
+
+Array3d<float> LevelSet::getSignedDistanceField() {
+    Array3d<float> field(_isize, _jsize, _ksize, 0.0f);
+    for (int k = 0; k < _ksize; k++) {
+        for (int j = 0; j < _jsize; j++) {
+            for (int i = 0; i < _isize; i++) {
+                field.set(i, j, k, _signedDistance(i, j, k));
+            }
+        }
+    }
+
+    return field;
 }
 
 void LevelSet::_resetSignedDistanceField() {
@@ -46,24 +87,39 @@ void LevelSet::_resetSignedDistanceField() {
 }
 
 void LevelSet::_getTriangleGridCellOverlap(Triangle t, std::vector<GridIndex> &cells) {
+    _getTriangleGridCellOverlap(t, std::numeric_limits<int>::min(), 
+                                   std::numeric_limits<int>::max(), cells);
+}
+
+void LevelSet::_getTriangleGridCellOverlap(Triangle t, int kstart, int kend,
+                                           std::vector<GridIndex> &cells) {
     std::vector<GridIndex> testcells;
-    AABB tbbox = AABB(t, _surfaceMesh.vertices);
+    AABB tbbox = AABB(t, _surfaceMesh->vertices);
     tbbox.getOverlappingGridCells(_dx, testcells);
 
     AABB cbbox = AABB(glm::vec3(0.0, 0.0, 0.0), _dx, _dx, _dx);
     for (unsigned int i = 0; i < testcells.size(); i++) {
+        if (testcells[i].k < kstart || testcells[i].k > kend) {
+            continue;
+        }
+
         cbbox.position = _gridIndexToPosition(testcells[i]);
-        if (cbbox.isOverlappingTriangle(t, _surfaceMesh.vertices)) {
+        if (cbbox.isOverlappingTriangle(t, _surfaceMesh->vertices)) {
             cells.push_back(testcells[i]);
         }
     }
 }
 
 void LevelSet::_calculateDistancesSquaredForTriangle(int index) {
-    Triangle t = _surfaceMesh.triangles[index];
+    _calculateDistancesSquaredForTriangle(index, std::numeric_limits<int>::min(), 
+                                                 std::numeric_limits<int>::max());
+}
+
+void LevelSet::_calculateDistancesSquaredForTriangle(int index, int kstart, int kend) {
+    Triangle t = _surfaceMesh->triangles[index];
 
     std::vector<GridIndex> cells;
-    _getTriangleGridCellOverlap(t, cells);
+    _getTriangleGridCellOverlap(t, kstart, kend, cells);
 
     GridIndex g;
     double distsq;
@@ -77,9 +133,70 @@ void LevelSet::_calculateDistancesSquaredForTriangle(int index) {
     }
 }
 
+void LevelSet::_calculateUnsignedSurfaceDistanceSquaredForSlabs(int kstart, int kend,
+                                                                std::vector<int> *triangleKMin,
+                                                                std::vector<int> *triangleKMax) {
+    // Triangles are visited in index order so that each cell is
+    // updated in the same order as the serial version
+    for (unsigned int i = 0; i < _surfaceMesh->triangles.size(); i++) {
+        if (triangleKMax->at(i) >= kstart && triangleKMin->at(i) <= kend) {
+            _calculateDistancesSquaredForTriangle(i, kstart, kend);
+        }
+    }
+}
+
 void LevelSet::_calculateUnsignedSurfaceDistanceSquared() {
-    for (unsigned int i = 0; i < _surfaceMesh.triangles.size(); i++) {
-        _calculateDistancesSquaredForTriangle(i);
+    int tsize = TiledArray3d<float>::TILE_SIZE;
+    int numTileLayers = (_ksize + tsize - 1) / tsize;
+    int numThreads = (int)fmin(_numSurfaceDistanceThreads, numTileLayers);
+    if (numThreads <= 1) {
+        for (unsigned int i = 0; i < _surfaceMesh->triangles.size(); i++) {
+            _calculateDistancesSquaredForTriangle(i);
+        }
+        return;
+    }
+
+    // Each thread owns a slab of cells in the k direction and only writes 
+    // to cells within its slab. Slabs are whole layers of tiles so that no
+    // two threads allocate the same tile.
+    std::vector<int> triangleKMin;
+    std::vector<int> triangleKMax;
+    triangleKMin.reserve(_surfaceMesh->triangles.size());
+    triangleKMax.reserve(_surfaceMesh->triangles.size());
+    for (unsigned int i = 0; i < _surfaceMesh->triangles.size(); i++) {
+        AABB tbbox = AABB(_surfaceMesh->triangles[i], _surfaceMesh->vertices);
+        glm::vec3 tmax = tbbox.position + glm::vec3(tbbox.width, tbbox.height, tbbox.depth);
+        triangleKMin.push_back(Grid3d::positionToGridIndex(tbbox.position, _dx).k);
+        triangleKMax.push_back(Grid3d::positionToGridIndex(tmax, _dx).k);
+    }
+
+    std::vector<int> startIndices;
+    std::vector<int> endIndices;
+    int chunksize = (int)floor(numTileLayers / numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startIdx = (i == 0) ? 0 : endIndices[i - 1] + 1;
+        int endIdx = (i == numThreads - 1) ? _ksize - 1 : startIdx + chunksize*tsize - 1;
+
+        startIndices.push_back(startIdx);
+        endIndices.push_back(endIdx);
+    }
+
+    // Cells outside of the grid in k are given to the end slabs
+    startIndices[0] = std::numeric_limits<int>::min();
+    endIndices[numThreads - 1] = std::numeric_limits<int>::max();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&LevelSet::_calculateUnsignedSurfaceDistanceSquaredForSlabs,
+                                      this,
+                                      startIndices[i],
+                                      endIndices[i],
+                                      &triangleKMin,
+                                      &triangleKMax));
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
     }
 }
 
@@ -94,7 +211,7 @@ void LevelSet::_getNeighbourGridIndices6(GridIndex g, GridIndex n[6]) {
 
 void LevelSet::_getLayerCells(int idx, std::vector<GridIndex> &layer, 
                                        std::vector<GridIndex> &nextLayer,
-                                       Array3d<int> &layerGrid) {
+                                       TiledArray3d<int> &layerGrid) {
     GridIndex ns[6];
     GridIndex g, n;
     for (unsigned int i = 0; i < layer.size(); i++) {
@@ -112,19 +229,11 @@ void LevelSet::_getLayerCells(int idx, std::vector<GridIndex> &layer,
 }
 
 void LevelSet::_getCellLayers(std::vector<std::vector<GridIndex>> &layers) {
-    Array3d<int> layerGrid(_isize, _jsize, _ksize, -1);
+    TiledArray3d<int> layerGrid(_isize, _jsize, _ksize, -1);
 
     std::vector<GridIndex> layer;
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    layer.push_back(GridIndex(i, j, k));
-                    layerGrid.set(i, j, k, 0);
-                }
-            }
-        }
-    }
+    _getSetCells(layer);
+    layerGrid.set(layer, 0);
 
     std::vector<GridIndex> q;
     layers.push_back(q);
@@ -193,18 +302,365 @@ void LevelSet::_calculateUnsignedDistanceSquared() {
     }
 }
 
+void LevelSet::_getSetCells(std::vector<GridIndex> &cells) {
+    // Set cells can only exist in allocated tiles until the
+    // field has been flood filled
+    std::vector<GridIndex> tiles;
+    _isDistanceSet.getAllocatedTiles(tiles);
+
+    GridIndex gmin, gmax;
+    for (unsigned int t = 0; t < tiles.size(); t++) {
+        _isDistanceSet.getTileCellBounds(tiles[t], &gmin, &gmax);
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    if (_isDistanceSet(i, j, k)) {
+                        cells.push_back(GridIndex(i, j, k));
+                    }
+                }
+            }
+        }
+    }
+}
+
 void LevelSet::_squareRootDistanceField() {
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    _signedDistance.set(i, j, k, sqrt(_signedDistance(i, j, k)));
+    std::vector<GridIndex> cells;
+    _getSetCells(cells);
+
+    GridIndex g;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        _signedDistance.set(g, sqrt(_signedDistance(g)));
+    }
+}
+
+void LevelSet::_calculateExactDistancesForFirstLayer(std::vector<GridIndex> &layer) {
+    // Cells neighbouring the triangle overlap cells are given exact distances
+    // to the closest triangle of their set neighbours
+    GridIndex g, n;
+    GridIndex ns[6];
+    double distsq, mindistsq;
+    int mintidx;
+    for (unsigned int i = 0; i < layer.size(); i++) {
+        g = layer[i];
+        _getNeighbourGridIndices6(g, ns);
+
+        mindistsq = std::numeric_limits<double>::infinity();
+        mintidx = -1;
+        for (int idx = 0; idx < 6; idx++) {
+            n = ns[idx];
+            if (!Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) || 
+                    !_isDistanceSet(n)) {
+                continue;
+            }
+
+            distsq = _minDistToTriangleSquared(g, _indexGrid(n));
+            if (distsq < mindistsq) {
+                mindistsq = distsq;
+                mintidx = _indexGrid(n);
+            }
+        }
+
+        _setLevelSetCell(g, sqrt(mindistsq), mintidx);
+    }
+}
+
+double LevelSet::_solveEikonal(double a, double b, double c) {
+    // a <= b <= c are the smallest frozen neighbour distances along each axis
+    double h = _dx;
+    double d = a + h;
+    if (d <= b) {
+        return d;
+    }
+
+    d = 0.5*(a + b + sqrt(2.0*h*h - (a - b)*(a - b)));
+    if (d <= c) {
+        return d;
+    }
+
+    double sum = a + b + c;
+    double sumsq = a*a + b*b + c*c;
+    double disc = sum*sum - 3.0*(sumsq - h*h);
+    if (disc < 0.0) {
+        return d;
+    }
+
+    return (sum + sqrt(disc)) / 3.0;
+}
+
+void LevelSet::_updateTentativeDistance(GridIndex g, TiledArray3d<bool> &isFrozen, 
+                                        MarchingQueue &queue) {
+    double inf = std::numeric_limits<double>::infinity();
+    double axis[3] = {inf, inf, inf};
+    double mind = inf;
+    int mintidx = -1;
+
+    GridIndex ns[6];
+    _getNeighbourGridIndices6(g, ns);
+    GridIndex n;
+    double d;
+    for (int idx = 0; idx < 6; idx++) {
+        n = ns[idx];
+        if (!Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) || !isFrozen(n)) {
+            continue;
+        }
+
+        d = _signedDistance(n);
+        if (d < axis[idx / 2]) {
+            axis[idx / 2] = d;
+        }
+        if (d < mind) {
+            mind = d;
+            mintidx = _indexGrid(n);
+        }
+    }
+
+    if (mind == inf) {
+        return;
+    }
+
+    if (axis[0] > axis[1]) { std::swap(axis[0], axis[1]); }
+    if (axis[1] > axis[2]) { std::swap(axis[1], axis[2]); }
+    if (axis[0] > axis[1]) { std::swap(axis[0], axis[1]); }
+
+    d = _solveEikonal(axis[0], axis[1], axis[2]);
+    if (!_isDistanceSet(g) || d < _signedDistance(g)) {
+        _setLevelSetCell(g, d, mintidx);
+        queue.push(MarchingCell(g, (float)d));
+    }
+}
+
+void LevelSet::_fastMarchUnsignedDistance(std::vector<GridIndex> &front, 
+                                          TiledArray3d<bool> &isFrozen) {
+    // Cells in front are frozen. The Eikonal equation is solved outward from 
+    // the front in order of increasing distance until the band is filled.
+    MarchingQueue queue;
+    GridIndex ns[6];
+    GridIndex n;
+    for (unsigned int i = 0; i < front.size(); i++) {
+        _getNeighbourGridIndices6(front[i], ns);
+        for (int idx = 0; idx < 6; idx++) {
+            n = ns[idx];
+            if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && !isFrozen(n)) {
+                _updateTentativeDistance(n, isFrozen, queue);
+            }
+        }
+    }
+
+    double maxDistance = _numLayers*_dx;
+    MarchingCell c;
+    while (!queue.empty()) {
+        c = queue.top();
+        queue.pop();
+
+        // stale entries are left in the queue when a distance is lowered
+        if (isFrozen(c.index) || c.distance > _signedDistance(c.index)) {
+            continue;
+        }
+        if (c.distance > maxDistance) {
+            break;
+        }
+
+        isFrozen.set(c.index, true);
+        _getNeighbourGridIndices6(c.index, ns);
+        for (int idx = 0; idx < 6; idx++) {
+            n = ns[idx];
+            if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && !isFrozen(n)) {
+                _updateTentativeDistance(n, isFrozen, queue);
+            }
+        }
+    }
+}
+
+void LevelSet::_calculateUnsignedDistanceFastMarching() {
+    // Exact distances are computed for the triangle overlap cells and the
+    // first layer around them. The rest of the narrow band is found by
+    // fast marching.
+    TiledArray3d<bool> isFrozen(_isize, _jsize, _ksize, false);
+    TiledArray3d<int> layerGrid(_isize, _jsize, _ksize, -1);
+    std::vector<GridIndex> seeds;
+    _getSetCells(seeds);
+    layerGrid.set(seeds, 0);
+
+    std::vector<GridIndex> firstLayer;
+    _getLayerCells(1, seeds, firstLayer, layerGrid);
+    _calculateExactDistancesForFirstLayer(firstLayer);
+
+    isFrozen.set(seeds, true);
+    isFrozen.set(firstLayer, true);
+    _fastMarchUnsignedDistance(firstLayer, isFrozen);
+}
+
+void LevelSet::_calculateParticleSignedDistances(std::vector<glm::vec3> &particles, 
+                                                 double radius, 
+                                                 TiledArray3d<float> &phi,
+                                                 TiledArray3d<bool> &isSet) {
+    // Averaged sphere distance of Zhu and Bridson: phi = |x - xavg| - r, 
+    // where xavg is a kernel weighted average of nearby particle positions.
+    // The sign is flipped so that the inside of the fluid is positive.
+    double R = 2.0*_dx;
+    double invRsq = 1.0 / (R*R);
+    TiledArray3d<float> weights(_isize, _jsize, _ksize, 0.0f);
+    TiledArray3d<glm::vec3> positions(_isize, _jsize, _ksize, glm::vec3(0.0, 0.0, 0.0));
+
+    GridIndex gmin, gmax;
+    glm::vec3 p, c, v;
+    double distsq, w;
+    for (unsigned int pidx = 0; pidx < particles.size(); pidx++) {
+        p = particles[pidx];
+        Grid3d::getGridIndexBounds(p, R, _dx, _isize, _jsize, _ksize, &gmin, &gmax);
+
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    c = _gridIndexToCellCenter(i, j, k);
+                    v = c - p;
+                    distsq = glm::dot(v, v)*invRsq;
+                    if (distsq >= 1.0) {
+                        continue;
+                    }
+
+                    w = (1.0 - distsq)*(1.0 - distsq)*(1.0 - distsq);
+                    weights.add(i, j, k, (float)w);
+                    positions.add(i, j, k, (float)w*p);
+                }
+            }
+        }
+    }
+
+    std::vector<GridIndex> tiles;
+    weights.getAllocatedTiles(tiles);
+
+    float eps = 10e-9f;
+    float wsum;
+    glm::vec3 avg;
+    for (unsigned int t = 0; t < tiles.size(); t++) {
+        weights.getTileCellBounds(tiles[t], &gmin, &gmax);
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    wsum = weights(i, j, k);
+                    if (wsum < eps) {
+                        continue;
+                    }
+
+                    avg = positions(i, j, k) / wsum;
+                    c = _gridIndexToCellCenter(i, j, k);
+                    phi.set(i, j, k, (float)(radius - glm::length(c - avg)));
+                    isSet.set(i, j, k, true);
                 }
             }
         }
     }
 }
 
+void LevelSet::_initializeParticleInterfaceCells(TiledArray3d<float> &phi, 
+                                                 TiledArray3d<bool> &isInside,
+                                                 std::vector<GridIndex> &front,
+                                                 TiledArray3d<bool> &isFrozen) {
+    // Cells with a neighbour on the other side of the surface keep their
+    // particle distance. The surface lies within a cell width of these cells.
+    //
+    // Only tiles of isInside that contain inside cells are allocated. An
+    // interface cell in an unallocated tile is found from its inside 
+    // neighbour across the tile boundary.
+    std::vector<GridIndex> tiles;
+    isInside.getAllocatedTiles(tiles);
+
+    std::vector<GridIndex> interfaceCells;
+    GridIndex ns[6];
+    GridIndex g, n, gmin, gmax;
+    for (unsigned int t = 0; t < tiles.size(); t++) {
+        isInside.getTileCellBounds(tiles[t], &gmin, &gmax);
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    g = GridIndex(i, j, k);
+                    _getNeighbourGridIndices6(g, ns);
+
+                    bool isInterface = false;
+                    for (int idx = 0; idx < 6; idx++) {
+                        n = ns[idx];
+                        if (!Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) ||
+                                isInside(n) == isInside(g)) {
+                            continue;
+                        }
+
+                        isInterface = true;
+                        if (!isInside.isTileAllocated(isInside.getTileIndex(n))) {
+                            interfaceCells.push_back(n);
+                        }
+                    }
+
+                    if (isInterface) {
+                        interfaceCells.push_back(g);
+                    }
+                }
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < interfaceCells.size(); i++) {
+        g = interfaceCells[i];
+        if (isFrozen(g)) {
+            continue;
+        }
+
+        _setLevelSetCell(g, fmin(fabs(phi(g)), _dx), -1);
+        isFrozen.set(g, true);
+        front.push_back(g);
+    }
+}
+
+void LevelSet::calculateSignedDistanceField(std::vector<glm::vec3> &particles, 
+                                            double radius, int numLayers) {
+    _numLayers = numLayers;
+    _isParticleDistanceField = true;
+    _isIncrementalDataValid = false;
+    _surfaceBVH.clear();
+    _resetSignedDistanceField();
+
+    TiledArray3d<float> phi(_isize, _jsize, _ksize, (float)-_dx);
+    TiledArray3d<bool> isInside(_isize, _jsize, _ksize, false);
+    {
+        TiledArray3d<bool> isSet(_isize, _jsize, _ksize, false);
+        _calculateParticleSignedDistances(particles, radius, phi, isSet);
+
+        std::vector<GridIndex> tiles;
+        isSet.getAllocatedTiles(tiles);
+        GridIndex gmin, gmax;
+        for (unsigned int t = 0; t < tiles.size(); t++) {
+            isSet.getTileCellBounds(tiles[t], &gmin, &gmax);
+            for (int k = gmin.k; k <= gmax.k; k++) {
+                for (int j = gmin.j; j <= gmax.j; j++) {
+                    for (int i = gmin.i; i <= gmax.i; i++) {
+                        isInside.set(i, j, k, isSet(i, j, k) && phi(i, j, k) > 0.0);
+                    }
+                }
+            }
+        }
+    }
+
+    // Redistance the raw particle distances outward from the surface
+    TiledArray3d<bool> isFrozen(_isize, _jsize, _ksize, false);
+    std::vector<GridIndex> front;
+    _initializeParticleInterfaceCells(phi, isInside, front, isFrozen);
+    _fastMarchUnsignedDistance(front, isFrozen);
+
+    std::vector<GridIndex> cells;
+    _getSetCells(cells);
+    GridIndex g;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        g = cells[i];
+        if (!isInside(g)) {
+            _signedDistance.set(g, -_signedDistance(g));
+        }
+    }
+    _floodFillMissingSignedDistances();
+
+    _distanceField.setSignedDistanceField(_signedDistance);
+}
+
 void LevelSet::_updateCellSign(GridIndex g, std::vector<glm::vec3> &triangleCenters, 
                                             std::vector<glm::vec3> &triangleDirections) {
     // Use this convention:
@@ -225,43 +681,106 @@ void LevelSet::_updateCellSign(GridIndex g, std::vector<glm::vec3> &triangleCent
 void LevelSet::_calculateDistanceFieldSigns() {
     std::vector<glm::vec3> triangleFaceDirections;
     std::vector<glm::vec3> triangleFaceCenters;
-    triangleFaceDirections.reserve(_surfaceMesh.triangles.size());
-    triangleFaceCenters.reserve(_surfaceMesh.triangles.size());
+    triangleFaceDirections.reserve(_surfaceMesh->triangles.size());
+    triangleFaceCenters.reserve(_surfaceMesh->triangles.size());
 
-    for (unsigned int i = 0; i < _surfaceMesh.triangles.size(); i++) {
-        triangleFaceDirections.push_back(_surfaceMesh.getTriangleFaceDirection(i));
-        triangleFaceCenters.push_back(_surfaceMesh.getTriangleCenter(i));
+    for (unsigned int i = 0; i < _surfaceMesh->triangles.size(); i++) {
+        triangleFaceDirections.push_back(_surfaceMesh->getTriangleFaceDirection(i));
+        triangleFaceCenters.push_back(_surfaceMesh->getTriangleCenter(i));
     }
 
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    _updateCellSign(GridIndex(i, j, k), triangleFaceCenters,
-                                                        triangleFaceDirections);
-                }
+    std::vector<GridIndex> cells;
+    _getSetCells(cells);
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        _updateCellSign(cells[i], triangleFaceCenters, triangleFaceDirections);
+    }
+}
+
+void LevelSet::_setLevelSetTile(GridIndex t, double dist) {
+    _signedDistance.setTileValue(t, (float)dist);
+    _indexGrid.setTileValue(t, -1);
+    _isDistanceSet.setTileValue(t, true);
+}
+
+void LevelSet::_getTileFaceCells(GridIndex t, GridIndex nt, std::vector<GridIndex> &cells) {
+    // cells of tile nt that border tile t
+    GridIndex gmin, gmax;
+    _isDistanceSet.getTileCellBounds(nt, &gmin, &gmax);
+    if (nt.i < t.i) { gmin.i = gmax.i; }
+    if (nt.i > t.i) { gmax.i = gmin.i; }
+    if (nt.j < t.j) { gmin.j = gmax.j; }
+    if (nt.j > t.j) { gmax.j = gmin.j; }
+    if (nt.k < t.k) { gmin.k = gmax.k; }
+    if (nt.k > t.k) { gmax.k = gmin.k; }
+
+    for (int k = gmin.k; k <= gmax.k; k++) {
+        for (int j = gmin.j; j <= gmax.j; j++) {
+            for (int i = gmin.i; i <= gmax.i; i++) {
+                cells.push_back(GridIndex(i, j, k));
             }
         }
     }
 }
 
+void LevelSet::_markFloodFillCell(GridIndex g, double val, 
+                                  std::vector<GridIndex> &cellQueue,
+                                  std::vector<GridIndex> &tileQueue) {
+    // An unallocated tile that is not set contains no set cells and is
+    // filled as a whole
+    GridIndex t = _isDistanceSet.getTileIndex(g);
+    if (_isDistanceSet.isTileAllocated(t)) {
+        _isDistanceSet.set(g, true);
+        cellQueue.push_back(g);
+    } else {
+        _setLevelSetTile(t, val);
+        tileQueue.push_back(t);
+    }
+}
+
 void LevelSet::_floodFillWithDistance(GridIndex seed, double val) {
-    std::vector<GridIndex> queue;
-    queue.push_back(seed);
-    _isDistanceSet.set(seed, true);
+    std::vector<GridIndex> cellQueue;
+    std::vector<GridIndex> tileQueue;
+    _markFloodFillCell(seed, val, cellQueue, tileQueue);
 
     GridIndex g;
     GridIndex ns[6];
-    while (!queue.empty()) {
-        g = queue[queue.size() - 1];
-        queue.pop_back();
+    std::vector<GridIndex> faceCells;
+    while (!cellQueue.empty() || !tileQueue.empty()) {
+        if (!tileQueue.empty()) {
+            g = tileQueue[tileQueue.size() - 1];
+            tileQueue.pop_back();
+
+            Grid3d::getNeighbourGridIndices6(g, ns);
+            for (int i = 0; i < 6; i++) {
+                if (!_isDistanceSet.isTileIndexInRange(ns[i])) {
+                    continue;
+                }
+
+                if (_isDistanceSet.isTileAllocated(ns[i])) {
+                    faceCells.clear();
+                    _getTileFaceCells(g, ns[i], faceCells);
+                    for (unsigned int fidx = 0; fidx < faceCells.size(); fidx++) {
+                        if (!_isDistanceSet(faceCells[fidx])) {
+                            _isDistanceSet.set(faceCells[fidx], true);
+                            cellQueue.push_back(faceCells[fidx]);
+                        }
+                    }
+                } else if (!_isDistanceSet.getTileValue(ns[i])) {
+                    _setLevelSetTile(ns[i], val);
+                    tileQueue.push_back(ns[i]);
+                }
+            }
+            continue;
+        }
+
+        g = cellQueue[cellQueue.size() - 1];
+        cellQueue.pop_back();
 
         Grid3d::getNeighbourGridIndices6(g, ns);
         for (int i = 0; i < 6; i++) {
             if (Grid3d::isGridIndexInRange(ns[i], _isize, _jsize, _ksize) && 
                     !_isDistanceSet(ns[i])) {
-                queue.push_back(ns[i]);
-                _isDistanceSet.set(ns[i], true);
+                _markFloodFillCell(ns[i], val, cellQueue, tileQueue);
             }
         }
 
@@ -270,27 +789,25 @@ void LevelSet::_floodFillWithDistance(GridIndex seed, double val) {
 }
 
 void LevelSet::_floodFillMissingSignedDistances() {
+    std::vector<GridIndex> cells;
+    _getSetCells(cells);
+
     GridIndex ns[6];
-    GridIndex n;
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    Grid3d::getNeighbourGridIndices6(i, j, k, ns);
-                    for (int idx = 0; idx < 6; idx++) {
-                        n = ns[idx];
-                        if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
-                                !_isDistanceSet(n)) {
-                            double dist;
-                            if (_signedDistance(i, j, k) > 0.0) {
-                                dist = _numLayers*_dx;
-                            } else {
-                                dist = -_numLayers*_dx;
-                            }
-                            _floodFillWithDistance(n, dist);
-                        }
-                    }
+    GridIndex g, n;
+    for (unsigned int cidx = 0; cidx < cells.size(); cidx++) {
+        g = cells[cidx];
+        Grid3d::getNeighbourGridIndices6(g, ns);
+        for (int idx = 0; idx < 6; idx++) {
+            n = ns[idx];
+            if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
+                    !_isDistanceSet(n)) {
+                double dist;
+                if (_signedDistance(g) > 0.0) {
+                    dist = _numLayers*_dx;
+                } else {
+                    dist = -_numLayers*_dx;
                 }
+                _floodFillWithDistance(n, dist);
             }
         }
     }
@@ -300,43 +817,370 @@ void LevelSet::calculateSignedDistanceField() {
     calculateSignedDistanceField((int)fmax(fmax(_isize, _jsize), _ksize));
 }
 
-void LevelSet::calculateSignedDistanceField(int numLayers) {
-    _numLayers = numLayers;
-
+void LevelSet::_calculateSignedDistanceFieldFromMesh() {
     _resetSignedDistanceField();
     _calculateUnsignedSurfaceDistanceSquared();
-    _calculateUnsignedDistanceSquared();
-    _squareRootDistanceField();
+    if (_isFastMarchingEnabled) {
+        _squareRootDistanceField();
+        _calculateUnsignedDistanceFastMarching();
+    } else {
+        _calculateUnsignedDistanceSquared();
+        _squareRootDistanceField();
+    }
     _calculateDistanceFieldSigns();
     _floodFillMissingSignedDistances();
+}
+
+LevelSet::TriangleKey LevelSet::_getTriangleKey(const TriangleMesh &mesh, int tidx) {
+    TriangleKey key;
+    Triangle t = mesh.triangles[tidx];
+    for (int i = 0; i < 3; i++) {
+        glm::vec3 v = mesh.vertices[t.tri[i]];
+        key.v[3*i] = v.x;
+        key.v[3*i + 1] = v.y;
+        key.v[3*i + 2] = v.z;
+    }
+
+    return key;
+}
+
+void LevelSet::_calculateTileSignatures(std::vector<unsigned long long> &signatures) {
+    // Order independent hash of the triangles overlapping each tile. Mesh
+    // regions that were not changed by the polygonizer have identical
+    // vertex positions and hash to the same value.
+    int ti, tj, tk;
+    _isDistanceSet.getTileGridDimensions(&ti, &tj, &tk);
+    signatures = std::vector<unsigned long long>(ti*tj*tk, 0ULL);
+
+    TriangleKeyHasher hasher;
+    GridIndex gmax(_isize, _jsize, _ksize);
+    GridIndex cmin, cmax;
+    int tsize = TiledArray3d<bool>::TILE_SIZE;
+    for (unsigned int tidx = 0; tidx < _surfaceMesh->triangles.size(); tidx++) {
+        unsigned long long h = (unsigned long long)hasher(_getTriangleKey(*_surfaceMesh, tidx));
+        h = h*0x9E3779B97F4A7C15ULL + 1ULL;
+
+        AABB bbox(_surfaceMesh->triangles[tidx], _surfaceMesh->vertices);
+        Grid3d::getGridIndexBounds(bbox, _dx, gmax, &cmin, &cmax);
+        for (int k = cmin.k / tsize; k <= cmax.k / tsize; k++) {
+            for (int j = cmin.j / tsize; j <= cmax.j / tsize; j++) {
+                for (int i = cmin.i / tsize; i <= cmax.i / tsize; i++) {
+                    signatures[i + ti*(j + tj*k)] += h;
+                }
+            }
+        }
+    }
+}
+
+void LevelSet::_getDirtyTiles(std::vector<unsigned long long> &signatures, 
+                              std::vector<bool> &isDirty) {
+    // A changed tile affects distances up to the width of the band away,
+    // so tiles within that range are also recomputed
+    int ti, tj, tk;
+    _isDistanceSet.getTileGridDimensions(&ti, &tj, &tk);
+    int tsize = TiledArray3d<bool>::TILE_SIZE;
+    int r = (int)ceil((double)(_numLayers + 1) / (double)tsize);
+
+    isDirty = std::vector<bool>(signatures.size(), false);
+    for (int k = 0; k < tk; k++) {
+        for (int j = 0; j < tj; j++) {
+            for (int i = 0; i < ti; i++) {
+                int flatidx = i + ti*(j + tj*k);
+                if (signatures[flatidx] == _tileSignatures[flatidx]) {
+                    continue;
+                }
+
+                for (int nk = (int)fmax(k - r, 0); nk <= (int)fmin(k + r, tk - 1); nk++) {
+                    for (int nj = (int)fmax(j - r, 0); nj <= (int)fmin(j + r, tj - 1); nj++) {
+                        for (int ni = (int)fmax(i - r, 0); ni <= (int)fmin(i + r, ti - 1); ni++) {
+                            isDirty[ni + ti*(nj + tj*nk)] = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LevelSet::_remapClosestTriangleIndices(std::vector<bool> &isDirty) {
+    // Triangle indices of the new mesh do not match the previous mesh. Cells
+    // in clean tiles have closest triangles that exist in both meshes and 
+    // are matched by their vertex positions. A tile with a triangle that 
+    // cannot be matched is recomputed.
+    std::unordered_map<TriangleKey, int, TriangleKeyHasher> newIndices;
+    newIndices.reserve(_surfaceMesh->triangles.size());
+    for (unsigned int i = 0; i < _surfaceMesh->triangles.size(); i++) {
+        newIndices.insert(std::pair<TriangleKey, int>(_getTriangleKey(*_surfaceMesh, i), i));
+    }
+
+    int unknown = -2;
+    std::vector<int> oldToNew(_previousSurfaceMesh->triangles.size(), unknown);
+
+    std::vector<GridIndex> tiles;
+    _indexGrid.getAllocatedTiles(tiles);
+    GridIndex gmin, gmax;
+    for (unsigned int t = 0; t < tiles.size(); t++) {
+        int flatidx = _getTileFlatIndex(tiles[t]);
+        if (isDirty[flatidx]) {
+            continue;
+        }
+
+        _indexGrid.getTileCellBounds(tiles[t], &gmin, &gmax);
+        for (int k = gmin.k; k <= gmax.k && !isDirty[flatidx]; k++) {
+            for (int j = gmin.j; j <= gmax.j && !isDirty[flatidx]; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    int oldidx = _indexGrid(i, j, k);
+                    if (oldidx < 0) {
+                        continue;
+                    }
+
+                    if (oldToNew[oldidx] == unknown) {
+                        std::unordered_map<TriangleKey, int, TriangleKeyHasher>::iterator it;
+                        it = newIndices.find(_getTriangleKey(*_previousSurfaceMesh, oldidx));
+                        oldToNew[oldidx] = it == newIndices.end() ? -1 : it->second;
+                    }
+
+                    if (oldToNew[oldidx] == -1) {
+                        isDirty[flatidx] = true;
+                        break;
+                    }
+                    _indexGrid.set(i, j, k, oldToNew[oldidx]);
+                }
+            }
+        }
+    }
+}
+
+void LevelSet::_compactLevelSetTile(GridIndex t) {
+    // Releases a tile that only contains flood filled cells of one sign
+    GridIndex gmin, gmax;
+    _isDistanceSet.getTileCellBounds(t, &gmin, &gmax);
+    float val = _signedDistance(gmin);
+    for (int k = gmin.k; k <= gmax.k; k++) {
+        for (int j = gmin.j; j <= gmax.j; j++) {
+            for (int i = gmin.i; i <= gmax.i; i++) {
+                if (!_isDistanceSet(i, j, k) || _indexGrid(i, j, k) != -1 || 
+                        _signedDistance(i, j, k) != val) {
+                    return;
+                }
+            }
+        }
+    }
+
+    _setLevelSetTile(t, val);
+}
+
+void LevelSet::_calculateSignedDistancesForTiles(int startidx, int endidx, 
+                                                 std::vector<GridIndex> *tiles) {
+    // Cells within the band get the exact distance to the closest triangle.
+    // Cells outside of the band are signed afterwards by a flood fill.
+    double maxdist = _numLayers*_dx;
+    double maxdistsq = maxdist*maxdist;
+    GridIndex g, gmin, gmax;
+    glm::vec3 c, point, v;
+    int tidx;
+    for (int t = startidx; t <= endidx; t++) {
+        _isDistanceSet.getTileCellBounds(tiles->at(t), &gmin, &gmax);
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    g = GridIndex(i, j, k);
+                    c = _gridIndexToCellCenter(g);
+                    if (_surfaceBVH.findClosestPoint(c, maxdistsq, &point, &tidx)) {
+                        double dist = glm::length(point - c);
+                        v = _surfaceMesh->getTriangleCenter(tidx) - c;
+                        if (glm::dot(v, _surfaceMesh->getTriangleFaceDirection(tidx)) < 0) {
+                            dist = -dist;
+                        }
+                        _setLevelSetCell(g, dist, tidx);
+                    } else if (_isDistanceSet(g)) {
+                        _resetLevelSetCell(g);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void LevelSet::_resetFloodFilledCells() {
+    // Fluid regions thicker than the band can appear or vanish anywhere
+    // in the grid, so the sign of a cell outside of the band cannot be 
+    // kept from the previous field. These cells are cleared and flood 
+    // filled from the band in the same way as a full update.
+    int ti, tj, tk;
+    _isDistanceSet.getTileGridDimensions(&ti, &tj, &tk);
+    GridIndex t;
+    for (int k = 0; k < tk; k++) {
+        for (int j = 0; j < tj; j++) {
+            for (int i = 0; i < ti; i++) {
+                t = GridIndex(i, j, k);
+                if (!_isDistanceSet.isTileAllocated(t)) {
+                    _signedDistance.setTileValue(t, 0.0f);
+                    _indexGrid.setTileValue(t, -1);
+                    _isDistanceSet.setTileValue(t, false);
+                }
+            }
+        }
+    }
+
+    std::vector<GridIndex> tiles;
+    _isDistanceSet.getAllocatedTiles(tiles);
+    GridIndex gmin, gmax;
+    for (unsigned int tidx = 0; tidx < tiles.size(); tidx++) {
+        _isDistanceSet.getTileCellBounds(tiles[tidx], &gmin, &gmax);
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    if (_isDistanceSet(i, j, k) && _indexGrid(i, j, k) == -1) {
+                        _resetLevelSetCell(GridIndex(i, j, k));
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool LevelSet::_updateSignedDistanceFieldIncremental(std::vector<unsigned long long> &signatures) {
+    std::vector<bool> isDirty;
+    _getDirtyTiles(signatures, isDirty);
+    _remapClosestTriangleIndices(isDirty);
+
+    int ti, tj, tk;
+    _isDistanceSet.getTileGridDimensions(&ti, &tj, &tk);
+    std::vector<GridIndex> tiles;
+    for (int k = 0; k < tk; k++) {
+        for (int j = 0; j < tj; j++) {
+            for (int i = 0; i < ti; i++) {
+                if (isDirty[i + ti*(j + tj*k)]) {
+                    tiles.push_back(GridIndex(i, j, k));
+                }
+            }
+        }
+    }
+
+    // Recomputing most of the grid tile by tile is slower than a full update
+    if (tiles.size() > 0.5*isDirty.size()) {
+        return false;
+    }
+    if (tiles.size() == 0) {
+        return true;
+    }
+
+    int numThreads = (int)fmin(_numIncrementalThreads, tiles.size());
+    std::vector<int> startIndices;
+    std::vector<int> endIndices;
+    int chunksize = (int)floor(tiles.size() / numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startIdx = (i == 0) ? 0 : endIndices[i - 1] + 1;
+        int endIdx = (i == numThreads - 1) ? (int)tiles.size() - 1 : startIdx + chunksize - 1;
+
+        startIndices.push_back(startIdx);
+        endIndices.push_back(endIdx);
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&LevelSet::_calculateSignedDistancesForTiles,
+                                      this,
+                                      startIndices[i],
+                                      endIndices[i],
+                                      &tiles));
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+    }
+
+    _resetFloodFilledCells();
+    _floodFillMissingSignedDistances();
+
+    // Compacting a tile resets the tile values of the shared grids,
+    // so it is done after the threads have finished
+    for (unsigned int i = 0; i < tiles.size(); i++) {
+        if (_isDistanceSet.isTileAllocated(tiles[i])) {
+            _compactLevelSetTile(tiles[i]);
+        }
+    }
+
+    return true;
+}
+
+void LevelSet::calculateSignedDistanceField(int numLayers) {
+    bool isIncremental = _isIncrementalUpdateEnabled && _isIncrementalDataValid &&
+                         !_isParticleDistanceField && numLayers == _numLayers;
+    _numLayers = numLayers;
+    _isParticleDistanceField = false;
+
+    // The BVH is only needed for mesh distance fields and is built 
+    // when the first mesh field is calculated for the surface
+    if (_surfaceBVH.isEmpty()) {
+        _surfaceBVH.build(*_surfaceMesh);
+    }
+
+    if (_isIncrementalUpdateEnabled) {
+        std::vector<unsigned long long> signatures;
+        _calculateTileSignatures(signatures);
+        if (isIncremental) {
+            isIncremental = _updateSignedDistanceFieldIncremental(signatures);
+        }
+        _tileSignatures = signatures;
+        _isIncrementalDataValid = true;
+    }
+
+    if (!isIncremental) {
+        _calculateSignedDistanceFieldFromMesh();
+    }
 
     _distanceField.setSignedDistanceField(_signedDistance);
 }
 
+glm::vec3 LevelSet::_findClosestPointOnSurfaceFromGradient(glm::vec3 p) {
+    if (!Grid3d::isPositionInGrid(p, _dx, _isize, _jsize, _ksize)) {
+        return p;
+    }
+
+    double h = 0.5*_dx;
+    glm::vec3 hx = glm::vec3(h, 0.0, 0.0);
+    glm::vec3 hy = glm::vec3(0.0, h, 0.0);
+    glm::vec3 hz = glm::vec3(0.0, 0.0, h);
+    double dist = _interpolateSignedDistance(p);
+    glm::vec3 grad = glm::vec3(_interpolateSignedDistance(p + hx) - _interpolateSignedDistance(p - hx),
+                               _interpolateSignedDistance(p + hy) - _interpolateSignedDistance(p - hy),
+                               _interpolateSignedDistance(p + hz) - _interpolateSignedDistance(p - hz));
+
+    double len = glm::length(grad);
+    if (len == 0.0) {
+        return p;
+    }
+
+    // distance is positive inside, so the gradient points into the fluid
+    return p - (float)(dist / len)*grad;
+}
+
 double LevelSet::_minDistToTriangleSquared(GridIndex g, int tidx) {
     glm::vec3 p = _gridIndexToCellCenter(g);
     return _minDistToTriangleSquared(p, tidx);
 }
 
 double LevelSet::_minDistToTriangleSquared(glm::vec3 p, int tidx) {
-    if (tidx < 0 || (unsigned int)tidx > _surfaceMesh.triangles.size()) {
+    if (tidx < 0 || (unsigned int)tidx > _surfaceMesh->triangles.size()) {
         return std::numeric_limits<double>::infinity();
     }
 
     glm::vec3 tri[3];
-    _surfaceMesh.getTrianglePosition(tidx, tri);
+    _surfaceMesh->getTrianglePosition(tidx, tri);
     glm::vec3 tp = Collision::findClosestPointOnTriangle(p, tri[0], tri[1], tri[2]);
     glm::vec3 v = tp - p;
     return glm::dot(v, v);
 }
 
 double LevelSet::_minDistToTriangleSquared(glm::vec3 p, int tidx, glm::vec3 *point) {
-    if (tidx < 0 || (unsigned int)tidx > _surfaceMesh.triangles.size()) {
+    if (tidx < 0 || (unsigned int)tidx > _surfaceMesh->triangles.size()) {
         return std::numeric_limits<double>::infinity();
     }
 
     glm::vec3 tri[3];
-    _surfaceMesh.getTrianglePosition(tidx, tri);
+    _surfaceMesh->getTrianglePosition(tidx, tri);
     glm::vec3 tp = Collision::findClosestPointOnTriangle(p, tri[0], tri[1], tri[2]);
     glm::vec3 v = tp - p;
 
@@ -347,80 +1191,108 @@ double LevelSet::_minDistToTriangleSquared(glm::vec3 p, int tidx, glm::vec3 *poi
 glm::vec3 LevelSet::_findClosestPointOnSurface(GridIndex g) {
     assert(Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize) && _isDistanceSet(g));
 
+    if (_isParticleDistanceField) {
+        return _findClosestPointOnSurfaceFromGradient(_gridIndexToCellCenter(g));
+    }
+
     glm::vec3 tri[3];
-    _surfaceMesh.getTrianglePosition(_indexGrid(g), tri);
+    _surfaceMesh->getTrianglePosition(_indexGrid(g), tri);
     glm::vec3 p0 = _gridIndexToCellCenter(g);
     
     return Collision::findClosestPointOnTriangle(p0, tri[0], tri[1], tri[2]);
 }
 
 glm::vec3 LevelSet::_findClosestPointOnSurface(glm::vec3 p) {
+    int tidx;
+    return _findClosestPointOnSurface(p, &tidx);
+}
+
+glm::vec3 LevelSet::_findClosestPointOnSurface(glm::vec3 p, int *tidx) {
+    if (_isParticleDistanceField) {
+        *tidx = -1;
+        return _findClosestPointOnSurfaceFromGradient(p);
+    }
+
+    // The closest triangles stored in neighbouring cells give an upper
+    // bound on the distance that is used to prune the BVH search. The 
+    // BVH also finds the surface when p is outside of the narrow band.
     GridIndex g = Grid3d::positionToGridIndex(p, _dx);
 
     GridIndex ns[7];
     _getNeighbourGridIndices6(g, ns);
     ns[6] = g;
 
-    bool isFound = false;
     double mindistsq = std::numeric_limits<double>::infinity();
     glm::vec3 minpoint = p;
+    int mint = -1;
     GridIndex n;
     for (int i = 0; i < 7; i++) {
         n = ns[i];
 
-        if (Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize) && 
-                _isDistanceSet(n)) {
+        if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
+                _isDistanceSet(n) && _indexGrid(n) >= 0) {
             glm::vec3 surfacePoint;
-            int tidx = _indexGrid(n);
-
-            if (tidx < 0) {
-                continue;
-            }
-
-            double distsq = _minDistToTriangleSquared(p, tidx, &surfacePoint);
+            double distsq = _minDistToTriangleSquared(p, _indexGrid(n), &surfacePoint);
 
             if (distsq < mindistsq) {
                 mindistsq = distsq;
                 minpoint = surfacePoint;
-                isFound = true;
+                mint = _indexGrid(n);
             }
         }
     }
 
+    glm::vec3 bvhpoint;
+    int bvhtidx;
+    if (_surfaceBVH.findClosestPoint(p, mindistsq, &bvhpoint, &bvhtidx)) {
+        minpoint = bvhpoint;
+        mint = bvhtidx;
+    }
+
+    *tidx = mint;
     return minpoint;
 }
 
-glm::vec3 LevelSet::_findClosestPointOnSurface(glm::vec3 p, int *tidx) {
-    GridIndex g = Grid3d::positionToGridIndex(p, _dx);
+void LevelSet::_findClosestPointsOnSurface(int startidx, int endidx,
+                                           std::vector<glm::vec3> *points,
+                                           std::vector<glm::vec3> *closestPoints) {
+    for (int i = startidx; i <= endidx; i++) {
+        closestPoints->at(i) = _findClosestPointOnSurface(points->at(i));
+    }
+}
 
-    GridIndex ns[7];
-    _getNeighbourGridIndices6(g, ns);
-    ns[6] = g;
+void LevelSet::getClosestPointsOnSurface(std::vector<glm::vec3> &points,
+                                         std::vector<glm::vec3> &closestPoints) {
+    closestPoints = std::vector<glm::vec3>(points.size());
+    if (points.size() == 0) {
+        return;
+    }
 
-    bool isFound = false;
-    double mindistsq = std::numeric_limits<double>::infinity();
-    glm::vec3 minpoint = p;
-    int mint;
-    GridIndex n;
-    for (int i = 0; i < 7; i++) {
-        n = ns[i];
+    int numThreads = (int)fmin(_numClosestPointThreads, points.size());
+    std::vector<int> startIndices;
+    std::vector<int> endIndices;
+    int chunksize = (int)floor(points.size() / numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startIdx = (i == 0) ? 0 : endIndices[i - 1] + 1;
+        int endIdx = (i == numThreads - 1) ? (int)points.size() - 1 : startIdx + chunksize - 1;
 
-        if (Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize) && 
-                _isDistanceSet(n)) {
-            glm::vec3 surfacePoint;
-            double distsq = _minDistToTriangleSquared(p, _indexGrid(n), &surfacePoint);
+        startIndices.push_back(startIdx);
+        endIndices.push_back(endIdx);
+    }
 
-            if (distsq < mindistsq) {
-                mindistsq = distsq;
-                minpoint = surfacePoint;
-                mint = _indexGrid(n);
-                isFound = true;
-            }
-        }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&LevelSet::_findClosestPointsOnSurface,
+                                      this,
+                                      startIndices[i],
+                                      endIndices[i],
+                                      &points,
+                                      &closestPoints));
     }
 
-    *tidx = mint;
-    return minpoint;
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+    }
 }
 
 glm::vec3 LevelSet::_evaluateVelocityAtPosition(MACVelocityField &vgrid, glm::vec3 p) {
@@ -451,152 +1323,124 @@ glm::vec3 LevelSet::getClosestPointOnSurface(glm::vec3 p, int *tidx) {
     return _findClosestPointOnSurface(p, tidx);
 }
 
-void LevelSet::_getTrianglePatch(int vertidx, double *area, std::vector<int> &tris) {
-    std::vector<int> nbs;
-    std::vector<int> processedTriangles;
-    _surfaceMesh.getVertexNeighbours(vertidx, nbs);
-
-    std::queue<int> queue;
-    for (unsigned int i = 0; i < nbs.size(); i++) {
-        queue.push(nbs[i]);
-        _triangleHash.set(nbs[i], 0, 0, true);
-        processedTriangles.push_back(nbs[i]);
-    }
-    nbs.clear();
-
-    double totalarea = 0.0;
-    while (!queue.empty() && totalarea < *area) {
-        int t = queue.front();
-        queue.pop();
-
-        _surfaceMesh.getFaceNeighbours(t, nbs);
-        for (unsigned int i = 0; i < nbs.size(); i++) {
-            if (!_triangleHash(nbs[i], 0, 0)) {
-                queue.push(nbs[i]);
-                _triangleHash.set(nbs[i], 0, 0, true);
-                processedTriangles.push_back(nbs[i]);
-            }
-        }
-        nbs.clear();
-
-        totalarea += _surfaceMesh.getTriangleArea(t);
-        tris.push_back(t);
+double LevelSet::_calculateCurvatureAtCell(int i, int j, int k) {
+    if (i < 1 || j < 1 || k < 1 || i >= _isize - 1 || j >= _jsize - 1 || k >= _ksize - 1) {
+        return 0.0;
     }
 
-    for (unsigned int i = 0; i < processedTriangles.size(); i++) {
-        _triangleHash.set(processedTriangles[i], 0, 0, false);
+    double inv2dx = 1.0 / (2.0*_dx);
+    double invdxsq = 1.0 / (_dx*_dx);
+    double inv4dxsq = 0.25*invdxsq;
+
+    double phi = _signedDistance(i, j, k);
+    double px1 = _signedDistance(i + 1, j, k);
+    double px0 = _signedDistance(i - 1, j, k);
+    double py1 = _signedDistance(i, j + 1, k);
+    double py0 = _signedDistance(i, j - 1, k);
+    double pz1 = _signedDistance(i, j, k + 1);
+    double pz0 = _signedDistance(i, j, k - 1);
+
+    double phix = (px1 - px0)*inv2dx;
+    double phiy = (py1 - py0)*inv2dx;
+    double phiz = (pz1 - pz0)*inv2dx;
+    double gradsq = phix*phix + phiy*phiy + phiz*phiz;
+    if (gradsq < 10e-12) {
+        return 0.0;
     }
 
-    *area = totalarea;
+    double phixx = (px1 - 2.0*phi + px0)*invdxsq;
+    double phiyy = (py1 - 2.0*phi + py0)*invdxsq;
+    double phizz = (pz1 - 2.0*phi + pz0)*invdxsq;
+    double phixy = (_signedDistance(i + 1, j + 1, k) - _signedDistance(i + 1, j - 1, k) -
+                    _signedDistance(i - 1, j + 1, k) + _signedDistance(i - 1, j - 1, k))*inv4dxsq;
+    double phixz = (_signedDistance(i + 1, j, k + 1) - _signedDistance(i + 1, j, k - 1) -
+                    _signedDistance(i - 1, j, k + 1) + _signedDistance(i - 1, j, k - 1))*inv4dxsq;
+    double phiyz = (_signedDistance(i, j + 1, k + 1) - _signedDistance(i, j + 1, k - 1) -
+                    _signedDistance(i, j - 1, k + 1) + _signedDistance(i, j - 1, k - 1))*inv4dxsq;
+
+    // div(grad(phi) / |grad(phi)|)
+    double num = phix*phix*(phiyy + phizz) + 
+                 phiy*phiy*(phixx + phizz) + 
+                 phiz*phiz*(phixx + phiyy) -
+                 2.0*phix*phiy*phixy - 
+                 2.0*phix*phiz*phixz - 
+                 2.0*phiy*phiz*phiyz;
+    double div = num / (gradsq*sqrt(gradsq));
+
+    // distance is positive inside, so the outward normal is -grad(phi). 
+    // Curvature is limited to what the grid can resolve.
+    double curvature = -div*_dx;
+    return fmin(fmax(curvature, -1.0), 1.0);
 }
 
-int LevelSet::_getRandomTriangle(std::vector<int> &tris, 
-                                 std::vector<double> &distribution) {
-    if (tris.size() == 1) {
-        return tris[0];
-    }
-
-    float r = (float)rand() / (float)(RAND_MAX);
-    for (unsigned int i = 0; i < tris.size()-1; i++) {
-        if (r >= distribution[i] && r < distribution[i + 1]) {
-            return tris[i];
+void LevelSet::_calculateCurvatureForTiles(int startidx, int endidx, 
+                                           std::vector<GridIndex> *tiles) {
+    GridIndex gmin, gmax;
+    for (int t = startidx; t <= endidx; t++) {
+        _curvatureGrid.getTileCellBounds(tiles->at(t), &gmin, &gmax);
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    _curvatureGrid.set(i, j, k, (float)_calculateCurvatureAtCell(i, j, k));
+                }
+            }
         }
     }
-
-    return tris.size() - 1;
-}
-
-glm::vec3 LevelSet::_getRandomPointInTriangle(int tidx) {
-    Triangle t = _surfaceMesh.triangles[tidx];
-    glm::vec3 A = _surfaceMesh.vertices[t.tri[0]];
-    glm::vec3 B = _surfaceMesh.vertices[t.tri[1]];
-    glm::vec3 C = _surfaceMesh.vertices[t.tri[2]];
-
-    float r1 = (float)rand() / (float)(RAND_MAX);
-    float r2 = (float)rand() / (float)(RAND_MAX);
-    float sqrtr1 = sqrt(r1);
-    float sqrtr2 = sqrt(r2);
-
-    return (1.0f - sqrtr1)*A + (sqrtr1*(1.0f - r2))*B + (r2*sqrtr1)*C;
 }
 
-void LevelSet::_getCurvatureSamplePoints(int vidx, std::vector<glm::vec3> &points,
-                                                   std::vector<int> &tris) {
-    double r = _surfaceCurvatureSampleRadius*_dx;
-    double area = 3.141592653*r*r;
-    std::vector<int> patch;
-    _getTrianglePatch(vidx, &area, patch);
-
-    if (patch.size() == 0) {
+void LevelSet::calculateSurfaceCurvature() {
+    // The distance field is only non-constant in allocated tiles, so
+    // curvature is zero everywhere else. Each thread writes to its own
+    // range of tiles.
+    _curvatureGrid.fill(0.0f);
+
+    std::vector<GridIndex> tiles;
+    _isDistanceSet.getAllocatedTiles(tiles);
+    if (tiles.size() == 0) {
         return;
     }
 
-    std::vector<double> areaDistribution;
-    areaDistribution.reserve(patch.size());
+    int numThreads = (int)fmin(_numCurvatureThreads, tiles.size());
+    std::vector<int> startIndices;
+    std::vector<int> endIndices;
+    int chunksize = (int)floor(tiles.size() / numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startIdx = (i == 0) ? 0 : endIndices[i - 1] + 1;
+        int endIdx = (i == numThreads - 1) ? (int)tiles.size() - 1 : startIdx + chunksize - 1;
 
-    double currentArea = 0.0;
-    for (unsigned int i = 0; i < patch.size(); i++) {
-        areaDistribution.push_back(currentArea);
-        currentArea += _surfaceMesh.getTriangleArea(patch[i]) / area;
+        startIndices.push_back(startIdx);
+        endIndices.push_back(endIdx);
     }
 
-    int maxSamples = (int)fmin(_maxSurfaceCurvatureSamples, patch.size());
-    glm::vec3 p;
-    for (int i = 0; i < maxSamples; i++) {
-        int tidx = _getRandomTriangle(patch, areaDistribution);
-        p = _getRandomPointInTriangle(tidx);
-        tris.push_back(tidx);
-        points.push_back(p);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&LevelSet::_calculateCurvatureForTiles,
+                                      this,
+                                      startIndices[i],
+                                      endIndices[i],
+                                      &tiles));
     }
-}
-
-double LevelSet::_calculateCurvatureAtVertex(int idx) {
-
-    std::vector<glm::vec3> samples;
-    std::vector<int> sampletris;
-    _getCurvatureSamplePoints(idx, samples, sampletris);
 
-    double radius = _surfaceCurvatureSampleRadius*_dx;
-    double rsq = radius*radius;
-    glm::vec3 vnorm = _surfaceMesh.normals[idx];
-    glm::vec3 p, tnorm, xji;
-    glm::vec3 v = _surfaceMesh.vertices[idx];
-    int tidx;
-    double curvature = 0.0;
-    for (unsigned int i = 0; i < samples.size(); i++) {
-        p = samples[i];
-        tidx = sampletris[i];
-
-        xji = p - v;
-        double distsq = glm::dot(xji, xji);
-        if (distsq < rsq) {
-            tnorm = _surfaceMesh.getTriangleNormalSmooth(tidx, p);
-            double k = (1 - glm::dot(vnorm, tnorm)) * (1 - (sqrt(distsq)/radius));
-            if (glm::dot(glm::normalize(xji), vnorm) > 0.0) {
-                k = 0.0;
-            }
-
-            curvature += k;
-        }
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
     }
-
-    return curvature;
 }
 
-void LevelSet::calculateSurfaceCurvature() {
-    _surfaceMesh.updateVertexTriangles();
-    _surfaceMesh.updateTriangleAreas();
-    _triangleHash = Array3d<bool>(_surfaceMesh.triangles.size(), 1, 1, false);
-
-    _vertexCurvatures.clear();
-    for (unsigned int i = 0; i < _surfaceMesh.vertices.size(); i++) {
-        double k = _calculateCurvatureAtVertex(i);
-        _vertexCurvatures.push_back(k);
+glm::vec3 LevelSet::_getSurfaceNormalFromGradient(glm::vec3 p) {
+    double h = 0.5*_dx;
+    glm::vec3 hx = glm::vec3(h, 0.0, 0.0);
+    glm::vec3 hy = glm::vec3(0.0, h, 0.0);
+    glm::vec3 hz = glm::vec3(0.0, 0.0, h);
+    glm::vec3 grad = glm::vec3(_interpolateSignedDistance(p + hx) - _interpolateSignedDistance(p - hx),
+                               _interpolateSignedDistance(p + hy) - _interpolateSignedDistance(p - hy),
+                               _interpolateSignedDistance(p + hz) - _interpolateSignedDistance(p - hz));
+
+    double len = glm::length(grad);
+    if (len == 0.0) {
+        return glm::vec3(1.0, 0.0, 0.0);
     }
 
-    _triangleHash = Array3d<bool>(0, 0, 0);
-    _surfaceMesh.clearTriangleAreas();
-    _surfaceMesh.clearVertexTriangles();
+    return -grad / (float)len;
 }
 
 double LevelSet::getSurfaceCurvature(glm::vec3 p) {
@@ -605,44 +1449,28 @@ double LevelSet::getSurfaceCurvature(glm::vec3 p) {
 }
 
 double LevelSet::getSurfaceCurvature(glm::vec3 p, glm::vec3 *normal) {
-    assert(_vertexCurvatures.size() == _surfaceMesh.vertices.size());
-
-    int tidx;
-    p = _findClosestPointOnSurface(p, &tidx);
-
-    if (tidx < 0 || (unsigned int)tidx >= _surfaceMesh.triangles.size()) {
+    p = _findClosestPointOnSurface(p);
+    if (!Grid3d::isPositionInGrid(p, _dx, _isize, _jsize, _ksize)) {
         *normal = glm::vec3(1.0, 0.0, 0.0);
         return 0.0;
     }
 
-    Triangle t = _surfaceMesh.triangles[tidx];
-    double k0 = _vertexCurvatures[t.tri[0]];
-    double k1 = _vertexCurvatures[t.tri[1]];
-    double k2 = _vertexCurvatures[t.tri[2]];
-    glm::vec3 bary = _surfaceMesh.getBarycentricCoordinates(tidx, p);
-
-    *normal = _surfaceMesh.getTriangleNormalSmooth(tidx, p);
+    *normal = _getSurfaceNormalFromGradient(p);
 
-    return (float)bary.x*k0 + (float)bary.y*k1 + (float)bary.z*k2;
+    return _interpolateCurvature(p);
 }
 
 double LevelSet::getSurfaceCurvature(unsigned int tidx) {
-    if (_vertexCurvatures.size() != _surfaceMesh.vertices.size()) {
+    if (tidx >= _surfaceMesh->triangles.size()) {
         return 0.0;
     }
-    if (tidx >= _surfaceMesh.triangles.size()) {
+
+    glm::vec3 p = _surfaceMesh->getTriangleCenter(tidx);
+    if (!Grid3d::isPositionInGrid(p, _dx, _isize, _jsize, _ksize)) {
         return 0.0;
     }
 
-    assert(_vertexCurvatures.size() == _surfaceMesh.vertices.size());
-    assert(tidx < _surfaceMesh.triangles.size());
-
-    Triangle t = _surfaceMesh.triangles[tidx];
-    double k0 = _vertexCurvatures[t.tri[0]];
-    double k1 = _vertexCurvatures[t.tri[1]];
-    double k2 = _vertexCurvatures[t.tri[2]];
-
-    return (k0 + k1 + k2) / 3.0;
+    return _interpolateCurvature(p);
 }
 
 double LevelSet::_trilinearInterpolate(double p[8], double x, double y, double z) {
@@ -657,6 +1485,14 @@ double LevelSet::_trilinearInterpolate(double p[8], double x, double y, double z
 }
 
 double LevelSet::_interpolateSignedDistance(glm::vec3 p) {
+    return _interpolateGridValue(_signedDistance, p);
+}
+
+double LevelSet::_interpolateCurvature(glm::vec3 p) {
+    return _interpolateGridValue(_curvatureGrid, p);
+}
+
+double LevelSet::_interpolateGridValue(TiledArray3d<float> &grid, glm::vec3 p) {
     p -= glm::vec3(0.5*_dx, 0.5*_dx, 0.5*_dx);
 
     GridIndex g = Grid3d::positionToGridIndex(p, _dx);
@@ -671,28 +1507,28 @@ double LevelSet::_interpolateSignedDistance(glm::vec3 p) {
 
     double points[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
     if (Grid3d::isGridIndexInRange(g.i,   g.j,   g.k, _isize, _jsize, _ksize))   { 
-        points[0] = _signedDistance(g.i,   g.j,   g.k); 
+        points[0] = grid(g.i,   g.j,   g.k); 
     }
     if (Grid3d::isGridIndexInRange(g.i+1, g.j,   g.k, _isize, _jsize, _ksize))   { 
-        points[1] = _signedDistance(g.i+1, g.j,   g.k); 
+        points[1] = grid(g.i+1, g.j,   g.k); 
     }
     if (Grid3d::isGridIndexInRange(g.i,   g.j+1, g.k, _isize, _jsize, _ksize))   { 
-        points[2] = _signedDistance(g.i,   g.j+1, g.k); 
+        points[2] = grid(g.i,   g.j+1, g.k); 
     }
     if (Grid3d::isGridIndexInRange(g.i,   g.j,   g.k+1, _isize, _jsize, _ksize)) {
-        points[3] = _signedDistance(g.i,   g.j,   g.k+1); 
+        points[3] = grid(g.i,   g.j,   g.k+1); 
     }
     if (Grid3d::isGridIndexInRange(g.i+1, g.j,   g.k+1, _isize, _jsize, _ksize)) { 
-        points[4] = _signedDistance(g.i+1, g.j,   g.k+1); 
+        points[4] = grid(g.i+1, g.j,   g.k+1); 
     }
     if (Grid3d::isGridIndexInRange(g.i,   g.j+1, g.k+1, _isize, _jsize, _ksize)) { 
-        points[5] = _signedDistance(g.i,   g.j+1, g.k+1); 
+        points[5] = grid(g.i,   g.j+1, g.k+1); 
     }
     if (Grid3d::isGridIndexInRange(g.i+1, g.j+1, g.k, _isize, _jsize, _ksize))   { 
-        points[6] = _signedDistance(g.i+1, g.j+1, g.k); 
+        points[6] = grid(g.i+1, g.j+1, g.k); 
     }
     if (Grid3d::isGridIndexInRange(g.i+1, g.j+1, g.k+1, _isize, _jsize, _ksize)) { 
-        points[7] = _signedDistance(g.i+1, g.j+1, g.k+1); 
+        points[7] = grid(g.i+1, g.j+1, g.k+1); 
     }
 
     return _trilinearInterpolate(points, ix, iy, iz);
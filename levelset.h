@@ -24,14 +24,20 @@ freely, subject to the following restrictions:
 #include <string>
 #include <vector>
 #include <queue>
+#include <thread>
+#include <limits>
+#include <unordered_map>
+#include <string.h>
 
 #include "glm/glm.hpp"
 #include "array3d.h"
+#include "tiledarray3d.h"
 #include "grid3d.h"
 #include "collision.h"
 #include "trianglemesh.h"
 #include "macvelocityfield.h"
 #include "levelsetfield.h"
+#include "meshbvh.h"
 
 class LevelSet
 {
@@ -40,16 +46,25 @@ public:
     LevelSet(int i, int j, int k, double dx);
     ~LevelSet();
 
-    void setSurfaceMesh(TriangleMesh mesh);
+    void setSurfaceMesh(TriangleMesh &mesh);
+    void setSurfaceMesh(TriangleMeshSnapshot mesh);
     void calculateSignedDistanceField();
     void calculateSignedDistanceField(int numLayers);
+    void calculateSignedDistanceField(std::vector<glm::vec3> &particles, 
+                                      double radius, int numLayers);
+    void enableFastMarching();
+    void disableFastMarching();
+    void enableIncrementalUpdate();
+    void disableIncrementalUpdate();
     void calculateSurfaceCurvature();
     double getSurfaceCurvature(glm::vec3 p);
     double getSurfaceCurvature(glm::vec3 p, glm::vec3 *normal);
     double getSurfaceCurvature(unsigned int tidx);
-    Array3d<float> getSignedDistanceField() { return _signedDistance; }
+    Array3d<float> getSignedDistanceField();
     glm::vec3 getClosestPointOnSurface(glm::vec3 p);
     glm::vec3 getClosestPointOnSurface(glm::vec3 p, int *tidx);
+    void getClosestPointsOnSurface(std::vector<glm::vec3> &points,
+                                   std::vector<glm::vec3> &closestPoints);
     double getDistance(glm::vec3 p);
     double getSignedDistance(glm::vec3 p);
     double getDistance(GridIndex g);
@@ -57,43 +72,127 @@ public:
     bool isPointInInsideCell(glm::vec3 p);
 
 private:
+    struct MarchingCell {
+        GridIndex index;
+        float distance;
+
+        MarchingCell() : distance(0.0f) {}
+        MarchingCell(GridIndex g, float d) : index(g), distance(d) {}
+    };
+
+    struct MarchingCellCompare {
+        bool operator()(const MarchingCell &a, const MarchingCell &b) const {
+            return a.distance > b.distance;
+        }
+    };
+
+    struct TriangleKey {
+        float v[9];
+
+        bool operator==(const TriangleKey &other) const {
+            return memcmp(v, other.v, sizeof(v)) == 0;
+        }
+    };
+
+    struct TriangleKeyHasher {
+        std::size_t operator()(const TriangleKey &key) const {
+            std::size_t h = 0;
+            unsigned int bits;
+            for (int i = 0; i < 9; i++) {
+                memcpy(&bits, &key.v[i], sizeof(unsigned int));
+                h ^= bits + 0x9e3779b9 + (h << 6) + (h >> 2);
+            }
+            return h;
+        }
+    };
+
+    typedef std::priority_queue<MarchingCell, 
+                                std::vector<MarchingCell>, 
+                                MarchingCellCompare> MarchingQueue;
+
     void _resetSignedDistanceField();
     void _calculateUnsignedSurfaceDistanceSquared();
+    void _calculateUnsignedSurfaceDistanceSquaredForSlabs(int kstart, int kend,
+                                                          std::vector<int> *triangleKMin,
+                                                          std::vector<int> *triangleKMax);
     void _calculateDistancesSquaredForTriangle(int triangleIndex);
+    void _calculateDistancesSquaredForTriangle(int triangleIndex, int kstart, int kend);
     void _getTriangleGridCellOverlap(Triangle t, std::vector<GridIndex> &cells);
+    void _getTriangleGridCellOverlap(Triangle t, int kstart, int kend, 
+                                     std::vector<GridIndex> &cells);
     void _calculateUnsignedDistanceSquared();
     void _getCellLayers(std::vector<std::vector<GridIndex>> &layers);
     void _getNeighbourGridIndices6(GridIndex g, GridIndex n[6]);
     void _getLayerCells(int idx, std::vector<GridIndex> &layer, 
                                  std::vector<GridIndex> &nextLayer,
-                                 Array3d<int> &layerGrid);
+                                 TiledArray3d<int> &layerGrid);
     void _calculateUnsignedDistanceSquaredForLayer(std::vector<GridIndex> &q);
     void _setLevelSetCell(GridIndex g, double dist, int tidx);
     void _resetLevelSetCell(GridIndex g);
     void _squareRootDistanceField();
+    void _calculateUnsignedDistanceFastMarching();
+    void _fastMarchUnsignedDistance(std::vector<GridIndex> &front, TiledArray3d<bool> &isFrozen);
+    void _calculateParticleSignedDistances(std::vector<glm::vec3> &particles, 
+                                           double radius, 
+                                           TiledArray3d<float> &phi,
+                                           TiledArray3d<bool> &isSet);
+    void _initializeParticleInterfaceCells(TiledArray3d<float> &phi, 
+                                           TiledArray3d<bool> &isInside,
+                                           std::vector<GridIndex> &front,
+                                           TiledArray3d<bool> &isFrozen);
+    glm::vec3 _findClosestPointOnSurfaceFromGradient(glm::vec3 p);
+    void _calculateExactDistancesForFirstLayer(std::vector<GridIndex> &layer);
+    void _updateTentativeDistance(GridIndex g, TiledArray3d<bool> &isFrozen, 
+                                  MarchingQueue &queue);
+    double _solveEikonal(double a, double b, double c);
     void _calculateDistanceFieldSigns();
     void _updateCellSign(GridIndex g, std::vector<glm::vec3> &triangleCenters, 
                                       std::vector<glm::vec3> &triangleDirections);
     void _floodFillMissingSignedDistances();
+    void _calculateSignedDistanceFieldFromMesh();
+    TriangleKey _getTriangleKey(const TriangleMesh &mesh, int tidx);
+    void _calculateTileSignatures(std::vector<unsigned long long> &signatures);
+    bool _updateSignedDistanceFieldIncremental(std::vector<unsigned long long> &signatures);
+    void _getDirtyTiles(std::vector<unsigned long long> &signatures, 
+                        std::vector<bool> &isDirty);
+    void _remapClosestTriangleIndices(std::vector<bool> &isDirty);
+    void _calculateSignedDistancesForTiles(int startidx, int endidx, 
+                                           std::vector<GridIndex> *tiles);
+    void _compactLevelSetTile(GridIndex t);
+    void _resetFloodFilledCells();
+    inline int _getTileFlatIndex(GridIndex t) {
+        int ti, tj, tk;
+        _isDistanceSet.getTileGridDimensions(&ti, &tj, &tk);
+        return t.i + ti*(t.j + tj*t.k);
+    }
     void _floodFillWithDistance(GridIndex g, double val);
+    void _markFloodFillCell(GridIndex g, double val, std::vector<GridIndex> &cellQueue,
+                                                     std::vector<GridIndex> &tileQueue);
+    void _setLevelSetTile(GridIndex t, double dist);
+    void _getTileFaceCells(GridIndex t, GridIndex neighbourTile, 
+                           std::vector<GridIndex> &cells);
+    void _getSetCells(std::vector<GridIndex> &cells);
 
     glm::vec3 _findClosestPointOnSurface(GridIndex g);
     glm::vec3 _findClosestPointOnSurface(glm::vec3 p);
     glm::vec3 _findClosestPointOnSurface(glm::vec3 p, int *tidx);
+    void _findClosestPointsOnSurface(int startidx, int endidx,
+                                     std::vector<glm::vec3> *points,
+                                     std::vector<glm::vec3> *closestPoints);
     glm::vec3 _evaluateVelocityAtPosition(MACVelocityField &vgrid, glm::vec3 p);
     glm::vec3 _evaluateVelocityAtGridIndex(MACVelocityField &vgrid, GridIndex g);
     double _minDistToTriangleSquared(glm::vec3 p, int tidx);
     double _minDistToTriangleSquared(GridIndex g, int tidx);
     double _minDistToTriangleSquared(glm::vec3 p, int tidx, glm::vec3 *point);
 
-    double _calculateCurvatureAtVertex(int idx);
-    void _getCurvatureSamplePoints(int vidx, std::vector<glm::vec3> &points,
-                                             std::vector<int> &tris);
-    void _getTrianglePatch(int vertexIndex, double *area, std::vector<int> &tris);
-    int _getRandomTriangle(std::vector<int> &tris, std::vector<double> &distribution);
-    glm::vec3 _getRandomPointInTriangle(int tidx);
+    void _calculateCurvatureForTiles(int startidx, int endidx, 
+                                     std::vector<GridIndex> *tiles);
+    double _calculateCurvatureAtCell(int i, int j, int k);
+    glm::vec3 _getSurfaceNormalFromGradient(glm::vec3 p);
 
     double _interpolateSignedDistance(glm::vec3 p);
+    double _interpolateCurvature(glm::vec3 p);
+    double _interpolateGridValue(TiledArray3d<float> &grid, glm::vec3 p);
     double _trilinearInterpolate(double points[8], 
                                  double ix, double iy, double iz);
 
@@ -127,19 +226,38 @@ private:
     int _jsize = 0;
     int _ksize = 0;
     int _numLayers;
+    int _numSurfaceDistanceThreads = 8;
+    bool _isFastMarchingEnabled = false;
+
+    // Incremental updates only recompute tiles near surface triangles 
+    // that changed since the previous mesh distance field
+    bool _isIncrementalUpdateEnabled = false;
+    bool _isIncrementalDataValid = false;
+    int _numIncrementalThreads = 8;
+    TriangleMeshSnapshot _previousSurfaceMesh = std::make_shared<const TriangleMesh>();
+    std::vector<unsigned long long> _tileSignatures;
+
+    // Distance field was built from marker particles and has no
+    // closest triangle information
+    bool _isParticleDistanceField = false;
 
-    TriangleMesh _surfaceMesh;
+    // Shared with the simulation instead of copied
+    TriangleMeshSnapshot _surfaceMesh = std::make_shared<const TriangleMesh>();
+    MeshBVH _surfaceBVH;
+    int _numClosestPointThreads = 8;
 
-    Array3d<float> _signedDistance;
-    Array3d<int> _indexGrid;
-    Array3d<bool> _isDistanceSet;
+    // Only tiles near the surface are allocated. Tiles far from the
+    // surface are constant once the field has been flood filled.
+    TiledArray3d<float> _signedDistance;
+    TiledArray3d<int> _indexGrid;
+    TiledArray3d<bool> _isDistanceSet;
 
     LevelSetField _distanceField;
 
-    std::vector<double> _vertexCurvatures;
-    double _surfaceCurvatureSampleRadius = 6.0;  // radius in # of cells
-    int _maxSurfaceCurvatureSamples = 40;
-    Array3d<bool> _triangleHash;
+    // Mean curvature of the signed distance field scaled by the cell
+    // size. Convex regions of the surface have positive curvature.
+    TiledArray3d<float> _curvatureGrid;
+    int _numCurvatureThreads = 8;
     
 };
 
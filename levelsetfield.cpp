@@ -22,7 +22,7 @@ freely, subject to the following restrictions:
 
 LevelSetField::LevelSetField(int i, int j, int k, double dx) :
                              SurfaceField(i, j, k, dx),
-                             _distanceField(Array3d<float>(i, j, k, 1.0f))
+                             _distanceField(i, j, k, 1.0f)
 {
     setSurfaceThreshold(_surfaceThreshold);
 }
@@ -98,6 +98,19 @@ double LevelSetField::getFieldValue(glm::vec3 p) {
 }
 
 void LevelSetField::setSignedDistanceField(Array3d<float> distField) {
+    TiledArray3d<float> field(distField.width, distField.height, distField.depth, 0.0f);
+    for (int k = 0; k < distField.depth; k++) {
+        for (int j = 0; j < distField.height; j++) {
+            for (int i = 0; i < distField.width; i++) {
+                field.set(i, j, k, distField(i, j, k));
+            }
+        }
+    }
+
+    _distanceField = field;
+}
+
+void LevelSetField::setSignedDistanceField(TiledArray3d<float> &distField) {
     _distanceField = distField;
 }
 
@@ -20,6 +20,7 @@ freely, subject to the following restrictions:
 #pragma once
 #include "surfacefield.h"
 #include "stopwatch.h"
+#include "tiledarray3d.h"
 
 
 class LevelSetField : public SurfaceField
@@ -33,6 +34,7 @@ public:
     virtual double getFieldValue(glm::vec3 p);
 
     void setSignedDistanceField(Array3d<float> distField);
+    void setSignedDistanceField(TiledArray3d<float> &distField);
     bool isCellInside(GridIndex g) { return _distanceField(g) > 0.0; };
     double getFieldValueAtCellCenter(GridIndex g) { return _distanceField(g); };
 
@@ -44,6 +46,6 @@ private:
     double _trilinearInterpolate(double p[8], double x, double y, double z);
 
     double _surfaceThreshold = 0.0;
-    Array3d<float> _distanceField;
+    TiledArray3d<float> _distanceField;
 };
 
@@ -90,7 +90,7 @@ float MACVelocityField::U(int i, int j, int k) {
         return _default_out_of_range_value;
     }
 
-    return _u(i, j, k);
+    return _u.get(i, j, k);
 }
 
 float MACVelocityField::V(int i, int j, int k) {
@@ -98,7 +98,7 @@ float MACVelocityField::V(int i, int j, int k) {
         return _default_out_of_range_value;
     }
 
-    return _v(i, j, k);
+    return _v.get(i, j, k);
 }
 
 float MACVelocityField::W(int i, int j, int k) {
@@ -106,7 +106,7 @@ float MACVelocityField::W(int i, int j, int k) {
         return _default_out_of_range_value;
     }
 
-    return _w(i, j, k);
+    return _w.get(i, j, k);
 }
 
 float MACVelocityField::U(GridIndex g) {
@@ -114,7 +114,7 @@ float MACVelocityField::U(GridIndex g) {
         return _default_out_of_range_value;
     }
 
-    return _u(g);
+    return _u.get(g);
 }
 
 float MACVelocityField::V(GridIndex g) {
@@ -122,7 +122,7 @@ float MACVelocityField::V(GridIndex g) {
         return _default_out_of_range_value;
     }
 
-    return _v(g);
+    return _v.get(g);
 }
 
 float MACVelocityField::W(GridIndex g) {
@@ -130,7 +130,7 @@ float MACVelocityField::W(GridIndex g) {
         return _default_out_of_range_value;
     }
 
-    return _w(g);
+    return _w.get(g);
 }
 
 void MACVelocityField::setU(int i, int j, int k, double val) {
@@ -138,7 +138,7 @@ void MACVelocityField::setU(int i, int j, int k, double val) {
         return;
     }
 
-    _u.set(i, j, k, (float)val);
+    _u.at(i, j, k) = (float)val;
 }
 
 void MACVelocityField::setV(int i, int j, int k, double val) {
@@ -146,7 +146,7 @@ void MACVelocityField::setV(int i, int j, int k, double val) {
         return;
     }
 
-    _v.set(i, j, k, (float)val);
+    _v.at(i, j, k) = (float)val;
 }
 
 void MACVelocityField::setW(int i, int j, int k, double val) {
@@ -154,7 +154,7 @@ void MACVelocityField::setW(int i, int j, int k, double val) {
         return;
     }
 
-    _w.set(i, j, k, (float)val);
+    _w.at(i, j, k) = (float)val;
 }
 
 void MACVelocityField::setU(GridIndex g, double val) {
@@ -195,7 +195,7 @@ void MACVelocityField::addU(int i, int j, int k, double val) {
         return;
     }
 
-    _u.add(i, j, k, (float)val);
+    _u.at(i, j, k) += (float)val;
 }
 
 void MACVelocityField::addV(int i, int j, int k, double val) {
@@ -203,7 +203,7 @@ void MACVelocityField::addV(int i, int j, int k, double val) {
         return;
     }
 
-    _v.add(i, j, k, (float)val);
+    _v.at(i, j, k) += (float)val;
 }
 
 void MACVelocityField::addW(int i, int j, int k, double val) {
@@ -211,7 +211,7 @@ void MACVelocityField::addW(int i, int j, int k, double val) {
         return;
     }
 
-    _w.add(i, j, k, (float)val);
+    _w.at(i, j, k) += (float)val;
 }
 
 glm::vec3 MACVelocityField::velocityIndexToPositionU(int i, int j, int k) {
@@ -350,6 +350,24 @@ double MACVelocityField::_trilinearInterpolate(double p[8], double x, double y,
            p[7] * x * y * z;
 }
 
+// Gradient of the trilinear interpolant in unit cell coordinates
+glm::vec3 MACVelocityField::_trilinearInterpolateGradient(double p[8], double x, double y, double z) {
+    double dx = (p[1] - p[0]) * (1 - y) * (1 - z) +
+                (p[6] - p[2]) * y * (1 - z) +
+                (p[4] - p[3]) * (1 - y) * z +
+                (p[7] - p[5]) * y * z;
+    double dy = (p[2] - p[0]) * (1 - x) * (1 - z) +
+                (p[6] - p[1]) * x * (1 - z) +
+                (p[5] - p[3]) * (1 - x) * z +
+                (p[7] - p[4]) * x * z;
+    double dz = (p[3] - p[0]) * (1 - x) * (1 - y) +
+                (p[4] - p[1]) * x * (1 - y) +
+                (p[5] - p[2]) * (1 - x) * y +
+                (p[7] - p[6]) * x * y;
+
+    return glm::vec3(dx, dy, dz);
+}
+
 double MACVelocityField::_tricubicInterpolate(double p[4][4][4], double x, double y, double z) {
     assert(x >= 0 && x <= 1 && y >= 0 && y <= 1 && z >= 0 && z <= 1);
 
@@ -402,7 +420,7 @@ double MACVelocityField::_interpolateU(double x, double y, double z) {
         for (int pj = 0; pj < 4; pj++) {
             for (int pi = 0; pi < 4; pi++) {
                 if (_u.isIndexInRange(pi + refi, pj + refj, pk + refk)) {
-                    points[pi][pj][pk] = U(pi + refi, pj + refj, pk + refk);
+                    points[pi][pj][pk] = _u.get(pi + refi, pj + refj, pk + refk);
                 } else {
                     points[pi][pj][pk] = 0.0;
                 }
@@ -441,7 +459,7 @@ double MACVelocityField::_interpolateV(double x, double y, double z) {
         for (int pj = 0; pj < 4; pj++) {
             for (int pi = 0; pi < 4; pi++) {
                 if (_v.isIndexInRange(pi + refi, pj + refj, pk + refk)) {
-                    points[pi][pj][pk] = V(pi + refi, pj + refj, pk + refk);
+                    points[pi][pj][pk] = _v.get(pi + refi, pj + refj, pk + refk);
                 } else {
                     points[pi][pj][pk] = 0;
                 }
@@ -480,7 +498,7 @@ double MACVelocityField::_interpolateW(double x, double y, double z) {
         for (int pj = 0; pj < 4; pj++) {
             for (int pi = 0; pi < 4; pi++) {
                 if (_w.isIndexInRange(pi + refi, pj + refj, pk + refk)) {
-                    points[pi][pj][pk] = W(pi + refi, pj + refj, pk + refk);
+                    points[pi][pj][pk] = _w.get(pi + refi, pj + refj, pk + refk);
                 } else {
                     points[pi][pj][pk] = 0;
                 }
@@ -512,14 +530,14 @@ double MACVelocityField::_interpolateLinearU(double x, double y, double z) {
     assert(ix >= 0 && ix < 1 && iy >= 0 && iy < 1 && iz >= 0 && iz < 1);
 
     double points[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-    if (_u.isIndexInRange(i,   j,   k))   { points[0] = _u(i,   j,   k); }
-    if (_u.isIndexInRange(i+1, j,   k))   { points[1] = _u(i+1, j,   k); }
-    if (_u.isIndexInRange(i,   j+1, k))   { points[2] = _u(i,   j+1, k); }
-    if (_u.isIndexInRange(i,   j,   k+1)) { points[3] = _u(i,   j,   k+1); }
-    if (_u.isIndexInRange(i+1, j,   k+1)) { points[4] = _u(i+1, j,   k+1); }
-    if (_u.isIndexInRange(i,   j+1, k+1)) { points[5] = _u(i,   j+1, k+1); }
-    if (_u.isIndexInRange(i+1, j+1, k))   { points[6] = _u(i+1, j+1, k); }
-    if (_u.isIndexInRange(i+1, j+1, k+1)) { points[7] = _u(i+1, j+1, k+1); }
+    if (_u.isIndexInRange(i,   j,   k))   { points[0] = _u.get(i,   j,   k); }
+    if (_u.isIndexInRange(i+1, j,   k))   { points[1] = _u.get(i+1, j,   k); }
+    if (_u.isIndexInRange(i,   j+1, k))   { points[2] = _u.get(i,   j+1, k); }
+    if (_u.isIndexInRange(i,   j,   k+1)) { points[3] = _u.get(i,   j,   k+1); }
+    if (_u.isIndexInRange(i+1, j,   k+1)) { points[4] = _u.get(i+1, j,   k+1); }
+    if (_u.isIndexInRange(i,   j+1, k+1)) { points[5] = _u.get(i,   j+1, k+1); }
+    if (_u.isIndexInRange(i+1, j+1, k))   { points[6] = _u.get(i+1, j+1, k); }
+    if (_u.isIndexInRange(i+1, j+1, k+1)) { points[7] = _u.get(i+1, j+1, k+1); }
 
     return _trilinearInterpolate(points, ix, iy, iz);
 }
@@ -545,14 +563,14 @@ double MACVelocityField::_interpolateLinearV(double x, double y, double z) {
     assert(ix >= 0 && ix < 1 && iy >= 0 && iy < 1 && iz >= 0 && iz < 1);
 
     double points[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-    if (_v.isIndexInRange(i,   j,   k))   { points[0] = _v(i,   j,   k); }
-    if (_v.isIndexInRange(i+1, j,   k))   { points[1] = _v(i+1, j,   k); }
-    if (_v.isIndexInRange(i,   j+1, k))   { points[2] = _v(i,   j+1, k); }
-    if (_v.isIndexInRange(i,   j,   k+1)) { points[3] = _v(i,   j,   k+1); }
-    if (_v.isIndexInRange(i+1, j,   k+1)) { points[4] = _v(i+1, j,   k+1); }
-    if (_v.isIndexInRange(i,   j+1, k+1)) { points[5] = _v(i,   j+1, k+1); }
-    if (_v.isIndexInRange(i+1, j+1, k))   { points[6] = _v(i+1, j+1, k); }
-    if (_v.isIndexInRange(i+1, j+1, k+1)) { points[7] = _v(i+1, j+1, k+1); }
+    if (_v.isIndexInRange(i,   j,   k))   { points[0] = _v.get(i,   j,   k); }
+    if (_v.isIndexInRange(i+1, j,   k))   { points[1] = _v.get(i+1, j,   k); }
+    if (_v.isIndexInRange(i,   j+1, k))   { points[2] = _v.get(i,   j+1, k); }
+    if (_v.isIndexInRange(i,   j,   k+1)) { points[3] = _v.get(i,   j,   k+1); }
+    if (_v.isIndexInRange(i+1, j,   k+1)) { points[4] = _v.get(i+1, j,   k+1); }
+    if (_v.isIndexInRange(i,   j+1, k+1)) { points[5] = _v.get(i,   j+1, k+1); }
+    if (_v.isIndexInRange(i+1, j+1, k))   { points[6] = _v.get(i+1, j+1, k); }
+    if (_v.isIndexInRange(i+1, j+1, k+1)) { points[7] = _v.get(i+1, j+1, k+1); }
 
     return _trilinearInterpolate(points, ix, iy, iz);
 }
@@ -578,18 +596,117 @@ double MACVelocityField::_interpolateLinearW(double x, double y, double z) {
     assert(ix >= 0 && ix < 1 && iy >= 0 && iy < 1 && iz >= 0 && iz < 1);
 
     double points[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-    if (_w.isIndexInRange(i,   j,   k))   { points[0] = _w(i,   j,   k); }
-    if (_w.isIndexInRange(i+1, j,   k))   { points[1] = _w(i+1, j,   k); }
-    if (_w.isIndexInRange(i,   j+1, k))   { points[2] = _w(i,   j+1, k); }
-    if (_w.isIndexInRange(i,   j,   k+1)) { points[3] = _w(i,   j,   k+1); }
-    if (_w.isIndexInRange(i+1, j,   k+1)) { points[4] = _w(i+1, j,   k+1); }
-    if (_w.isIndexInRange(i,   j+1, k+1)) { points[5] = _w(i,   j+1, k+1); }
-    if (_w.isIndexInRange(i+1, j+1, k))   { points[6] = _w(i+1, j+1, k); }
-    if (_w.isIndexInRange(i+1, j+1, k+1)) { points[7] = _w(i+1, j+1, k+1); }
+    if (_w.isIndexInRange(i,   j,   k))   { points[0] = _w.get(i,   j,   k); }
+    if (_w.isIndexInRange(i+1, j,   k))   { points[1] = _w.get(i+1, j,   k); }
+    if (_w.isIndexInRange(i,   j+1, k))   { points[2] = _w.get(i,   j+1, k); }
+    if (_w.isIndexInRange(i,   j,   k+1)) { points[3] = _w.get(i,   j,   k+1); }
+    if (_w.isIndexInRange(i+1, j,   k+1)) { points[4] = _w.get(i+1, j,   k+1); }
+    if (_w.isIndexInRange(i,   j+1, k+1)) { points[5] = _w.get(i,   j+1, k+1); }
+    if (_w.isIndexInRange(i+1, j+1, k))   { points[6] = _w.get(i+1, j+1, k); }
+    if (_w.isIndexInRange(i+1, j+1, k+1)) { points[7] = _w.get(i+1, j+1, k+1); }
 
     return _trilinearInterpolate(points, ix, iy, iz);
 }
 
+glm::vec3 MACVelocityField::_interpolateLinearGradientU(double x, double y, double z) {
+    if (!Grid3d::isPositionInGrid(x, y, z, _dx, _isize, _jsize, _ksize)) {
+        return glm::vec3(0.0, 0.0, 0.0);
+    }
+
+    y -= 0.5*_dx;
+    z -= 0.5*_dx;
+
+    int i, j, k;
+    double gx, gy, gz;
+    Grid3d::positionToGridIndex(x, y, z, _dx, &i, &j, &k);
+    Grid3d::GridIndexToPosition(i, j, k, _dx, &gx, &gy, &gz);
+
+    double inv_dx = 1 / _dx;
+    double ix = (x - gx)*inv_dx;
+    double iy = (y - gy)*inv_dx;
+    double iz = (z - gz)*inv_dx;
+
+    assert(ix >= 0 && ix < 1 && iy >= 0 && iy < 1 && iz >= 0 && iz < 1);
+
+    double points[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (_u.isIndexInRange(i,   j,   k))   { points[0] = _u.get(i,   j,   k); }
+    if (_u.isIndexInRange(i+1, j,   k))   { points[1] = _u.get(i+1, j,   k); }
+    if (_u.isIndexInRange(i,   j+1, k))   { points[2] = _u.get(i,   j+1, k); }
+    if (_u.isIndexInRange(i,   j,   k+1)) { points[3] = _u.get(i,   j,   k+1); }
+    if (_u.isIndexInRange(i+1, j,   k+1)) { points[4] = _u.get(i+1, j,   k+1); }
+    if (_u.isIndexInRange(i,   j+1, k+1)) { points[5] = _u.get(i,   j+1, k+1); }
+    if (_u.isIndexInRange(i+1, j+1, k))   { points[6] = _u.get(i+1, j+1, k); }
+    if (_u.isIndexInRange(i+1, j+1, k+1)) { points[7] = _u.get(i+1, j+1, k+1); }
+
+    return (float)inv_dx*_trilinearInterpolateGradient(points, ix, iy, iz);
+}
+
+glm::vec3 MACVelocityField::_interpolateLinearGradientV(double x, double y, double z) {
+    if (!Grid3d::isPositionInGrid(x, y, z, _dx, _isize, _jsize, _ksize)) {
+        return glm::vec3(0.0, 0.0, 0.0);
+    }
+
+    x -= 0.5*_dx;
+    z -= 0.5*_dx;
+
+    int i, j, k;
+    double gx, gy, gz;
+    Grid3d::positionToGridIndex(x, y, z, _dx, &i, &j, &k);
+    Grid3d::GridIndexToPosition(i, j, k, _dx, &gx, &gy, &gz);
+
+    double inv_dx = 1 / _dx;
+    double ix = (x - gx)*inv_dx;
+    double iy = (y - gy)*inv_dx;
+    double iz = (z - gz)*inv_dx;
+
+    assert(ix >= 0 && ix < 1 && iy >= 0 && iy < 1 && iz >= 0 && iz < 1);
+
+    double points[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (_v.isIndexInRange(i,   j,   k))   { points[0] = _v.get(i,   j,   k); }
+    if (_v.isIndexInRange(i+1, j,   k))   { points[1] = _v.get(i+1, j,   k); }
+    if (_v.isIndexInRange(i,   j+1, k))   { points[2] = _v.get(i,   j+1, k); }
+    if (_v.isIndexInRange(i,   j,   k+1)) { points[3] = _v.get(i,   j,   k+1); }
+    if (_v.isIndexInRange(i+1, j,   k+1)) { points[4] = _v.get(i+1, j,   k+1); }
+    if (_v.isIndexInRange(i,   j+1, k+1)) { points[5] = _v.get(i,   j+1, k+1); }
+    if (_v.isIndexInRange(i+1, j+1, k))   { points[6] = _v.get(i+1, j+1, k); }
+    if (_v.isIndexInRange(i+1, j+1, k+1)) { points[7] = _v.get(i+1, j+1, k+1); }
+
+    return (float)inv_dx*_trilinearInterpolateGradient(points, ix, iy, iz);
+}
+
+glm::vec3 MACVelocityField::_interpolateLinearGradientW(double x, double y, double z) {
+    if (!Grid3d::isPositionInGrid(x, y, z, _dx, _isize, _jsize, _ksize)) {
+        return glm::vec3(0.0, 0.0, 0.0);
+    }
+
+    x -= 0.5*_dx;
+    y -= 0.5*_dx;
+
+    int i, j, k;
+    double gx, gy, gz;
+    Grid3d::positionToGridIndex(x, y, z, _dx, &i, &j, &k);
+    Grid3d::GridIndexToPosition(i, j, k, _dx, &gx, &gy, &gz);
+
+    double inv_dx = 1 / _dx;
+    double ix = (x - gx)*inv_dx;
+    double iy = (y - gy)*inv_dx;
+    double iz = (z - gz)*inv_dx;
+
+    assert(ix >= 0 && ix < 1 && iy >= 0 && iy < 1 && iz >= 0 && iz < 1);
+
+    double points[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (_w.isIndexInRange(i,   j,   k))   { points[0] = _w.get(i,   j,   k); }
+    if (_w.isIndexInRange(i+1, j,   k))   { points[1] = _w.get(i+1, j,   k); }
+    if (_w.isIndexInRange(i,   j+1, k))   { points[2] = _w.get(i,   j+1, k); }
+    if (_w.isIndexInRange(i,   j,   k+1)) { points[3] = _w.get(i,   j,   k+1); }
+    if (_w.isIndexInRange(i+1, j,   k+1)) { points[4] = _w.get(i+1, j,   k+1); }
+    if (_w.isIndexInRange(i,   j+1, k+1)) { points[5] = _w.get(i,   j+1, k+1); }
+    if (_w.isIndexInRange(i+1, j+1, k))   { points[6] = _w.get(i+1, j+1, k); }
+    if (_w.isIndexInRange(i+1, j+1, k+1)) { points[7] = _w.get(i+1, j+1, k+1); }
+
+    return (float)inv_dx*_trilinearInterpolateGradient(points, ix, iy, iz);
+}
+
 double MACVelocityField::_interpolateDeltaVelocityU(double x, double y, double z,
                                                     MACVelocityField &savedField) {
     if (!Grid3d::isPositionInGrid(x, y, z, _dx, _isize, _jsize, _ksize)) {
@@ -746,6 +863,18 @@ glm::vec3 MACVelocityField::evaluateVelocityAtPositionLinear(double x, double y,
     return glm::vec3(xvel, yvel, zvel);
 }
 
+glm::vec3 MACVelocityField::evaluateVelocityGradientU(glm::vec3 pos) {
+    return _interpolateLinearGradientU(pos.x, pos.y, pos.z);
+}
+
+glm::vec3 MACVelocityField::evaluateVelocityGradientV(glm::vec3 pos) {
+    return _interpolateLinearGradientV(pos.x, pos.y, pos.z);
+}
+
+glm::vec3 MACVelocityField::evaluateVelocityGradientW(glm::vec3 pos) {
+    return _interpolateLinearGradientW(pos.x, pos.y, pos.z);
+}
+
 glm::vec3 MACVelocityField::evaluateChangeInVelocityAtPosition(glm::vec3 p, 
                                                                MACVelocityField &savedField) {
     if (!Grid3d::isPositionInGrid(p.x, p.y, p.z, _dx, _isize, _jsize, _ksize)) {
@@ -63,6 +63,11 @@ public:
     float* getRawArrayV();
     float* getRawArrayW();
 
+    // Raw rows of the face grids. See Array3d::getRowPointer.
+    inline float* getRowPointerU(int j, int k) { return _u.getRowPointer(j, k); }
+    inline float* getRowPointerV(int j, int k) { return _v.getRowPointer(j, k); }
+    inline float* getRowPointerW(int j, int k) { return _w.getRowPointer(j, k); }
+
     void clear();
     void clearU();
     void clearV();
@@ -102,6 +107,11 @@ public:
     glm::vec3 evaluateVelocityAtPositionLinear(glm::vec3 pos);
     glm::vec3 evaluateChangeInVelocityAtPosition(glm::vec3 pos, MACVelocityField &savedField);
 
+    // Gradient of each velocity component using trilinear interpolation
+    glm::vec3 evaluateVelocityGradientU(glm::vec3 pos);
+    glm::vec3 evaluateVelocityGradientV(glm::vec3 pos);
+    glm::vec3 evaluateVelocityGradientW(glm::vec3 pos);
+
     glm::vec3 velocityIndexToPositionU(int i, int j, int k);
     glm::vec3 velocityIndexToPositionV(int i, int j, int k);
     glm::vec3 velocityIndexToPositionW(int i, int j, int k);
@@ -119,6 +129,7 @@ private:
     double _bicubicInterpolate(double p[4][4], double x, double y);
     double _tricubicInterpolate(double p[4][4][4], double x, double y, double z);
     double _trilinearInterpolate(double p[8], double x, double y, double z);
+    glm::vec3 _trilinearInterpolateGradient(double p[8], double x, double y, double z);
 
     double _interpolateU(double x, double y, double z);
     double _interpolateV(double x, double y, double z);
@@ -126,6 +137,9 @@ private:
     double _interpolateLinearU(double x, double y, double z);
     double _interpolateLinearV(double x, double y, double z);
     double _interpolateLinearW(double x, double y, double z);
+    glm::vec3 _interpolateLinearGradientU(double x, double y, double z);
+    glm::vec3 _interpolateLinearGradientV(double x, double y, double z);
+    glm::vec3 _interpolateLinearGradientW(double x, double y, double z);
     double _interpolateDeltaVelocityU(double x, double y, double z, MACVelocityField &savedField);
     double _interpolateDeltaVelocityV(double x, double y, double z, MACVelocityField &savedField);
     double _interpolateDeltaVelocityW(double x, double y, double z, MACVelocityField &savedField);
@@ -0,0 +1,377 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "meshbvh.h"
+
+MeshBVH::MeshBVH() {
+}
+
+MeshBVH::~MeshBVH() {
+}
+
+void MeshBVH::clear() {
+    _nodes.clear();
+    _triangleIndices.clear();
+    _triangleVertices.clear();
+}
+
+void MeshBVH::_computeTriangleBounds(int startidx, int endidx, const TriangleMesh *mesh) {
+    Triangle t;
+    glm::vec3 v0, v1, v2;
+    for (int i = startidx; i <= endidx; i++) {
+        t = mesh->triangles[i];
+        v0 = mesh->vertices[t.tri[0]];
+        v1 = mesh->vertices[t.tri[1]];
+        v2 = mesh->vertices[t.tri[2]];
+
+        _triangleMin[i] = glm::min(glm::min(v0, v1), v2);
+        _triangleMax[i] = glm::max(glm::max(v0, v1), v2);
+        _triangleCentroids[i] = 0.5f*(_triangleMin[i] + _triangleMax[i]);
+    }
+}
+
+MeshBVH::BVHNode MeshBVH::_getBoundingNode(int start, int end) {
+    BVHNode node;
+    float inf = std::numeric_limits<float>::infinity();
+    node.bmin = glm::vec3(inf, inf, inf);
+    node.bmax = glm::vec3(-inf, -inf, -inf);
+
+    int tidx;
+    for (int i = start; i < end; i++) {
+        tidx = _triangleIndices[i];
+        node.bmin = glm::min(node.bmin, _triangleMin[tidx]);
+        node.bmax = glm::max(node.bmax, _triangleMax[tidx]);
+    }
+
+    return node;
+}
+
+bool MeshBVH::_findSplit(int start, int end, int *mid) {
+    int count = end - start;
+    if (count <= _maxLeafSize) {
+        return false;
+    }
+
+    float inf = std::numeric_limits<float>::infinity();
+    glm::vec3 cmin = glm::vec3(inf, inf, inf);
+    glm::vec3 cmax = glm::vec3(-inf, -inf, -inf);
+    for (int i = start; i < end; i++) {
+        cmin = glm::min(cmin, _triangleCentroids[_triangleIndices[i]]);
+        cmax = glm::max(cmax, _triangleCentroids[_triangleIndices[i]]);
+    }
+
+    // Binned SAH: cost of a split is the number of triangles on each side
+    // weighted by the surface area of that side
+    int bestAxis = -1;
+    int bestBin = 0;
+    double bestCost = std::numeric_limits<double>::infinity();
+    int binCounts[NUM_BINS];
+    glm::vec3 binMin[NUM_BINS];
+    glm::vec3 binMax[NUM_BINS];
+    double rightCosts[NUM_BINS];
+    for (int axis = 0; axis < 3; axis++) {
+        double extent = cmax[axis] - cmin[axis];
+        if (extent < 10e-9) {
+            continue;
+        }
+
+        for (int b = 0; b < NUM_BINS; b++) {
+            binCounts[b] = 0;
+            binMin[b] = glm::vec3(inf, inf, inf);
+            binMax[b] = glm::vec3(-inf, -inf, -inf);
+        }
+
+        double scale = NUM_BINS / extent;
+        int tidx;
+        for (int i = start; i < end; i++) {
+            tidx = _triangleIndices[i];
+            int b = (int)((_triangleCentroids[tidx][axis] - cmin[axis])*scale);
+            b = b < NUM_BINS - 1 ? b : NUM_BINS - 1;
+            binCounts[b]++;
+            binMin[b] = glm::min(binMin[b], _triangleMin[tidx]);
+            binMax[b] = glm::max(binMax[b], _triangleMax[tidx]);
+        }
+
+        glm::vec3 rmin = glm::vec3(inf, inf, inf);
+        glm::vec3 rmax = glm::vec3(-inf, -inf, -inf);
+        int rcount = 0;
+        for (int b = NUM_BINS - 1; b > 0; b--) {
+            rcount += binCounts[b];
+            rmin = glm::min(rmin, binMin[b]);
+            rmax = glm::max(rmax, binMax[b]);
+            rightCosts[b] = rcount > 0 ? rcount*_getSurfaceArea(rmin, rmax) : 0.0;
+        }
+
+        glm::vec3 lmin = glm::vec3(inf, inf, inf);
+        glm::vec3 lmax = glm::vec3(-inf, -inf, -inf);
+        int lcount = 0;
+        for (int b = 0; b < NUM_BINS - 1; b++) {
+            lcount += binCounts[b];
+            lmin = glm::min(lmin, binMin[b]);
+            lmax = glm::max(lmax, binMax[b]);
+            if (lcount == 0 || lcount == count) {
+                continue;
+            }
+
+            double cost = lcount*_getSurfaceArea(lmin, lmax) + rightCosts[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    if (bestAxis == -1) {
+        // All centroids coincide. Any split will do.
+        *mid = start + count / 2;
+        return true;
+    }
+
+    double scale = NUM_BINS / (cmax[bestAxis] - cmin[bestAxis]);
+    int *first = &_triangleIndices[0] + start;
+    int *last = &_triangleIndices[0] + end;
+    int *split = std::partition(first, last, [&](int tidx) {
+        int b = (int)((_triangleCentroids[tidx][bestAxis] - cmin[bestAxis])*scale);
+        return b <= bestBin;
+    });
+    *mid = start + (int)(split - first);
+
+    if (*mid == start || *mid == end) {
+        *mid = start + count / 2;
+    }
+
+    return true;
+}
+
+void MeshBVH::_buildNode(std::vector<BVHNode> &nodes, int nodeIndex, int start, int end) {
+    int mid;
+    if (!_findSplit(start, end, &mid)) {
+        nodes[nodeIndex].offset = start;
+        nodes[nodeIndex].count = end - start;
+        return;
+    }
+
+    int left = (int)nodes.size();
+    nodes[nodeIndex].offset = left;
+    nodes[nodeIndex].count = 0;
+    nodes.push_back(_getBoundingNode(start, mid));
+    nodes.push_back(_getBoundingNode(mid, end));
+
+    _buildNode(nodes, left, start, mid);
+    _buildNode(nodes, left + 1, mid, end);
+}
+
+void MeshBVH::_buildSubtree(int start, int end, std::vector<BVHNode> *nodes) {
+    nodes->push_back(_getBoundingNode(start, end));
+    _buildNode(*nodes, 0, start, end);
+}
+
+void MeshBVH::_splitTopLevelNode(int nodeIndex, int start, int end, int depth, 
+                                 std::vector<BuildTask> &tasks) {
+    // The top of the tree is split serially until there is a subtree
+    // for each build thread
+    int mid;
+    if ((1 << depth) >= _numBuildThreads || !_findSplit(start, end, &mid)) {
+        tasks.push_back(BuildTask(nodeIndex, start, end));
+        return;
+    }
+
+    int left = (int)_nodes.size();
+    _nodes[nodeIndex].offset = left;
+    _nodes[nodeIndex].count = 0;
+    _nodes.push_back(_getBoundingNode(start, mid));
+    _nodes.push_back(_getBoundingNode(mid, end));
+
+    _splitTopLevelNode(left, start, mid, depth + 1, tasks);
+    _splitTopLevelNode(left + 1, mid, end, depth + 1, tasks);
+}
+
+void MeshBVH::_insertSubtree(int nodeIndex, std::vector<BVHNode> &subtree) {
+    // subtree[0] replaces the task node and the remaining nodes are
+    // appended. Child offsets are shifted to their new positions.
+    int base = (int)_nodes.size() - 1;
+    BVHNode node;
+    for (unsigned int i = 0; i < subtree.size(); i++) {
+        node = subtree[i];
+        if (node.count == 0) {
+            node.offset += base;
+        }
+
+        if (i == 0) {
+            _nodes[nodeIndex] = node;
+        } else {
+            _nodes.push_back(node);
+        }
+    }
+}
+
+void MeshBVH::_copyTriangleData(const TriangleMesh &mesh) {
+    _triangleVertices.clear();
+    _triangleVertices.reserve(3*_triangleIndices.size());
+
+    Triangle t;
+    for (unsigned int i = 0; i < _triangleIndices.size(); i++) {
+        t = mesh.triangles[_triangleIndices[i]];
+        _triangleVertices.push_back(mesh.vertices[t.tri[0]]);
+        _triangleVertices.push_back(mesh.vertices[t.tri[1]]);
+        _triangleVertices.push_back(mesh.vertices[t.tri[2]]);
+    }
+}
+
+void MeshBVH::build(const TriangleMesh &mesh) {
+    clear();
+
+    int n = (int)mesh.triangles.size();
+    if (n == 0) {
+        return;
+    }
+
+    _triangleMin = std::vector<glm::vec3>(n);
+    _triangleMax = std::vector<glm::vec3>(n);
+    _triangleCentroids = std::vector<glm::vec3>(n);
+
+    int numThreads = (int)fmin(_numBuildThreads, n);
+    std::vector<int> startIndices;
+    std::vector<int> endIndices;
+    int chunksize = (int)floor(n / numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startIdx = (i == 0) ? 0 : endIndices[i - 1] + 1;
+        int endIdx = (i == numThreads - 1) ? n - 1 : startIdx + chunksize - 1;
+
+        startIndices.push_back(startIdx);
+        endIndices.push_back(endIdx);
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&MeshBVH::_computeTriangleBounds,
+                                      this,
+                                      startIndices[i],
+                                      endIndices[i],
+                                      &mesh));
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+    }
+
+    _triangleIndices.reserve(n);
+    for (int i = 0; i < n; i++) {
+        _triangleIndices.push_back(i);
+    }
+
+    _nodes.push_back(_getBoundingNode(0, n));
+    std::vector<BuildTask> tasks;
+    _splitTopLevelNode(0, 0, n, 0, tasks);
+
+    // Subtrees cover disjoint ranges of _triangleIndices and are built
+    // into separate node arrays
+    std::vector<std::vector<BVHNode> > subtrees(tasks.size());
+    threads.clear();
+    for (unsigned int i = 0; i < tasks.size(); i++) {
+        threads.push_back(std::thread(&MeshBVH::_buildSubtree,
+                                      this,
+                                      tasks[i].start,
+                                      tasks[i].end,
+                                      &subtrees[i]));
+    }
+
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    for (unsigned int i = 0; i < tasks.size(); i++) {
+        _insertSubtree(tasks[i].nodeIndex, subtrees[i]);
+    }
+
+    _copyTriangleData(mesh);
+
+    _triangleMin.clear();
+    _triangleMax.clear();
+    _triangleCentroids.clear();
+    _triangleMin.shrink_to_fit();
+    _triangleMax.shrink_to_fit();
+    _triangleCentroids.shrink_to_fit();
+}
+
+bool MeshBVH::findClosestPoint(glm::vec3 p, glm::vec3 *point, int *tidx) {
+    return findClosestPoint(p, std::numeric_limits<double>::infinity(), point, tidx);
+}
+
+bool MeshBVH::findClosestPoint(glm::vec3 p, double maxDistanceSquared, 
+                               glm::vec3 *point, int *tidx) {
+    if (_nodes.size() == 0) {
+        return false;
+    }
+
+    double mindistsq = maxDistanceSquared;
+    bool isFound = false;
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+
+    glm::vec3 q, v;
+    double distsq;
+    while (!stack.empty()) {
+        BVHNode &node = _nodes[stack.back()];
+        stack.pop_back();
+
+        if (_getBoxDistanceSquared(node, p) >= mindistsq) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int i = node.offset; i < node.offset + node.count; i++) {
+                q = Collision::findClosestPointOnTriangle(p, _triangleVertices[3*i],
+                                                             _triangleVertices[3*i + 1],
+                                                             _triangleVertices[3*i + 2]);
+                v = q - p;
+                distsq = glm::dot(v, v);
+                if (distsq < mindistsq) {
+                    mindistsq = distsq;
+                    *point = q;
+                    *tidx = _triangleIndices[i];
+                    isFound = true;
+                }
+            }
+            continue;
+        }
+
+        // visit the nearer child first
+        int left = node.offset;
+        int right = node.offset + 1;
+        double dleft = _getBoxDistanceSquared(_nodes[left], p);
+        double dright = _getBoxDistanceSquared(_nodes[right], p);
+        if (dleft < dright) {
+            std::swap(left, right);
+            std::swap(dleft, dright);
+        }
+
+        if (dleft < mindistsq) {
+            stack.push_back(left);
+        }
+        if (dright < mindistsq) {
+            stack.push_back(right);
+        }
+    }
+
+    return isFound;
+}
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include <assert.h>
+
+#include "glm/glm.hpp"
+#include "trianglemesh.h"
+#include "collision.h"
+
+/*
+    Bounding volume hierarchy over the triangles of a TriangleMesh.
+
+    Nodes are stored in a flat array and the two children of an interior
+    node are stored next to each other. Triangle vertex positions are copied 
+    in leaf order so that a leaf's triangles are contiguous in memory.
+    Nodes are split using a binned surface area heuristic.
+*/
+class MeshBVH
+{
+public:
+    MeshBVH();
+    ~MeshBVH();
+
+    void build(const TriangleMesh &mesh);
+    void clear();
+    bool isEmpty() { return _nodes.size() == 0; }
+
+    // Returns false if no triangle is closer than sqrt(maxDistanceSquared)
+    bool findClosestPoint(glm::vec3 p, glm::vec3 *point, int *tidx);
+    bool findClosestPoint(glm::vec3 p, double maxDistanceSquared, 
+                          glm::vec3 *point, int *tidx);
+
+private:
+    struct BVHNode {
+        glm::vec3 bmin;
+        glm::vec3 bmax;
+        int offset;     // first triangle for leaves, first child otherwise
+        int count;      // number of triangles, 0 for interior nodes
+
+        BVHNode() : offset(0), count(0) {}
+    };
+
+    struct BuildTask {
+        int nodeIndex;
+        int start;
+        int end;
+
+        BuildTask() : nodeIndex(0), start(0), end(0) {}
+        BuildTask(int n, int s, int e) : nodeIndex(n), start(s), end(e) {}
+    };
+
+    void _computeTriangleBounds(int startidx, int endidx, const TriangleMesh *mesh);
+    BVHNode _getBoundingNode(int start, int end);
+    bool _findSplit(int start, int end, int *mid);
+    void _splitTopLevelNode(int nodeIndex, int start, int end, int depth, 
+                            std::vector<BuildTask> &tasks);
+    void _buildSubtree(int start, int end, std::vector<BVHNode> *nodes);
+    void _buildNode(std::vector<BVHNode> &nodes, int nodeIndex, int start, int end);
+    void _insertSubtree(int nodeIndex, std::vector<BVHNode> &subtree);
+    void _copyTriangleData(const TriangleMesh &mesh);
+
+    inline double _getSurfaceArea(glm::vec3 bmin, glm::vec3 bmax) {
+        glm::vec3 d = bmax - bmin;
+        return 2.0*(d.x*d.y + d.y*d.z + d.z*d.x);
+    }
+
+    inline double _getBoxDistanceSquared(BVHNode &node, glm::vec3 p) {
+        glm::vec3 d = glm::max(glm::max(node.bmin - p, p - node.bmax), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    static const int NUM_BINS = 12;
+
+    int _maxLeafSize = 4;
+    int _numBuildThreads = 8;
+
+    std::vector<BVHNode> _nodes;
+    std::vector<int> _triangleIndices;
+    std::vector<glm::vec3> _triangleVertices;   // 3 per triangle, leaf order
+
+    // Temporary build data indexed by original triangle index
+    std::vector<glm::vec3> _triangleMin;
+    std::vector<glm::vec3> _triangleMax;
+    std::vector<glm::vec3> _triangleCentroids;
+};
@@ -0,0 +1,457 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "meshdecimator.h"
+
+MeshDecimator::MeshDecimator() {
+}
+
+MeshDecimator::~MeshDecimator() {
+}
+
+void MeshDecimator::setMaxError(double e) {
+    assert(e >= 0.0);
+    _maxError = e;
+}
+
+void MeshDecimator::setMaxNormalDeviation(double radians) {
+    assert(radians >= 0.0);
+    _minNormalCosine = cos(radians);
+}
+
+void MeshDecimator::decimate(TriangleMesh &mesh, std::vector<bool> &isTriangleSmooth) {
+    assert(isTriangleSmooth.size() == mesh.triangles.size());
+    if (_maxError == 0.0 || mesh.triangles.size() == 0) {
+        return;
+    }
+
+    _mesh = &mesh;
+    _isTriangleSmooth = &isTriangleSmooth;
+    bool hasNormals = mesh.normals.size() > 0;
+
+    _decimatePass(0.0);
+    _compactMesh();
+    _decimatePass(0.5);
+    _compactMesh();
+
+    _isTriangleRemoved.clear();
+    _isVertexRemoved.clear();
+    _isVertexLocked.clear();
+    _triangleSlabs.clear();
+    _vertexSlabs.clear();
+    _vertexTriangles.clear();
+    _quadrics.clear();
+
+    if (hasNormals) {
+        mesh.updateVertexNormals();
+    }
+}
+
+void MeshDecimator::_decimatePass(double slabOffset) {
+    _initializePass();
+    _assignSlabs(slabOffset);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < _numDecimationThreads; i++) {
+        threads.push_back(std::thread(&MeshDecimator::_decimateSlab, this, i));
+    }
+
+    for (int i = 0; i < _numDecimationThreads; i++) {
+        threads[i].join();
+    }
+}
+
+void MeshDecimator::_initializePass() {
+    int nv = _mesh->vertices.size();
+    int nt = _mesh->triangles.size();
+
+    _isTriangleRemoved.assign(nt, 0);
+    _isVertexRemoved.assign(nv, 0);
+    _isVertexLocked.assign(nv, 0);
+    _quadrics.assign(nv, Quadric());
+    _vertexTriangles = std::vector<std::vector<int> >(nv);
+
+    // Vertices of triangles that are not smooth are never removed so that
+    // these triangles are unchanged
+    Triangle t;
+    for (int i = 0; i < nt; i++) {
+        t = _mesh->triangles[i];
+        for (int idx = 0; idx < 3; idx++) {
+            _vertexTriangles[t.tri[idx]].push_back(i);
+            if (!(*_isTriangleSmooth)[i]) {
+                _isVertexLocked[t.tri[idx]] = 1;
+            }
+        }
+    }
+}
+
+void MeshDecimator::_assignSlabs(double slabOffset) {
+    AABB bbox = AABB(_mesh->vertices);
+    int axis = 0;
+    double extent = bbox.width;
+    if (bbox.height > extent) {
+        axis = 1;
+        extent = bbox.height;
+    }
+    if (bbox.depth > extent) {
+        axis = 2;
+        extent = bbox.depth;
+    }
+
+    int numSlabs = _numDecimationThreads;
+    double slabWidth = fmax(extent / numSlabs, 10e-9);
+    double minpos = bbox.position[axis];
+
+    int nt = _mesh->triangles.size();
+    _triangleSlabs.assign(nt, 0);
+    glm::vec3 c;
+    for (int i = 0; i < nt; i++) {
+        c = _mesh->getTriangleCenter(i);
+        int slab = (int)floor((c[axis] - minpos) / slabWidth + slabOffset);
+        _triangleSlabs[i] = (int)fmin(fmax(slab, 0), numSlabs - 1);
+    }
+
+    int nv = _mesh->vertices.size();
+    _vertexSlabs.assign(nv, -1);
+    for (int i = 0; i < nv; i++) {
+        if (_vertexTriangles[i].size() == 0) {
+            continue;
+        }
+
+        int slab = _triangleSlabs[_vertexTriangles[i][0]];
+        for (unsigned int j = 1; j < _vertexTriangles[i].size(); j++) {
+            if (_triangleSlabs[_vertexTriangles[i][j]] != slab) {
+                slab = -1;
+                break;
+            }
+        }
+        _vertexSlabs[i] = slab;
+    }
+}
+
+/*
+    Only vertices whose triangles are all within the slab are modified or 
+    removed, so the triangles and vertex data touched by a collapse are 
+    never accessed by another thread.
+*/
+void MeshDecimator::_decimateSlab(int slab) {
+    int nv = _mesh->vertices.size();
+    for (int i = 0; i < nv; i++) {
+        if (_vertexSlabs[i] == slab) {
+            _initializeVertex(i);
+        }
+    }
+
+    std::priority_queue<Collapse> queue;
+    for (int i = 0; i < nv; i++) {
+        if (_vertexSlabs[i] == slab && !_isVertexLocked[i]) {
+            _pushCollapses(i, slab, queue);
+        }
+    }
+
+    double maxErrorSq = _maxError*_maxError;
+    double eps = 10e-12;
+    Collapse c;
+    double error;
+    while (!queue.empty()) {
+        c = queue.top();
+        queue.pop();
+
+        if (c.error > maxErrorSq) {
+            break;
+        }
+
+        if (_isVertexRemoved[c.u] || _isVertexRemoved[c.v] ||
+                !_getCollapseError(c.u, c.v, slab, &error)) {
+            continue;
+        }
+
+        // Quadrics only grow as vertices are merged, so an outdated 
+        // collapse is reinserted with its current error
+        if (error > c.error + eps) {
+            queue.push(Collapse(error, c.u, c.v));
+            continue;
+        }
+
+        if (!_isCollapseValid(c.u, c.v)) {
+            continue;
+        }
+
+        _collapseEdge(c.u, c.v);
+        _pushCollapses(c.v, slab, queue);
+    }
+}
+
+void MeshDecimator::_initializeVertex(int vidx) {
+    Quadric q;
+    Triangle t;
+    glm::vec3 v0, v1, v2, n;
+    std::vector<int> neighbours;
+    std::vector<int> counts;
+    for (unsigned int i = 0; i < _vertexTriangles[vidx].size(); i++) {
+        t = _mesh->triangles[_vertexTriangles[vidx][i]];
+        v0 = _mesh->vertices[t.tri[0]];
+        v1 = _mesh->vertices[t.tri[1]];
+        v2 = _mesh->vertices[t.tri[2]];
+
+        n = glm::cross(v1 - v0, v2 - v0);
+        double len = glm::length(n);
+        if (len > 0.0) {
+            n = n / (float)len;
+            Quadric plane(n.x, n.y, n.z, -glm::dot(n, v0));
+            q.add(plane);
+        }
+
+        for (int idx = 0; idx < 3; idx++) {
+            if (t.tri[idx] == vidx) {
+                continue;
+            }
+
+            bool isFound = false;
+            for (unsigned int j = 0; j < neighbours.size(); j++) {
+                if (neighbours[j] == t.tri[idx]) {
+                    counts[j]++;
+                    isFound = true;
+                    break;
+                }
+            }
+
+            if (!isFound) {
+                neighbours.push_back(t.tri[idx]);
+                counts.push_back(1);
+            }
+        }
+    }
+    _quadrics[vidx] = q;
+
+    // Each edge of a closed manifold fan is shared by two triangles. Vertices 
+    // on an open or non-manifold edge are kept.
+    for (unsigned int i = 0; i < counts.size(); i++) {
+        if (counts[i] != 2) {
+            _isVertexLocked[vidx] = 1;
+            break;
+        }
+    }
+}
+
+void MeshDecimator::_pushCollapses(int w, int slab, std::priority_queue<Collapse> &queue) {
+    std::vector<int> neighbours;
+    _getVertexNeighbours(w, neighbours);
+
+    double error;
+    for (unsigned int i = 0; i < neighbours.size(); i++) {
+        int n = neighbours[i];
+        if (_getCollapseError(w, n, slab, &error)) {
+            queue.push(Collapse(error, w, n));
+        }
+        if (_getCollapseError(n, w, slab, &error)) {
+            queue.push(Collapse(error, n, w));
+        }
+    }
+}
+
+bool MeshDecimator::_getCollapseError(int u, int v, int slab, double *error) {
+    // Slab ownership is tested first. The vertex data of a vertex in another 
+    // slab may be written by that slab's thread.
+    if (_vertexSlabs[u] != slab || _vertexSlabs[v] != slab) {
+        return false;
+    }
+    if (_isVertexLocked[u]) {
+        return false;
+    }
+
+    Quadric q = _quadrics[u];
+    q.add(_quadrics[v]);
+    *error = q.evaluate(_mesh->vertices[v]);
+
+    return true;
+}
+
+bool MeshDecimator::_isCollapseValid(int u, int v) {
+    std::vector<int> nu, nv;
+    _getVertexNeighbours(u, nu);
+    _getVertexNeighbours(v, nv);
+
+    // The edge must still exist and the collapse must not join two
+    // surface sheets, which happens if u and v share more than the two
+    // vertices opposite to their edge
+    bool isAdjacent = false;
+    int numShared = 0;
+    for (unsigned int i = 0; i < nu.size(); i++) {
+        if (nu[i] == v) {
+            isAdjacent = true;
+            continue;
+        }
+        for (unsigned int j = 0; j < nv.size(); j++) {
+            if (nu[i] == nv[j]) {
+                numShared++;
+                break;
+            }
+        }
+    }
+
+    if (!isAdjacent || numShared != 2) {
+        return false;
+    }
+
+    glm::vec3 pv = _mesh->vertices[v];
+    Triangle t;
+    glm::vec3 p[3];
+    for (unsigned int i = 0; i < _vertexTriangles[u].size(); i++) {
+        int tidx = _vertexTriangles[u][i];
+        if (_isTriangleRemoved[tidx]) {
+            continue;
+        }
+
+        t = _mesh->triangles[tidx];
+        if (t.tri[0] == v || t.tri[1] == v || t.tri[2] == v) {
+            continue;
+        }
+
+        for (int idx = 0; idx < 3; idx++) {
+            p[idx] = _mesh->vertices[t.tri[idx]];
+        }
+        glm::vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+        for (int idx = 0; idx < 3; idx++) {
+            if (t.tri[idx] == u) {
+                p[idx] = pv;
+            }
+        }
+        glm::vec3 n1 = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+        double len0 = glm::length(n0);
+        double len1 = glm::length(n1);
+        if (len1 < 10e-12) {
+            return false;
+        }
+        if (len0 > 0.0 && glm::dot(n0, n1) / (len0*len1) < _minNormalCosine) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MeshDecimator::_collapseEdge(int u, int v) {
+    for (unsigned int i = 0; i < _vertexTriangles[u].size(); i++) {
+        int tidx = _vertexTriangles[u][i];
+        if (_isTriangleRemoved[tidx]) {
+            continue;
+        }
+
+        Triangle *t = &(_mesh->triangles[tidx]);
+        if (t->tri[0] == v || t->tri[1] == v || t->tri[2] == v) {
+            _isTriangleRemoved[tidx] = 1;
+            continue;
+        }
+
+        for (int idx = 0; idx < 3; idx++) {
+            if (t->tri[idx] == u) {
+                t->tri[idx] = v;
+            }
+        }
+        _vertexTriangles[v].push_back(tidx);
+    }
+
+    _quadrics[v].add(_quadrics[u]);
+    _vertexTriangles[u].clear();
+    _isVertexRemoved[u] = 1;
+}
+
+void MeshDecimator::_getVertexNeighbours(int vidx, std::vector<int> &neighbours) {
+    Triangle t;
+    for (unsigned int i = 0; i < _vertexTriangles[vidx].size(); i++) {
+        int tidx = _vertexTriangles[vidx][i];
+        if (_isTriangleRemoved[tidx]) {
+            continue;
+        }
+
+        t = _mesh->triangles[tidx];
+        for (int idx = 0; idx < 3; idx++) {
+            int n = t.tri[idx];
+            if (n == vidx) {
+                continue;
+            }
+
+            bool isFound = false;
+            for (unsigned int j = 0; j < neighbours.size(); j++) {
+                if (neighbours[j] == n) {
+                    isFound = true;
+                    break;
+                }
+            }
+
+            if (!isFound) {
+                neighbours.push_back(n);
+            }
+        }
+    }
+}
+
+void MeshDecimator::_compactMesh() {
+    int nv = _mesh->vertices.size();
+    int nt = _mesh->triangles.size();
+
+    std::vector<int> vertexMap(nv, -1);
+    for (int i = 0; i < nt; i++) {
+        if (!_isTriangleRemoved[i]) {
+            Triangle t = _mesh->triangles[i];
+            vertexMap[t.tri[0]] = 0;
+            vertexMap[t.tri[1]] = 0;
+            vertexMap[t.tri[2]] = 0;
+        }
+    }
+
+    bool hasColors = (int)_mesh->vertexcolors.size() == nv;
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> colors;
+    for (int i = 0; i < nv; i++) {
+        if (vertexMap[i] == -1) {
+            continue;
+        }
+
+        vertexMap[i] = vertices.size();
+        vertices.push_back(_mesh->vertices[i]);
+        if (hasColors) {
+            colors.push_back(_mesh->vertexcolors[i]);
+        }
+    }
+
+    std::vector<Triangle> triangles;
+    std::vector<bool> isSmooth;
+    Triangle t;
+    for (int i = 0; i < nt; i++) {
+        if (_isTriangleRemoved[i]) {
+            continue;
+        }
+
+        t = _mesh->triangles[i];
+        triangles.push_back(Triangle(vertexMap[t.tri[0]], 
+                                     vertexMap[t.tri[1]], 
+                                     vertexMap[t.tri[2]]));
+        isSmooth.push_back((*_isTriangleSmooth)[i]);
+    }
+
+    _mesh->vertices = vertices;
+    _mesh->vertexcolors = colors;
+    _mesh->normals.clear();
+    _mesh->triangles = triangles;
+    *_isTriangleSmooth = isSmooth;
+}
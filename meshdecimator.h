@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <limits>
+#include <assert.h>
+
+#include "glm/glm.hpp"
+#include "trianglemesh.h"
+#include "aabb.h"
+
+/*
+    Reduces the triangle count of a mesh with quadric error edge collapses.
+
+    Collapses are half-edge collapses so that surviving vertices keep their
+    original positions. A collapse is rejected if its quadric error is
+    greater than the error budget or if it rotates a triangle normal by more
+    than the maximum normal deviation.
+
+    The mesh is split into slabs along its longest axis and each thread 
+    collapses the edges between vertices that are only used by triangles in 
+    its slab. A second pass with shifted slabs decimates the slab boundaries.
+
+    Triangles that are not marked as smooth are left unchanged and the 
+    smooth flags of the remaining triangles are kept in order with the 
+    output triangles.
+*/
+class MeshDecimator
+{
+public:
+    MeshDecimator();
+    ~MeshDecimator();
+
+    // Maximum distance of a removed vertex from the planes of its triangles
+    void setMaxError(double e);
+    void setMaxNormalDeviation(double radians);
+    void decimate(TriangleMesh &mesh, std::vector<bool> &isTriangleSmooth);
+
+private:
+    struct Quadric {
+        double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+        Quadric() : a2(0.0), ab(0.0), ac(0.0), ad(0.0), b2(0.0), 
+                    bc(0.0), bd(0.0), c2(0.0), cd(0.0), d2(0.0) {}
+
+        Quadric(double a, double b, double c, double d) :
+                    a2(a*a), ab(a*b), ac(a*c), ad(a*d), b2(b*b), 
+                    bc(b*c), bd(b*d), c2(c*c), cd(c*d), d2(d*d) {}
+
+        void add(Quadric &q) {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+            bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+        }
+
+        double evaluate(glm::vec3 v) {
+            double x = v.x; double y = v.y; double z = v.z;
+            return a2*x*x + 2.0*ab*x*y + 2.0*ac*x*z + 2.0*ad*x +
+                   b2*y*y + 2.0*bc*y*z + 2.0*bd*y +
+                   c2*z*z + 2.0*cd*z + d2;
+        }
+    };
+
+    struct Collapse {
+        double error;
+        int u;      // vertex that is removed
+        int v;      // vertex that u is merged into
+
+        Collapse() : error(0.0), u(-1), v(-1) {}
+        Collapse(double e, int uidx, int vidx) : error(e), u(uidx), v(vidx) {}
+
+        bool operator<(const Collapse &c) const {
+            return error > c.error;
+        }
+    };
+
+    void _decimatePass(double slabOffset);
+    void _initializePass();
+    void _assignSlabs(double slabOffset);
+    void _decimateSlab(int slab);
+    void _initializeVertex(int vidx);
+    void _pushCollapses(int w, int slab, std::priority_queue<Collapse> &queue);
+    bool _getCollapseError(int u, int v, int slab, double *error);
+    bool _isCollapseValid(int u, int v);
+    void _collapseEdge(int u, int v);
+    void _getVertexNeighbours(int vidx, std::vector<int> &neighbours);
+    void _compactMesh();
+
+    double _maxError = 0.0;
+    double _minNormalCosine = 0.9;
+    int _numDecimationThreads = 8;
+
+    TriangleMesh *_mesh;
+    std::vector<bool> *_isTriangleSmooth;
+
+    // char vectors are used so that threads can write to neighbouring
+    // elements without a data race
+    std::vector<char> _isTriangleRemoved;
+    std::vector<char> _isVertexRemoved;
+    std::vector<char> _isVertexLocked;
+    std::vector<int> _triangleSlabs;
+    std::vector<int> _vertexSlabs;       // -1 if the vertex spans slabs
+    std::vector<std::vector<int> > _vertexTriangles;
+    std::vector<Quadric> _quadrics;
+};
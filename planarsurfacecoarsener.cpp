@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "planarsurfacecoarsener.h"
+
+PlanarSurfaceCoarsener::PlanarSurfaceCoarsener() {
+}
+
+PlanarSurfaceCoarsener::PlanarSurfaceCoarsener(int isize, int jsize, int ksize, double dx) :
+                                               _isize(isize), _jsize(jsize), _ksize(ksize),
+                                               _dx(dx) {
+}
+
+PlanarSurfaceCoarsener::~PlanarSurfaceCoarsener() {
+}
+
+void PlanarSurfaceCoarsener::setErrorTolerance(double tolerance) {
+    assert(tolerance >= 0.0);
+    _errorTolerance = tolerance;
+}
+
+void PlanarSurfaceCoarsener::setMaxNormalDeviation(double radians) {
+    assert(radians >= 0.0);
+    _maxNormalDeviation = radians;
+}
+
+GridIndex PlanarSurfaceCoarsener::getTriangleCell(TriangleMesh &mesh, int tidx) {
+    glm::vec3 tri[3];
+    mesh.getTrianglePosition(tidx, tri);
+
+    GridIndex g = Grid3d::positionToGridIndex((tri[0] + tri[1] + tri[2]) / 3.0f, _dx);
+    g.i = (int)fmin(fmax(g.i, 0), _isize - 1);
+    g.j = (int)fmin(fmax(g.j, 0), _jsize - 1);
+    g.k = (int)fmin(fmax(g.k, 0), _ksize - 1);
+
+    return g;
+}
+
+/*
+    Fits a linear function to the eight cell vertex values. The cell is
+    planar if no vertex value differs from the fit by more than the
+    tolerance, measured as a distance along the field gradient.
+*/
+bool PlanarSurfaceCoarsener::isCellPlanar(double values[8]) {
+    GridIndex verts[8];
+    Grid3d::getGridIndexVertices(GridIndex(0, 0, 0), verts);
+
+    double mean = 0.0;
+    glm::vec3 grad = glm::vec3(0.0f, 0.0f, 0.0f);
+    glm::vec3 offsets[8];
+    for (int idx = 0; idx < 8; idx++) {
+        offsets[idx] = glm::vec3(verts[idx].i - 0.5, 
+                                 verts[idx].j - 0.5, 
+                                 verts[idx].k - 0.5);
+        mean += values[idx];
+        grad += (float)(0.5*values[idx])*offsets[idx];
+    }
+    mean /= 8.0;
+
+    double gradlen = glm::length(grad);
+    if (gradlen == 0.0) {
+        return false;
+    }
+
+    double maxdist = _errorTolerance*gradlen;
+    for (int idx = 0; idx < 8; idx++) {
+        double fit = mean + glm::dot(grad, offsets[idx]);
+        if (fabs(values[idx] - fit) > maxdist) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PlanarSurfaceCoarsener::coarsen(TriangleMesh &mesh, 
+                                     std::vector<bool> &isTriangleInPlanarCell) {
+    MeshDecimator decimator;
+    decimator.setMaxError(_errorTolerance*_dx);
+    decimator.setMaxNormalDeviation(_maxNormalDeviation);
+    decimator.decimate(mesh, isTriangleInPlanarCell);
+}
@@ -0,0 +1,65 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <vector>
+#include <assert.h>
+
+#include "glm/glm.hpp"
+#include "grid3d.h"
+#include "trianglemesh.h"
+#include "meshdecimator.h"
+
+/*
+    Coarsens the planar regions of a marching cubes mesh.
+
+    A cell is planar if a linear function fits its eight vertex values to
+    within the error tolerance. Triangles are assigned to the cell that
+    contains their centroid, and only triangles in planar cells are passed
+    to the decimator as smooth. The decimator keeps the mesh topology, so
+    the coarsened mesh is as watertight as the marching cubes mesh.
+*/
+class PlanarSurfaceCoarsener
+{
+public:
+    PlanarSurfaceCoarsener();
+    PlanarSurfaceCoarsener(int isize, int jsize, int ksize, double dx);
+    ~PlanarSurfaceCoarsener();
+
+    // Tolerance is in number of grid cells
+    void setErrorTolerance(double tolerance);
+    void setMaxNormalDeviation(double radians);
+
+    // Cell containing the centroid of triangle tidx, clamped to the grid
+    GridIndex getTriangleCell(TriangleMesh &mesh, int tidx);
+
+    // values are ordered as the vertices of Grid3d::getGridIndexVertices
+    bool isCellPlanar(double values[8]);
+    void coarsen(TriangleMesh &mesh, std::vector<bool> &isTriangleInPlanarCell);
+
+private:
+    int _isize = 0;
+    int _jsize = 0;
+    int _ksize = 0;
+    double _dx = 0.0;
+
+    double _errorTolerance = 0.1;
+    double _maxNormalDeviation = 0.35;
+};
@@ -367,6 +367,16 @@ void Polygonizer3d::setInsideCellIndices(std::vector<GridIndex> indices) {
     }
 }
 
+/*
+    Surface cells that are already known, such as those found while the
+    scalar field was built, are polygonized directly instead of being
+    searched for from the inside cell indices.
+*/
+void Polygonizer3d::setSurfaceCells(std::vector<GridIndex> &cells) {
+    _surfaceCells = cells;
+    _isSurfaceCellsSet = true;
+}
+
 void Polygonizer3d::setScalarField(ImplicitSurfaceScalarField &scalarField) {
 
     int i, j, k;
@@ -412,9 +422,10 @@ double Polygonizer3d::_getVertexFieldValue(GridIndex g) {
 
         glm::vec3 p = _getVertexPosition(g);
         _vertexValues.set(g, (float)_field->getFieldValue(p));
+        _isVertexSet.set(g, true);
     }
 
-    return _vertexValues(g);;
+    return _vertexValues(g);
 }
 
 void Polygonizer3d::_resetVertexValues() {
@@ -562,142 +573,147 @@ glm::vec3 Polygonizer3d::_vertexInterp(double isolevel, glm::vec3 p1, glm::vec3
 }
 
 void Polygonizer3d::_calculateVertexList(GridIndex g, double isolevel, int cubeIndex, 
-                                         int vertexList[12], EdgeGrid &edges) {
+                                         int vertexList[12], EdgeGrid &edges,
+                                         TriangleMesh &mesh) {
     GridIndex vertices[8];
     double vertexValues[8];
     glm::vec3 vertexPositions[8];
 
+    GridIndex edgeIndices[8];
+
     Grid3d::getGridIndexVertices(g, vertices);
     for (int i = 0; i < 8; i++) {
         vertexValues[i] = _getVertexFieldValue(vertices[i]);
         vertexPositions[i] = _getVertexPosition(vertices[i]);
+        edgeIndices[i] = GridIndex(vertices[i].i, vertices[i].j, vertices[i].k - edges.koffset);
     }
 
     if (_edgeTable[cubeIndex] & 1) {
-        if (!edges.isSetU(vertices[0])) {
+        if (!edges.isSetU(edgeIndices[0])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[0], vertexPositions[1], 
                                                      vertexValues[0],    vertexValues[1]);
-            _surface.vertices.push_back(v);
-            edges.U.set(vertices[0], _surface.vertices.size() - 1);
-            edges.isSetU.set(vertices[0], true);
+            mesh.vertices.push_back(v);
+            edges.U.set(edgeIndices[0], mesh.vertices.size() - 1);
+            edges.isSetU.set(edgeIndices[0], true);
         }
-        vertexList[0] = edges.U(vertices[0]);
+        vertexList[0] = edges.U(edgeIndices[0]);
     }
     if (_edgeTable[cubeIndex] & 2) {
-        if (!edges.isSetW(vertices[1])) {
+        if (!edges.isSetW(edgeIndices[1])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[1], vertexPositions[2], 
                                                      vertexValues[1],    vertexValues[2]);
-            _surface.vertices.push_back(v);
-            edges.W.set(vertices[1], _surface.vertices.size() - 1);
-            edges.isSetW.set(vertices[1], true);
+            mesh.vertices.push_back(v);
+            edges.W.set(edgeIndices[1], mesh.vertices.size() - 1);
+            edges.isSetW.set(edgeIndices[1], true);
         }
-        vertexList[1] = edges.W(vertices[1]);
+        vertexList[1] = edges.W(edgeIndices[1]);
     }
     if (_edgeTable[cubeIndex] & 4) {
-        if (!edges.isSetU(vertices[3])) {
+        if (!edges.isSetU(edgeIndices[3])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[2], vertexPositions[3], 
                                                      vertexValues[2],    vertexValues[3]);
-            _surface.vertices.push_back(v);
-            edges.U.set(vertices[3], _surface.vertices.size() - 1);
-            edges.isSetU.set(vertices[3], true);
+            mesh.vertices.push_back(v);
+            edges.U.set(edgeIndices[3], mesh.vertices.size() - 1);
+            edges.isSetU.set(edgeIndices[3], true);
         }
-        vertexList[2] = edges.U(vertices[3]);
+        vertexList[2] = edges.U(edgeIndices[3]);
     }
     if (_edgeTable[cubeIndex] & 8) {
-        if (!edges.isSetW(vertices[0])) {
+        if (!edges.isSetW(edgeIndices[0])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[3], vertexPositions[0], 
                                                      vertexValues[3],    vertexValues[0]);
-            _surface.vertices.push_back(v);
-            edges.W.set(vertices[0], _surface.vertices.size() - 1);
-            edges.isSetW.set(vertices[0], true);
+            mesh.vertices.push_back(v);
+            edges.W.set(edgeIndices[0], mesh.vertices.size() - 1);
+            edges.isSetW.set(edgeIndices[0], true);
         }
-        vertexList[3] = edges.W(vertices[0]);
+        vertexList[3] = edges.W(edgeIndices[0]);
     }
     if (_edgeTable[cubeIndex] & 16) {
-        if (!edges.isSetU(vertices[4])) {
+        if (!edges.isSetU(edgeIndices[4])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[4], vertexPositions[5], 
                                                      vertexValues[4],    vertexValues[5]);
-            _surface.vertices.push_back(v);
-            edges.U.set(vertices[4], _surface.vertices.size() - 1);
-            edges.isSetU.set(vertices[4], true);
+            mesh.vertices.push_back(v);
+            edges.U.set(edgeIndices[4], mesh.vertices.size() - 1);
+            edges.isSetU.set(edgeIndices[4], true);
         }
-        vertexList[4] = edges.U(vertices[4]);
+        vertexList[4] = edges.U(edgeIndices[4]);
     }
     if (_edgeTable[cubeIndex] & 32) {
-        if (!edges.isSetW(vertices[5])) {
+        if (!edges.isSetW(edgeIndices[5])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[5], vertexPositions[6], 
                                                      vertexValues[5],    vertexValues[6]);
-            _surface.vertices.push_back(v);
-            edges.W.set(vertices[5], _surface.vertices.size() - 1);
-            edges.isSetW.set(vertices[5], true);
+            mesh.vertices.push_back(v);
+            edges.W.set(edgeIndices[5], mesh.vertices.size() - 1);
+            edges.isSetW.set(edgeIndices[5], true);
         }
-        vertexList[5] = edges.W(vertices[5]);
+        vertexList[5] = edges.W(edgeIndices[5]);
     }
     if (_edgeTable[cubeIndex] & 64) {
-        if (!edges.isSetU(vertices[7])) {
+        if (!edges.isSetU(edgeIndices[7])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[6], vertexPositions[7], 
                                                      vertexValues[6],    vertexValues[7]);
-            _surface.vertices.push_back(v);
-            edges.U.set(vertices[7], _surface.vertices.size() - 1);
-            edges.isSetU.set(vertices[7], true);
+            mesh.vertices.push_back(v);
+            edges.U.set(edgeIndices[7], mesh.vertices.size() - 1);
+            edges.isSetU.set(edgeIndices[7], true);
         }
-        vertexList[6] = edges.U(vertices[7]);
+        vertexList[6] = edges.U(edgeIndices[7]);
     }
     if (_edgeTable[cubeIndex] & 128) {
-        if (!edges.isSetW(vertices[4])) {
+        if (!edges.isSetW(edgeIndices[4])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[7], vertexPositions[4], 
                                                      vertexValues[7],    vertexValues[4]);
-            _surface.vertices.push_back(v);
-            edges.W.set(vertices[4], _surface.vertices.size() - 1);
-            edges.isSetW.set(vertices[4], true);
+            mesh.vertices.push_back(v);
+            edges.W.set(edgeIndices[4], mesh.vertices.size() - 1);
+            edges.isSetW.set(edgeIndices[4], true);
         }
-        vertexList[7] = edges.W(vertices[4]);
+        vertexList[7] = edges.W(edgeIndices[4]);
     }
     if (_edgeTable[cubeIndex] & 256) {
-        if (!edges.isSetV(vertices[0])) {
+        if (!edges.isSetV(edgeIndices[0])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[0], vertexPositions[4], 
                                                      vertexValues[0],    vertexValues[4]);
-            _surface.vertices.push_back(v);
-            edges.V.set(vertices[0], _surface.vertices.size() - 1);
-            edges.isSetV.set(vertices[0], true);
+            mesh.vertices.push_back(v);
+            edges.V.set(edgeIndices[0], mesh.vertices.size() - 1);
+            edges.isSetV.set(edgeIndices[0], true);
         }
-        vertexList[8] = edges.V(vertices[0]);
+        vertexList[8] = edges.V(edgeIndices[0]);
     }
     if (_edgeTable[cubeIndex] & 512) {
-        if (!edges.isSetV(vertices[1])) {
+        if (!edges.isSetV(edgeIndices[1])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[1], vertexPositions[5], 
                                                      vertexValues[1],    vertexValues[5]);
-            _surface.vertices.push_back(v);
-            edges.V.set(vertices[1], _surface.vertices.size() - 1);
-            edges.isSetV.set(vertices[1], true);
+            mesh.vertices.push_back(v);
+            edges.V.set(edgeIndices[1], mesh.vertices.size() - 1);
+            edges.isSetV.set(edgeIndices[1], true);
         }
-        vertexList[9] = edges.V(vertices[1]);
+        vertexList[9] = edges.V(edgeIndices[1]);
     }
     if (_edgeTable[cubeIndex] & 1024) {
-        if (!edges.isSetV(vertices[2])) {
+        if (!edges.isSetV(edgeIndices[2])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[2], vertexPositions[6], 
                                                      vertexValues[2],    vertexValues[6]);
-            _surface.vertices.push_back(v);
-            edges.V.set(vertices[2], _surface.vertices.size() - 1);
-            edges.isSetV.set(vertices[2], true);
+            mesh.vertices.push_back(v);
+            edges.V.set(edgeIndices[2], mesh.vertices.size() - 1);
+            edges.isSetV.set(edgeIndices[2], true);
         }
-        vertexList[10] = edges.V(vertices[2]);
+        vertexList[10] = edges.V(edgeIndices[2]);
     }
     if (_edgeTable[cubeIndex] & 2048) {
-        if (!edges.isSetV(vertices[3])) {
+        if (!edges.isSetV(edgeIndices[3])) {
             glm::vec3 v = _vertexInterp(isolevel, vertexPositions[3], vertexPositions[7], 
                                                      vertexValues[3],    vertexValues[7]);
-            _surface.vertices.push_back(v);
-            edges.V.set(vertices[3], _surface.vertices.size() - 1);
-            edges.isSetV.set(vertices[3], true);
+            mesh.vertices.push_back(v);
+            edges.V.set(edgeIndices[3], mesh.vertices.size() - 1);
+            edges.isSetV.set(edgeIndices[3], true);
         }
-        vertexList[11] = edges.V(vertices[3]);
+        vertexList[11] = edges.V(edgeIndices[3]);
     }
 }
 
 // method of polygonizing a cell is adapted from:
 // http://paulbourke.net/geometry/polygonise/
-void Polygonizer3d::_polygonizeCell(GridIndex g, double isolevel, EdgeGrid &edges) {
+void Polygonizer3d::_polygonizeCell(GridIndex g, double isolevel, EdgeGrid &edges,
+                                    TriangleMesh &mesh) {
     int cubeIndex = _calculateCubeIndex(g, isolevel);
 
     /* Cube is entirely in/out of the surface */
@@ -706,30 +722,299 @@ void Polygonizer3d::_polygonizeCell(GridIndex g, double isolevel, EdgeGrid &edge
     }
 
     int vertexList[12];
-    _calculateVertexList(g, isolevel, cubeIndex, vertexList, edges);
+    _calculateVertexList(g, isolevel, cubeIndex, vertexList, edges, mesh);
 
     for (int i = 0; _triTable[cubeIndex][i] != -1; i += 3) {
         Triangle t = Triangle(vertexList[_triTable[cubeIndex][i]],
                               vertexList[_triTable[cubeIndex][i + 1]],
                               vertexList[_triTable[cubeIndex][i + 2]]);
 
-        _surface.triangles.push_back(t);
+        mesh.triangles.push_back(t);
     }
 }
 
 void Polygonizer3d::_calculateSurfaceTriangles() {
     _surface.clear();
-    EdgeGrid edges(_isize, _jsize, _ksize);
+    _sortCellsByLayer(_surfaceCells);
+
+    // Vertex values of a SurfaceField are evaluated lazily and written to
+    // the shared vertex grid, so slabs are only run in parallel when the
+    // values have been set from a scalar field
+    int numThreads = (int)fmin(_numPolygonizerThreads, _ksize);
+    if (_isScalarFieldSet && numThreads > 1 && 
+            (int)_surfaceCells.size() >= _minParallelSurfaceCells) {
+        _calculateSurfaceTrianglesParallel(numThreads);
+        return;
+    }
+
+    _polygonizeSlab(&_surfaceCells, 0, _ksize - 1, NULL, NULL, &_surface);
+}
+
+void Polygonizer3d::_sortCellsByLayer(std::vector<GridIndex> &cells) {
+    std::vector<int> layerStart(_ksize + 1, 0);
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        layerStart[cells[i].k + 1]++;
+    }
+    for (int k = 1; k <= _ksize; k++) {
+        layerStart[k] += layerStart[k - 1];
+    }
+
+    std::vector<GridIndex> sorted(cells.size());
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        sorted[layerStart[cells[i].k]++] = cells[i];
+    }
+    cells.swap(sorted);
+}
+
+void Polygonizer3d::_copyEdgePlane(EdgeGrid &src, int srck, EdgeGrid &dest, int destk) {
+    for (int j = 0; j < src.U.height; j++) {
+        for (int i = 0; i < src.U.width; i++) {
+            dest.U.set(i, j, destk, src.U(i, j, srck));
+            dest.isSetU.set(i, j, destk, src.isSetU(i, j, srck));
+        }
+    }
+
+    for (int j = 0; j < src.V.height; j++) {
+        for (int i = 0; i < src.V.width; i++) {
+            dest.V.set(i, j, destk, src.V(i, j, srck));
+            dest.isSetV.set(i, j, destk, src.isSetV(i, j, srck));
+        }
+    }
+}
+
+void Polygonizer3d::_clearEdgePlane(EdgeGrid &edges, int k) {
+    for (int j = 0; j < edges.isSetU.height; j++) {
+        for (int i = 0; i < edges.isSetU.width; i++) {
+            edges.isSetU.set(i, j, k, false);
+        }
+    }
+
+    for (int j = 0; j < edges.isSetV.height; j++) {
+        for (int i = 0; i < edges.isSetV.width; i++) {
+            edges.isSetV.set(i, j, k, false);
+        }
+    }
+}
+
+/*
+    Moves the edge cache up to the cell layer k. The U and V edges on the
+    top vertex plane of the previous layer are shared with the next layer 
+    and are kept. All other edges can not be touched by the remaining cells.
+*/
+void Polygonizer3d::_advanceEdgeSlice(EdgeGrid &edges, int k) {
+    if (k == edges.koffset + 1) {
+        _copyEdgePlane(edges, 1, edges, 0);
+    } else {
+        _clearEdgePlane(edges, 0);
+    }
+    _clearEdgePlane(edges, 1);
+    edges.isSetW.fill(false);
+    edges.koffset = k;
+}
+
+/*
+    Polygonizes cells sorted by k layer with an edge cache that spans a 
+    single layer of cells, so edge storage is proportional to a slice of 
+    the grid rather than to the full volume. If bottomPlane or topPlane are 
+    given, the edges on the vertex planes at startk and endk + 1 are saved 
+    so that the slab can be welded to its neighbours.
+*/
+void Polygonizer3d::_polygonizeSlab(std::vector<GridIndex> *cells, int startk, int endk,
+                                    EdgeGrid *bottomPlane, EdgeGrid *topPlane,
+                                    TriangleMesh *mesh) {
+    EdgeGrid edges(_isize, _jsize, 1);
+    edges.koffset = startk - 2;
+
+    for (unsigned int i = 0; i < cells->size(); i++) {
+        GridIndex g = cells->at(i);
+        if (g.k != edges.koffset) {
+            if (edges.koffset == startk && bottomPlane != NULL) {
+                _copyEdgePlane(edges, 0, *bottomPlane, 0);
+            }
+            _advanceEdgeSlice(edges, g.k);
+        }
+        _polygonizeCell(g, _surfaceThreshold, edges, *mesh);
+    }
+
+    if (edges.koffset == startk && bottomPlane != NULL) {
+        _copyEdgePlane(edges, 0, *bottomPlane, 0);
+    }
+    if (edges.koffset == endk && topPlane != NULL) {
+        _copyEdgePlane(edges, 1, *topPlane, 0);
+    }
+}
+
+/*
+    Vertices on the plane between two slabs lie on U or V edges that are
+    polygonized by both slabs. These vertices are welded to the vertex
+    created by the lower slab.
+*/
+void Polygonizer3d::_weldSlabBoundary(EdgeGrid &lowerTop, std::vector<int> &lowerRemap,
+                                      EdgeGrid &upperBottom, std::vector<int> &upperRemap) {
+    for (int j = 0; j < upperBottom.U.height; j++) {
+        for (int i = 0; i < upperBottom.U.width; i++) {
+            if (upperBottom.isSetU(i, j, 0) && lowerTop.isSetU(i, j, 0)) {
+                upperRemap[upperBottom.U(i, j, 0)] = lowerRemap[lowerTop.U(i, j, 0)];
+            }
+        }
+    }
+
+    for (int j = 0; j < upperBottom.V.height; j++) {
+        for (int i = 0; i < upperBottom.V.width; i++) {
+            if (upperBottom.isSetV(i, j, 0) && lowerTop.isSetV(i, j, 0)) {
+                upperRemap[upperBottom.V(i, j, 0)] = lowerRemap[lowerTop.V(i, j, 0)];
+            }
+        }
+    }
+}
+
+void Polygonizer3d::_mergeSlabMeshes(std::vector<EdgeGrid*> &bottomPlanes, 
+                                     std::vector<EdgeGrid*> &topPlanes, 
+                                     std::vector<TriangleMesh> &slabMeshes) {
+    int numVertices = 0;
+    int numTriangles = 0;
+    for (unsigned int i = 0; i < slabMeshes.size(); i++) {
+        numVertices += slabMeshes[i].vertices.size();
+        numTriangles += slabMeshes[i].triangles.size();
+    }
+    _surface.vertices.reserve(numVertices);
+    _surface.triangles.reserve(numTriangles);
+
+    std::vector<int> lowerRemap;
+    for (unsigned int sidx = 0; sidx < slabMeshes.size(); sidx++) {
+        TriangleMesh *mesh = &(slabMeshes[sidx]);
+        std::vector<int> remap(mesh->vertices.size(), -1);
+        if (sidx > 0) {
+            _weldSlabBoundary(*(topPlanes[sidx - 1]), lowerRemap, *(bottomPlanes[sidx]), remap);
+        }
+
+        for (unsigned int i = 0; i < mesh->vertices.size(); i++) {
+            if (remap[i] == -1) {
+                remap[i] = _surface.vertices.size();
+                _surface.vertices.push_back(mesh->vertices[i]);
+            }
+        }
+
+        for (unsigned int i = 0; i < mesh->triangles.size(); i++) {
+            Triangle t = mesh->triangles[i];
+            _surface.triangles.push_back(Triangle(remap[t.tri[0]], 
+                                                  remap[t.tri[1]], 
+                                                  remap[t.tri[2]]));
+        }
+
+        lowerRemap = remap;
+    }
+}
+
+/*
+    The grid is split into slabs of cells in the k direction and each thread 
+    polygonizes the surface cells in its slab with its own edge cache. Vertex
+    values of all surface cells have already been evaluated while finding
+    the surface cells, so the threads only read from _vertexValues.
+*/
+void Polygonizer3d::_calculateSurfaceTrianglesParallel(int numThreads) {
+    std::vector<int> startIndices;
+    std::vector<int> endIndices;
+    int chunksize = (int)floor(_ksize / numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        int startIdx = (i == 0) ? 0 : endIndices[i - 1] + 1;
+        int endIdx = (i == numThreads - 1) ? _ksize - 1 : startIdx + chunksize - 1;
+
+        startIndices.push_back(startIdx);
+        endIndices.push_back(endIdx);
+    }
+
+    std::vector<int> slabIndex(_ksize, 0);
+    for (int sidx = 0; sidx < numThreads; sidx++) {
+        for (int k = startIndices[sidx]; k <= endIndices[sidx]; k++) {
+            slabIndex[k] = sidx;
+        }
+    }
+
+    std::vector<std::vector<GridIndex> > slabCells(numThreads);
     for (unsigned int i = 0; i < _surfaceCells.size(); i++) {
-        _polygonizeCell(_surfaceCells[i], _surfaceThreshold, edges);
+        slabCells[slabIndex[_surfaceCells[i].k]].push_back(_surfaceCells[i]);
     }
+
+    std::vector<EdgeGrid*> bottomPlanes;
+    std::vector<EdgeGrid*> topPlanes;
+    std::vector<TriangleMesh> slabMeshes(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        bottomPlanes.push_back(new EdgeGrid(_isize, _jsize, 0));
+        topPlanes.push_back(new EdgeGrid(_isize, _jsize, 0));
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&Polygonizer3d::_polygonizeSlab,
+                                      this,
+                                      &(slabCells[i]),
+                                      startIndices[i],
+                                      endIndices[i],
+                                      bottomPlanes[i],
+                                      topPlanes[i],
+                                      &(slabMeshes[i])));
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        threads[i].join();
+    }
+
+    _mergeSlabMeshes(bottomPlanes, topPlanes, slabMeshes);
+
+    for (int i = 0; i < numThreads; i++) {
+        delete bottomPlanes[i];
+        delete topPlanes[i];
+    }
+}
+
+void Polygonizer3d::enableAdaptivePolygonization() {
+    _isAdaptivePolygonizationEnabled = true;
+}
+
+void Polygonizer3d::enableAdaptivePolygonization(double tolerance) {
+    assert(tolerance >= 0.0);
+    _adaptiveErrorTolerance = tolerance;
+    _isAdaptivePolygonizationEnabled = true;
+}
+
+void Polygonizer3d::disableAdaptivePolygonization() {
+    _isAdaptivePolygonizationEnabled = false;
+}
+
+void Polygonizer3d::_coarsenPlanarRegions() {
+    PlanarSurfaceCoarsener coarsener(_isize, _jsize, _ksize, _dx);
+    coarsener.setErrorTolerance(_adaptiveErrorTolerance);
+    coarsener.setMaxNormalDeviation(_adaptiveNormalDeviation);
+
+    std::vector<bool> isTriangleInPlanarCell;
+    isTriangleInPlanarCell.reserve(_surface.triangles.size());
+
+    GridIndex verts[8];
+    double values[8];
+    GridIndex g;
+    for (unsigned int i = 0; i < _surface.triangles.size(); i++) {
+        g = coarsener.getTriangleCell(_surface, i);
+        Grid3d::getGridIndexVertices(g, verts);
+        for (int idx = 0; idx < 8; idx++) {
+            values[idx] = _getVertexFieldValue(verts[idx]);
+        }
+        isTriangleInPlanarCell.push_back(coarsener.isCellPlanar(values));
+    }
+
+    coarsener.coarsen(_surface, isTriangleInPlanarCell);
 }
 
 void Polygonizer3d::polygonizeSurface() {
-    _surfaceCells = _findSurfaceCells();
+    if (!_isSurfaceCellsSet) {
+        _surfaceCells = _findSurfaceCells();
+    }
     _calculateSurfaceTriangles();
     _surface.removeDuplicateTriangles(); // Polygonization method produces
                                          // some identical triangles for some
                                          // currently unknown reason.
+    if (_isAdaptivePolygonizationEnabled) {
+        _coarsenPlanarRegions();
+    }
     _surface.updateVertexNormals();
 }
\ No newline at end of file
@@ -24,12 +24,14 @@ freely, subject to the following restrictions:
 #include <sstream>
 #include <fstream>
 #include <assert.h>
+#include <thread>
 
 #include "implicitsurfacefield.h"
 #include "implicitsurfacescalarfield.h"
 #include "array3d.h"
 #include "grid3d.h"
 #include "trianglemesh.h"
+#include "planarsurfacecoarsener.h"
 #include "glm/glm.hpp"
 
 #include "stopwatch.h"
@@ -47,11 +49,21 @@ public:
 
     void setSurfaceThreshold(double val) { _field->setSurfaceThreshold(val); }
     void setInsideCellIndices(std::vector<GridIndex> indices);
+    void setSurfaceCells(std::vector<GridIndex> &cells);
     void setScalarField(ImplicitSurfaceScalarField &field);
     void polygonizeSurface();
 
+    // Triangles in cells where the field is planar to within tolerance 
+    // (in cell widths) are coarsened after polygonization
+    void enableAdaptivePolygonization();
+    void enableAdaptivePolygonization(double tolerance);
+    void disableAdaptivePolygonization();
+
     std::vector<GridIndex> getSurfaceCells() { return _surfaceCells; }
     TriangleMesh getTriangleMesh() { return _surface; };
+
+    // Moves the mesh out of the polygonizer instead of copying it
+    TriangleMesh takeTriangleMesh() { return std::move(_surface); };
     void writeSurfaceToOBJ(std::string filename);
 
 private:
@@ -62,6 +74,7 @@ private:
         Array3d<bool> isSetU;
         Array3d<bool> isSetV;
         Array3d<bool> isSetW;
+        int koffset = 0;        // k index of the first vertex plane
 
         EdgeGrid() : U(Array3d<int>(0, 0, 0)),
                      V(Array3d<int>(0, 0, 0)),
@@ -86,11 +99,26 @@ private:
     bool _isCellInsideSurface(GridIndex g);
     bool _isCellOnSurface(GridIndex g);
     int _getCellSurfaceStatus(GridIndex g);
-    void _polygonizeCell(GridIndex g, double isolevel, EdgeGrid &edges);
+    void _polygonizeCell(GridIndex g, double isolevel, EdgeGrid &edges, TriangleMesh &mesh);
     int _calculateCubeIndex(GridIndex g, double isolevel);
-    void _calculateVertexList(GridIndex g, double isolevel, int cubeIndex, int vertList[12], EdgeGrid &edges);
+    void _calculateVertexList(GridIndex g, double isolevel, int cubeIndex, int vertList[12], 
+                              EdgeGrid &edges, TriangleMesh &mesh);
     glm::vec3 _vertexInterp(double isolevel, glm::vec3 p1, glm::vec3 p2, double valp1, double valp2);
     void _calculateSurfaceTriangles();
+    void _calculateSurfaceTrianglesParallel(int numThreads);
+    void _sortCellsByLayer(std::vector<GridIndex> &cells);
+    void _copyEdgePlane(EdgeGrid &src, int srck, EdgeGrid &dest, int destk);
+    void _clearEdgePlane(EdgeGrid &edges, int k);
+    void _advanceEdgeSlice(EdgeGrid &edges, int k);
+    void _polygonizeSlab(std::vector<GridIndex> *cells, int startk, int endk,
+                         EdgeGrid *bottomPlane, EdgeGrid *topPlane, TriangleMesh *mesh);
+    void _weldSlabBoundary(EdgeGrid &lowerTop, std::vector<int> &lowerRemap,
+                           EdgeGrid &upperBottom, std::vector<int> &upperRemap);
+    void _mergeSlabMeshes(std::vector<EdgeGrid*> &bottomPlanes, 
+                          std::vector<EdgeGrid*> &topPlanes, 
+                          std::vector<TriangleMesh> &slabMeshes);
+
+    void _coarsenPlanarRegions();
 
     std::vector<GridIndex> _findSurfaceCells();
     void _resetVertexValues();
@@ -109,6 +137,14 @@ private:
     Array3d<bool> _isCellDone;
     double _surfaceThreshold = 0.5;
     bool _isScalarFieldSet = false;
+    bool _isSurfaceCellsSet = false;
+
+    int _numPolygonizerThreads = 8;
+    int _minParallelSurfaceCells = 4096;
+
+    bool _isAdaptivePolygonizationEnabled = false;
+    double _adaptiveErrorTolerance = 0.1;
+    double _adaptiveNormalDeviation = 0.35;
 
     // cell indices that are fully or partially within the iso surface
     std::vector<GridIndex> _insideIndices;
@@ -25,6 +25,23 @@ freely, subject to the following restrictions:
 
 #include "array3d.h"
 
+struct SparseTileHasher {
+    std::size_t operator()(const GridIndex& t) const {
+        return (std::size_t)((unsigned int)t.i*73856093u ^ 
+                             (unsigned int)t.j*19349663u ^ 
+                             (unsigned int)t.k*83492791u);
+    }
+};
+
+/*
+    A sparse 3d array stored as dense 8x8x8 tiles in a hashed root. A tile 
+    is allocated the first time one of its cells is written and every cell 
+    in the tile starts at the default value. Cells in unallocated tiles 
+    read as the default value.
+
+    Reads do not modify the array and may be made from several threads at 
+    once. Writes must not run at the same time as any other access.
+*/
 template <class T>
 class SparseArray3d
 {
@@ -42,7 +59,7 @@ public:
         depth = obj.depth;
 
         _defaultValue = obj.getDefaultValue();
-        _grid = GridHash(obj.getUnorderedMap());
+        _copyTiles(obj);
 
         if (obj.isOutOfRangeValueSet()) {
             _outOfRangeValue = obj.getOutOfRangeValue();
@@ -52,12 +69,14 @@ public:
 
     SparseArray3d operator=(SparseArray3d &rhs)
     {
+        clear();
+
         width = rhs.width;
         height = rhs.height;
         depth = rhs.depth;
 
         _defaultValue = rhs.getDefaultValue();
-        _grid = GridHash(rhs.getUnorderedMap());
+        _copyTiles(rhs);
 
         if (rhs.isOutOfRangeValueSet()) {
             _outOfRangeValue = rhs.getOutOfRangeValue();
@@ -68,12 +87,17 @@ public:
     }
 
     ~SparseArray3d() {
+        clear();
     }
 
-    
     void clear() {
-        _grid.clear();
-        _sparseIndices.clear();
+        for (unsigned int i = 0; i < _tileData.size(); i++) {
+            delete[] _tileData[i];
+        }
+        _tileData.clear();
+        _tileIndices.clear();
+        _root.clear();
+        _lastTile = NULL;
     }
     
     T operator()(int i, int j, int k)
@@ -84,64 +108,28 @@ public:
         }
         assert(isInRange);
 
-        GridIndex g = GridIndex(i, j, k);
-        T value;
-        if (_isKeyInGrid(g, &value)) {
-            return value;
+        T *tile = _findTile(i / TILE_SIZE, j / TILE_SIZE, k / TILE_SIZE);
+        if (tile == NULL) {
+            return _defaultValue;
         }
 
-        return _defaultValue;
+        return tile[getTileCellIndex(i, j, k)];
     }
 
     T operator()(GridIndex g)
     {
-        bool isInRange = _isIndexInRange(g);
-        if (!isInRange && _isOutOfRangeValueSet) {
-            return _outOfRangeValue;
-        }
-        assert(isInRange);
-
-        T value;
-        if (_isKeyInGrid(g, &value)) {
-            return value;
-        }
-
-        return _defaultValue;
+        return (*this)(g.i, g.j, g.k);
     }
 
     void set(int i, int j, int k, T value) {
         assert(_isIndexInRange(i, j, k));
 
-        GridIndex g = GridIndex(i, j, k);
-        GridHash::iterator it = _grid.find(g);
-        if (it != _grid.end()) {
-            it->second = value;
-            return;
-        }
-
-        std::pair<GridIndex,T> kv(g, value);
-        _grid.insert(kv);
-
-        if (_isTrackingSparseIndices) {
-            _sparseIndices.push_back(g);
-        }
+        T *tile = _getTile(i / TILE_SIZE, j / TILE_SIZE, k / TILE_SIZE);
+        tile[getTileCellIndex(i, j, k)] = value;
     }
 
     void set(GridIndex g, T value) {
-        assert(_isIndexInRange(g.i, g.j, g.k));
-
-        GridHash::iterator it = _grid.find(g);
-        if (it != _grid.end()) {
-            it->second = value;
-            return;
-        }
-
-        std::pair<GridIndex,T> kv(g, value);
-        _grid.insert(kv);
-
-        if (_isTrackingSparseIndices) {
-            _sparseIndices.push_back(g);
-        }
+        set(g.i, g.j, g.k, value);
     }
     
     void set(std::vector<GridIndex> cells, T value) {
@@ -153,36 +141,12 @@ public:
     void add(int i, int j, int k, T value) {
         assert(_isIndexInRange(i, j, k));
 
-        GridIndex g = GridIndex(i, j, k);
-        GridHash::iterator it = _grid.find(g);
-        if (it != _grid.end()) {
-            it->second += value;
-            return;
-        }
-
-        std::pair<GridIndex,T> kv(g, _defaultValue + value);
-        _grid.insert(kv);
-
-        if (_isTrackingSparseIndices) {
-            _sparseIndices.push_back(g);
-        }
+        T *tile = _getTile(i / TILE_SIZE, j / TILE_SIZE, k / TILE_SIZE);
+        tile[getTileCellIndex(i, j, k)] += value;
     }
 
     void add(GridIndex g, T value) {
-        assert(_isIndexInRange(g.i, g.j, g.k));
-
-        GridHash::iterator it = _grid.find(g);
-        if (it != _grid.end()) {
-            it->second += value;
-            return;
-        }
-
-        std::pair<GridIndex,T> kv(g, _defaultValue + value);
-        _grid.insert(kv);
-
-        if (_isTrackingSparseIndices) {
-            _sparseIndices.push_back(g);
-        }
+        add(g.i, g.j, g.k, value);
     }
 
     T *getPointer(int i, int j, int k) {
@@ -192,53 +156,64 @@ public:
         }
         assert(isInRange);
 
-        GridIndex g(i, j, k);
-        if (_IsKeyInGrid(g)) {
-            return &_grid[g];
-        }
+        T *tile = _getTile(i / TILE_SIZE, j / TILE_SIZE, k / TILE_SIZE);
+        return &(tile[getTileCellIndex(i, j, k)]);
+    }
 
-        std::pair<GridIndex,T> kv(g, _defaultValue);
-        _grid.insert(kv);
+    T *getPointer(GridIndex g) {
+        return getPointer(g.i, g.j, g.k);
+    }
 
-        if (_isTrackingSparseIndices) {
-            _sparseIndices.push_back(g);
-        }
+    // Tiles are indexed by (i / TILE_SIZE, j / TILE_SIZE, k / TILE_SIZE). 
+    // Tile memory does not move once allocated, so loops over a region
+    // can look up a tile once and then index its cells directly with
+    // getTileCellIndex.
+    T *getTileData(GridIndex t) {
+        assert(isTileIndexInRange(t));
+        return _getTile(t.i, t.j, t.k);
+    }
 
-        return &_grid[g];
+    // Returns NULL if the tile has not been allocated
+    T *findTileData(GridIndex t) {
+        return _findTile(t.i, t.j, t.k);
     }
 
-    T *getPointer(GridIndex g) {
-        bool isInRange = _isIndexInRange(g.i, g.j, g.k);
-        if (!isInRange && _isOutOfRangeValueSet) {
-            return &_outOfRangeValue;
-        }
-        assert(isInRange);
+    static inline int getTileCellIndex(int i, int j, int k) {
+        return (i % TILE_SIZE) + TILE_SIZE*((j % TILE_SIZE) + TILE_SIZE*(k % TILE_SIZE));
+    }
 
-        if (_IsKeyInGrid(g)) {
-            return &_grid[g];
-        }
+    GridIndex getTileIndex(GridIndex g) {
+        return GridIndex(g.i / TILE_SIZE, g.j / TILE_SIZE, g.k / TILE_SIZE);
+    }
 
-        std::pair<GridIndex,T> kv(g, _defaultValue);
-        _grid.insert(kv);
+    void getTileCellBounds(GridIndex t, GridIndex *gmin, GridIndex *gmax) {
+        *gmin = GridIndex(t.i*TILE_SIZE, t.j*TILE_SIZE, t.k*TILE_SIZE);
+        int imax = gmin->i + TILE_SIZE < width ? gmin->i + TILE_SIZE : width;
+        int jmax = gmin->j + TILE_SIZE < height ? gmin->j + TILE_SIZE : height;
+        int kmax = gmin->k + TILE_SIZE < depth ? gmin->k + TILE_SIZE : depth;
+        *gmax = GridIndex(imax - 1, jmax - 1, kmax - 1);
+    }
 
-        if (_isTrackingSparseIndices) {
-            _sparseIndices.push_back(g);
-        }
+    inline bool isTileIndexInRange(GridIndex t) {
+        return t.i >= 0 && t.j >= 0 && t.k >= 0 && 
+               t.i*TILE_SIZE < width && t.j*TILE_SIZE < height && t.k*TILE_SIZE < depth;
+    }
 
-        return &_grid[g];
+    // Tiles are listed in the order that they were allocated
+    std::vector<GridIndex> getAllocatedTiles() {
+        return _tileIndices;
     }
-    
 
-    void reserve(int n) {
-        _grid.reserve(n);
+    int getNumAllocatedTiles() {
+        return _tileIndices.size();
     }
 
-    std::vector<GridIndex> getSparseIndices() {
-        return _sparseIndices;
+    void reserve(int n) {
+        _root.reserve(n / TILE_NUM_CELLS + 1);
     }
 
     int getNumElements() {
-        return _grid.size();
+        return _tileIndices.size()*TILE_NUM_CELLS;
     }
 
     T getDefaultValue() {
@@ -249,12 +224,8 @@ public:
         _defaultValue = val;
     }
 
-    std::unordered_map<GridIndex, T, GridIndexHasher> getUnorderedMap() {
-        return _grid;
-    }
-
     void setOutOfRangeValue() {
-        _isOutOfrangeValueSet = false;
+        _isOutOfRangeValueSet = false;
     }
     void setOutOfRangeValue(T val) {
         _outOfRangeValue = val;
@@ -269,14 +240,6 @@ public:
         return _outOfRangeValue;
     }
 
-    void enableSparseIndexTracking() {
-        _isTrackingSparseIndices = true;
-    }
-
-    void disableSparseIndexTracking() {
-        _isTrackingSparseIndices = false;
-    }
-
     inline bool isIndexInRange(int i, int j, int k) {
         return i >= 0 && j >= 0 && k >= 0 && i < width && j < height && k < depth;
     }
@@ -285,11 +248,16 @@ public:
         return g.i >= 0 && g.j >= 0 && g.k >= 0 && g.i < width && g.j < height && g.k < depth;
     }
 
+    static const int TILE_SIZE = 8;
+
     int width = 0;
     int height = 0;
     int depth = 0;
 
 private:
+    static const int TILE_NUM_CELLS = TILE_SIZE*TILE_SIZE*TILE_SIZE;
+
+    typedef std::unordered_map<GridIndex, int, SparseTileHasher> TileHash;
 
     inline bool _isIndexInRange(int i, int j, int k) {
         return i >= 0 && j >= 0 && k >= 0 && i < width && j < height && k < depth;
@@ -297,27 +265,70 @@ private:
     inline bool _isIndexInRange(GridIndex g) {
         return g.i >= 0 && g.j >= 0 && g.k >= 0 && g.i < width && g.j < height && g.k < depth;
     }
-    inline bool _isKeyInGrid(GridIndex g) {
-        return _grid.find(g) != _grid.end();
+
+    T *_findTile(int ti, int tj, int tk) {
+        TileHash::const_iterator it = _root.find(GridIndex(ti, tj, tk));
+        if (it == _root.end()) {
+            return NULL;
+        }
+
+        return _tileData[it->second];
     }
-    inline bool _isKeyInGrid(GridIndex g, T *value) {
-        GridHash::const_iterator it = _grid.find(g);
-        if (it != _grid.end()) {
-            *value = it->second;
-            return true;
+
+    // Consecutive writes tend to fall within the same tile, so the last
+    // tile written is checked before the hash lookup. Reads do not use 
+    // the cache so that they can run concurrently.
+    T *_getTile(int ti, int tj, int tk) {
+        if (_lastTile != NULL && _lastTileIndex.i == ti && 
+                _lastTileIndex.j == tj && _lastTileIndex.k == tk) {
+            return _lastTile;
+        }
+
+        T *tile = _findTile(ti, tj, tk);
+        if (tile == NULL) {
+            return _allocateTile(GridIndex(ti, tj, tk));
         }
 
-        return false;
+        _lastTileIndex = GridIndex(ti, tj, tk);
+        _lastTile = tile;
+        return tile;
     }
 
-    typedef std::unordered_map<GridIndex, T, GridIndexHasher> GridHash;
+    T *_allocateTile(GridIndex t) {
+        T *tile = new T[TILE_NUM_CELLS];
+        for (int i = 0; i < TILE_NUM_CELLS; i++) {
+            tile[i] = _defaultValue;
+        }
+
+        _root.insert(std::pair<GridIndex, int>(t, (int)_tileData.size()));
+        _tileData.push_back(tile);
+        _tileIndices.push_back(t);
 
-    GridHash _grid;
-    std::vector<GridIndex> _sparseIndices;
+        _lastTileIndex = t;
+        _lastTile = tile;
+        return tile;
+    }
+
+    void _copyTiles(SparseArray3d &obj) {
+        std::vector<GridIndex> tiles = obj.getAllocatedTiles();
+        _root.reserve(tiles.size());
+        for (unsigned int i = 0; i < tiles.size(); i++) {
+            T *src = obj.findTileData(tiles[i]);
+            T *dest = _allocateTile(tiles[i]);
+            for (int idx = 0; idx < TILE_NUM_CELLS; idx++) {
+                dest[idx] = src[idx];
+            }
+        }
+    }
+
+    TileHash _root;
+    std::vector<T*> _tileData;
+    std::vector<GridIndex> _tileIndices;
+
+    GridIndex _lastTileIndex;
+    T *_lastTile = NULL;
 
     bool _isOutOfRangeValueSet = false;
-    bool _isTrackingSparseIndices = false;
     T _outOfRangeValue;
     T _defaultValue;
 };
-
@@ -29,7 +29,6 @@ SparseImplicitSurfaceScalarField::
                                                 _isize(i), _jsize(j), _ksize(k), _dx(dx),
                                                 _field(i, j, k, 0.0),
                                                 _isVertexSolid(i, j, k, false) {
-    _field.enableSparseIndexTracking();
 }
 
 SparseImplicitSurfaceScalarField::~SparseImplicitSurfaceScalarField() {
@@ -69,33 +68,7 @@ void SparseImplicitSurfaceScalarField::addPoint(glm::vec3 p, double r) {
 }
 
 void SparseImplicitSurfaceScalarField::addPoint(glm::vec3 p) {
-    GridIndex gmin, gmax;
-    Grid3d::getGridIndexBounds(p, _radius, _dx, _isize, _jsize, _ksize, &gmin, &gmax);
-
-    glm::vec3 gpos;
-    glm::vec3 v;
-    double rsq = _radius*_radius;
-    double distsq;
-    double weight;
-    for (int k = gmin.k; k <= gmax.k; k++) {
-        for (int j = gmin.j; j <= gmax.j; j++) {
-            for (int i = gmin.i; i <= gmax.i; i++) {
-                gpos = Grid3d::GridIndexToPosition(i, j, k, _dx);
-                v = gpos - p;
-                distsq = glm::dot(v, v);
-                if (distsq < rsq) {
-                    if (_weightType == WEIGHT_TRICUBIC) {
-                        weight = _evaluateTricubicFieldFunctionForRadiusSquared(distsq);
-                    } else {
-                        weight = _evaluateTrilinearFieldFunction(v);
-                    }
-
-                    _field.add(i, j, k, (float)weight);
-                }
-            }
-        }
-    }
-
+    _addPointValue(p, 1.0);
 }
 
 void SparseImplicitSurfaceScalarField::addPointValue(glm::vec3 p, double r, double value) {
@@ -104,29 +77,61 @@ void SparseImplicitSurfaceScalarField::addPointValue(glm::vec3 p, double r, doub
 }
 
 void SparseImplicitSurfaceScalarField::addPointValue(glm::vec3 p, double scale) {
+    _addPointValue(p, scale);
+}
+
+/*
+    The point's bounds are visited tile by tile so that the tile is looked 
+    up once and its cells are then written through the tile pointer. Tiles 
+    are only allocated if the point contributes to one of their cells.
+*/
+void SparseImplicitSurfaceScalarField::_addPointValue(glm::vec3 p, double scale) {
     GridIndex gmin, gmax;
     Grid3d::getGridIndexBounds(p, _radius, _dx, _isize, _jsize, _ksize, &gmin, &gmax);
+    GridIndex tmin = _field.getTileIndex(gmin);
+    GridIndex tmax = _field.getTileIndex(gmax);
 
     glm::vec3 gpos;
     glm::vec3 v;
     double rsq = _radius*_radius;
     double distsq;
     double weight;
-    for (int k = gmin.k; k <= gmax.k; k++) {
-        for (int j = gmin.j; j <= gmax.j; j++) {
-            for (int i = gmin.i; i <= gmax.i; i++) {
-                gpos = Grid3d::GridIndexToPosition(i, j, k, _dx);
-                v = gpos - p;
-                distsq = glm::dot(v, v);
-                if (distsq < rsq) {
-                    if (_weightType == WEIGHT_TRICUBIC) {
-                        weight = _evaluateTricubicFieldFunctionForRadiusSquared(distsq);
-                    } else {
-                        weight = _evaluateTrilinearFieldFunction(v);
+    GridIndex cmin, cmax;
+    for (int tk = tmin.k; tk <= tmax.k; tk++) {
+        for (int tj = tmin.j; tj <= tmax.j; tj++) {
+            for (int ti = tmin.i; ti <= tmax.i; ti++) {
+                GridIndex t(ti, tj, tk);
+                _field.getTileCellBounds(t, &cmin, &cmax);
+                cmin = GridIndex((int)fmax(cmin.i, gmin.i), 
+                                 (int)fmax(cmin.j, gmin.j), 
+                                 (int)fmax(cmin.k, gmin.k));
+                cmax = GridIndex((int)fmin(cmax.i, gmax.i), 
+                                 (int)fmin(cmax.j, gmax.j), 
+                                 (int)fmin(cmax.k, gmax.k));
+
+                float *tile = NULL;
+                for (int k = cmin.k; k <= cmax.k; k++) {
+                    for (int j = cmin.j; j <= cmax.j; j++) {
+                        for (int i = cmin.i; i <= cmax.i; i++) {
+                            gpos = Grid3d::GridIndexToPosition(i, j, k, _dx);
+                            v = gpos - p;
+                            distsq = glm::dot(v, v);
+                            if (distsq < rsq) {
+                                if (_weightType == WEIGHT_TRICUBIC) {
+                                    weight = _evaluateTricubicFieldFunctionForRadiusSquared(distsq);
+                                } else {
+                                    weight = _evaluateTrilinearFieldFunction(v);
+                                }
+
+                                if (tile == NULL) {
+                                    tile = _field.getTileData(t);
+                                }
+                                tile[SparseArray3d<float>::getTileCellIndex(i, j, k)] += (float)(weight*scale);
+                            }
+                        }
                     }
-
-                    _field.add(i, j, k, (float)(weight*scale));
                 }
+
             }
         }
     }
@@ -169,24 +174,39 @@ void SparseImplicitSurfaceScalarField::getScalarField(SparseArray3d<float> &fiel
            field.height == _field.height && 
            field.depth == _field.depth);
 
-    std::vector<GridIndex> indices = _field.getSparseIndices();
+    std::vector<GridIndex> tiles = _field.getAllocatedTiles();
 
     double eps = 10e-9;
     double val;
 
-    GridIndex g;
-    for (unsigned int i = 0; i < indices.size(); i++) {
-        g = indices[i];
-        val = _field(g);
-        if (val < eps) {
-            continue;
-        }
+    GridIndex t, gmin, gmax;
+    for (unsigned int tidx = 0; tidx < tiles.size(); tidx++) {
+        t = tiles[tidx];
+        float *src = _field.findTileData(t);
+        bool *solid = _isVertexSolid.findTileData(t);
+        float *dest = NULL;
+
+        _field.getTileCellBounds(t, &gmin, &gmax);
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    int cidx = SparseArray3d<float>::getTileCellIndex(i, j, k);
+                    val = src[cidx];
+                    if (val < eps) {
+                        continue;
+                    }
 
-        if (val > _surfaceThreshold && _isVertexSolid(g)) {
-            val = _surfaceThreshold;
-        } 
+                    if (val > _surfaceThreshold && solid != NULL && solid[cidx]) {
+                        val = _surfaceThreshold;
+                    }
 
-        field.set(g, (float)val);
+                    if (dest == NULL) {
+                        dest = field.getTileData(t);
+                    }
+                    dest[cidx] = (float)val;
+                }
+            }
+        }
     }
 
 }
@@ -64,6 +64,7 @@ private:
         return 0.0;
     }
 
+    void _addPointValue(glm::vec3 p, double scale);
     double _evaluateTricubicFieldFunctionForRadiusSquared(double rsq);
     double _evaluateTrilinearFieldFunction(glm::vec3 v);
 
@@ -46,6 +46,8 @@ SparsePolygonizer3d::SparsePolygonizer3d(SparseImplicitSurfaceScalarField &scala
     std::cout << "\tGET VERTEX VALUES: " << timer1.getTime() << std::endl;
 
     _isCellDone = SparseArray3d<bool>(_isize, _jsize, _ksize, false);
+    _cellBoundsMin = GridIndex(0, 0, 0);
+    _cellBoundsMax = GridIndex(_isize - 1, _jsize - 1, _ksize - 1);
 
     _isInitialized = true;
 }
@@ -444,6 +446,18 @@ int SparsePolygonizer3d::_getCellSurfaceStatus(GridIndex g) {
     }
 }
 
+void SparsePolygonizer3d::setCellBounds(GridIndex gmin, GridIndex gmax) {
+    _cellBoundsMin = GridIndex((int)fmax(gmin.i, 0), (int)fmax(gmin.j, 0), (int)fmax(gmin.k, 0));
+    _cellBoundsMax = GridIndex((int)fmin(gmax.i, _isize - 1), 
+                               (int)fmin(gmax.j, _jsize - 1), 
+                               (int)fmin(gmax.k, _ksize - 1));
+}
+
+bool SparsePolygonizer3d::_isCellInBounds(GridIndex g) {
+    return g.i >= _cellBoundsMin.i && g.j >= _cellBoundsMin.j && g.k >= _cellBoundsMin.k &&
+           g.i <= _cellBoundsMax.i && g.j <= _cellBoundsMax.j && g.k <= _cellBoundsMax.k;
+}
+
 bool SparsePolygonizer3d::_isCellDataAvailable(GridIndex g) {
     GridIndex vertices[8];
     Grid3d::getGridIndexVertices(g, vertices);
@@ -474,7 +488,7 @@ std::vector<GridIndex> SparsePolygonizer3d::_processSeedCell(GridIndex seed,
         Grid3d::getNeighbourGridIndices6(c, neighbours);
         for (int idx = 0; idx < 6; idx++) {
             GridIndex n = neighbours[idx];
-            bool isValidCell = Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
+            bool isValidCell = _isCellInBounds(n) && 
                                !isCellDone(n) && 
                                _isCellDataAvailable(n) &&
                                _isCellOnSurface(n);
@@ -501,7 +515,7 @@ std::vector<GridIndex> SparsePolygonizer3d::_findSurfaceCells() {
             continue;
         }
 
-        while (Grid3d::isGridIndexInRange(cell, _isize, _jsize, _ksize)) {
+        while (_isCellInBounds(cell)) {
 
             if (!_isCellDataAvailable(cell)) {
                 break;
@@ -724,6 +738,39 @@ void SparsePolygonizer3d::_calculateSurfaceTriangles() {
     }
 }
 
+void SparsePolygonizer3d::enableAdaptivePolygonization() {
+    _isAdaptivePolygonizationEnabled = true;
+}
+
+void SparsePolygonizer3d::enableAdaptivePolygonization(double tolerance) {
+    assert(tolerance >= 0.0);
+    _adaptiveErrorTolerance = tolerance;
+    _isAdaptivePolygonizationEnabled = true;
+}
+
+void SparsePolygonizer3d::disableAdaptivePolygonization() {
+    _isAdaptivePolygonizationEnabled = false;
+}
+
+void SparsePolygonizer3d::_coarsenPlanarRegions() {
+    PlanarSurfaceCoarsener coarsener(_isize, _jsize, _ksize, _dx);
+    coarsener.setErrorTolerance(_adaptiveErrorTolerance);
+    coarsener.setMaxNormalDeviation(_adaptiveNormalDeviation);
+
+    std::vector<bool> isTriangleInPlanarCell;
+    isTriangleInPlanarCell.reserve(_surface.triangles.size());
+
+    double values[8];
+    GridIndex g;
+    for (unsigned int i = 0; i < _surface.triangles.size(); i++) {
+        g = coarsener.getTriangleCell(_surface, i);
+        _getCellVertexValues(g, values);
+        isTriangleInPlanarCell.push_back(coarsener.isCellPlanar(values));
+    }
+
+    coarsener.coarsen(_surface, isTriangleInPlanarCell);
+}
+
 void SparsePolygonizer3d::polygonizeSurface() {
 
     _surfaceCells = _findSurfaceCells();
@@ -733,5 +780,8 @@ void SparsePolygonizer3d::polygonizeSurface() {
     _surface.removeDuplicateTriangles(); // Polygonization method produces
                                          // some identical triangles for some
                                          // currently unknown reason.
+    if (_isAdaptivePolygonizationEnabled) {
+        _coarsenPlanarRegions();
+    }
     _surface.updateVertexNormals();
 }
\ No newline at end of file
@@ -30,6 +30,7 @@ freely, subject to the following restrictions:
 #include "sparsearray3d.h"
 #include "grid3d.h"
 #include "trianglemesh.h"
+#include "planarsurfacecoarsener.h"
 #include "glm/glm.hpp"
 
 #include "stopwatch.h"
@@ -46,11 +47,23 @@ public:
 
     void setSurfaceThreshold(double val) { _field->setSurfaceThreshold(val); }
     void setSurfaceCellIndices(std::vector<GridIndex> indices);
+
+    // Surface cells outside of the bounds will not be polygonized
+    void setCellBounds(GridIndex gmin, GridIndex gmax);
     void setScalarField(SparseImplicitSurfaceScalarField &field);
     void polygonizeSurface();
 
+    // Triangles in cells where the field is planar to within tolerance 
+    // (in cell widths) are coarsened after polygonization
+    void enableAdaptivePolygonization();
+    void enableAdaptivePolygonization(double tolerance);
+    void disableAdaptivePolygonization();
+
     std::vector<GridIndex> getSurfaceCells() { return _surfaceCells; }
     TriangleMesh getTriangleMesh() { return _surface; };
+
+    // Moves the mesh out of the polygonizer instead of copying it
+    TriangleMesh takeTriangleMesh() { return std::move(_surface); };
     void writeSurfaceToOBJ(std::string filename);
 
 private:
@@ -79,6 +92,7 @@ private:
     bool _isCellOutsideSurface(GridIndex g);
     bool _isCellInsideSurface(GridIndex g);
     bool _isCellOnSurface(GridIndex g);
+    bool _isCellInBounds(GridIndex g);
     bool _isCellDataAvailable(GridIndex g);
     int _getCellSurfaceStatus(GridIndex g);
     void _polygonizeCell(GridIndex g, double isolevel, EdgeGrid &edges);
@@ -87,6 +101,8 @@ private:
     glm::vec3 _vertexInterp(double isolevel, glm::vec3 p1, glm::vec3 p2, double valp1, double valp2);
     void _calculateSurfaceTriangles();
 
+    void _coarsenPlanarRegions();
+
     std::vector<GridIndex> _findSurfaceCells();
     void _resetVertexValues();
     std::vector<GridIndex> _processSeedCell(GridIndex seed, SparseArray3d<bool> &isCellDone);
@@ -103,6 +119,13 @@ private:
     SparseArray3d<bool> _isCellDone;
     double _surfaceThreshold = 0.5;
 
+    GridIndex _cellBoundsMin;
+    GridIndex _cellBoundsMax;
+
+    bool _isAdaptivePolygonizationEnabled = false;
+    double _adaptiveErrorTolerance = 0.1;
+    double _adaptiveNormalDeviation = 0.35;
+
     // cell indices that are fully or partially within the iso surface
     std::vector<GridIndex> _surfaceIndices;
     std::vector<GridIndex> _surfaceCells;
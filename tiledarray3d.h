@@ -0,0 +1,344 @@
+/*
+Copyright (c) 2015 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <vector>
+#include <assert.h>
+
+#include "array3d.h"
+
+/*
+    A 3d array stored as 8x8x8 tiles. Memory is only allocated for tiles
+    that have been written with a value different from the tile's constant
+    value. Unallocated tiles return their constant value for every cell.
+*/
+template <class T>
+class TiledArray3d
+{
+public:
+    TiledArray3d() : width(0), height(0), depth(0)
+    {
+        _initializeTiles();
+    }
+
+    TiledArray3d(int i, int j, int k) : width(i), height(j), depth(k)
+    {
+        _initializeTiles();
+    }
+
+    TiledArray3d(int i, int j, int k, T fillValue) : width(i), height(j), depth(k)
+    {
+        _initializeTiles();
+        fill(fillValue);
+    }
+
+    TiledArray3d(TiledArray3d &obj)
+    {
+        width = obj.width;
+        height = obj.height;
+        depth = obj.depth;
+
+        _initializeTiles();
+        _copyTiles(obj);
+    }
+
+    TiledArray3d operator=(TiledArray3d &rhs)
+    {
+        _deallocateTiles();
+
+        width = rhs.width;
+        height = rhs.height;
+        depth = rhs.depth;
+
+        _initializeTiles();
+        _copyTiles(rhs);
+
+        return *this;
+    }
+
+    ~TiledArray3d()
+    {
+        _deallocateTiles();
+    }
+
+    void fill(T value) {
+        for (unsigned int i = 0; i < _tiles.size(); i++) {
+            _releaseTile(i);
+            _tileValues[i].value = value;
+        }
+    }
+
+    T operator()(int i, int j, int k)
+    {
+        bool isInRange = _isIndexInRange(i, j, k);
+        if (!isInRange && _isOutOfRangeValueSet) {
+            return _outOfRangeValue;
+        }
+        assert(isInRange);
+
+        int tidx = _getTileFlatIndex(i, j, k);
+        T *tile = _tiles[tidx];
+        if (tile == NULL) {
+            return _tileValues[tidx].value;
+        }
+
+        return tile[_getCellFlatIndex(i, j, k)];
+    }
+
+    T operator()(GridIndex g)
+    {
+        return (*this)(g.i, g.j, g.k);
+    }
+
+    void set(int i, int j, int k, T value) {
+        assert(_isIndexInRange(i, j, k));
+
+        int tidx = _getTileFlatIndex(i, j, k);
+        T *tile = _tiles[tidx];
+        if (tile == NULL) {
+            if (value == _tileValues[tidx].value) {
+                return;
+            }
+            tile = _allocateTile(tidx);
+        }
+
+        tile[_getCellFlatIndex(i, j, k)] = value;
+    }
+
+    void set(GridIndex g, T value) {
+        set(g.i, g.j, g.k, value);
+    }
+
+    void set(std::vector<GridIndex> &cells, T value) {
+        for (unsigned int i = 0; i < cells.size(); i++) {
+            set(cells[i], value);
+        }
+    }
+
+    void add(int i, int j, int k, T value) {
+        assert(_isIndexInRange(i, j, k));
+
+        int tidx = _getTileFlatIndex(i, j, k);
+        T *tile = _tiles[tidx];
+        if (tile == NULL) {
+            tile = _allocateTile(tidx);
+        }
+
+        tile[_getCellFlatIndex(i, j, k)] += value;
+    }
+
+    void add(GridIndex g, T value) {
+        add(g.i, g.j, g.k, value);
+    }
+
+    // Tiles are indexed by (i / TILE_SIZE, j / TILE_SIZE, k / TILE_SIZE)
+    void getTileGridDimensions(int *ti, int *tj, int *tk) {
+        *ti = _tileWidth;
+        *tj = _tileHeight;
+        *tk = _tileDepth;
+    }
+
+    GridIndex getTileIndex(GridIndex g) {
+        return GridIndex(g.i / TILE_SIZE, g.j / TILE_SIZE, g.k / TILE_SIZE);
+    }
+
+    void getTileCellBounds(GridIndex t, GridIndex *gmin, GridIndex *gmax) {
+        *gmin = GridIndex(t.i*TILE_SIZE, t.j*TILE_SIZE, t.k*TILE_SIZE);
+        int imax = gmin->i + TILE_SIZE < width ? gmin->i + TILE_SIZE : width;
+        int jmax = gmin->j + TILE_SIZE < height ? gmin->j + TILE_SIZE : height;
+        int kmax = gmin->k + TILE_SIZE < depth ? gmin->k + TILE_SIZE : depth;
+        *gmax = GridIndex(imax - 1, jmax - 1, kmax - 1);
+    }
+
+    inline bool isTileIndexInRange(GridIndex t) {
+        return t.i >= 0 && t.j >= 0 && t.k >= 0 && 
+               t.i < _tileWidth && t.j < _tileHeight && t.k < _tileDepth;
+    }
+
+    bool isTileAllocated(GridIndex t) {
+        assert(isTileIndexInRange(t));
+        return _tiles[_getTileFlatIndexFromTile(t)] != NULL;
+    }
+
+    T getTileValue(GridIndex t) {
+        assert(isTileIndexInRange(t));
+        return _tileValues[_getTileFlatIndexFromTile(t)].value;
+    }
+
+    // Releases the tile memory and sets every cell in the tile to value
+    void setTileValue(GridIndex t, T value) {
+        assert(isTileIndexInRange(t));
+        int tidx = _getTileFlatIndexFromTile(t);
+        _releaseTile(tidx);
+        _tileValues[tidx].value = value;
+    }
+
+    void getAllocatedTiles(std::vector<GridIndex> &tiles) {
+        for (int k = 0; k < _tileDepth; k++) {
+            for (int j = 0; j < _tileHeight; j++) {
+                for (int i = 0; i < _tileWidth; i++) {
+                    if (_tiles[_getTileFlatIndexFromTile(GridIndex(i, j, k))] != NULL) {
+                        tiles.push_back(GridIndex(i, j, k));
+                    }
+                }
+            }
+        }
+    }
+
+    int getNumAllocatedTiles() {
+        int n = 0;
+        for (unsigned int i = 0; i < _tiles.size(); i++) {
+            if (_tiles[i] != NULL) {
+                n++;
+            }
+        }
+        return n;
+    }
+
+    void setOutOfRangeValue() {
+        _isOutOfRangeValueSet = false;
+    }
+    void setOutOfRangeValue(T val) {
+        _outOfRangeValue = val;
+        _isOutOfRangeValueSet = true;
+    }
+
+    bool isOutOfRangeValueSet() {
+        return _isOutOfRangeValueSet;
+    }
+    T getOutOfRangeValue() {
+        return _outOfRangeValue;
+    }
+
+    inline bool isIndexInRange(int i, int j, int k) {
+        return i >= 0 && j >= 0 && k >= 0 && i < width && j < height && k < depth;
+    }
+
+    inline bool isIndexInRange(GridIndex g) {
+        return g.i >= 0 && g.j >= 0 && g.k >= 0 && g.i < width && g.j < height && g.k < depth;
+    }
+
+    static const int TILE_SIZE = 8;
+
+    int width = 0;
+    int height = 0;
+    int depth = 0;
+
+private:
+    static const int TILE_NUM_CELLS = TILE_SIZE*TILE_SIZE*TILE_SIZE;
+
+    void _initializeTiles() {
+        _tileWidth = (width + TILE_SIZE - 1) / TILE_SIZE;
+        _tileHeight = (height + TILE_SIZE - 1) / TILE_SIZE;
+        _tileDepth = (depth + TILE_SIZE - 1) / TILE_SIZE;
+
+        int n = _tileWidth*_tileHeight*_tileDepth;
+        _tiles = std::vector<T*>(n, (T*)NULL);
+        _tileValues = std::vector<TileValue>(n, TileValue());
+    }
+
+    void _deallocateTiles() {
+        for (unsigned int i = 0; i < _tiles.size(); i++) {
+            _releaseTile(i);
+        }
+    }
+
+    void _copyTiles(TiledArray3d &obj) {
+        GridIndex t;
+        for (int k = 0; k < _tileDepth; k++) {
+            for (int j = 0; j < _tileHeight; j++) {
+                for (int i = 0; i < _tileWidth; i++) {
+                    t = GridIndex(i, j, k);
+                    int tidx = _getTileFlatIndexFromTile(t);
+                    _tileValues[tidx].value = obj.getTileValue(t);
+                    if (obj.isTileAllocated(t)) {
+                        T *tile = _allocateTile(tidx);
+                        obj._copyTileData(tidx, tile);
+                    }
+                }
+            }
+        }
+
+        if (obj.isOutOfRangeValueSet()) {
+            _outOfRangeValue = obj.getOutOfRangeValue();
+            _isOutOfRangeValueSet = true;
+        }
+    }
+
+    void _copyTileData(int tidx, T *dest) {
+        T *src = _tiles[tidx];
+        for (int i = 0; i < TILE_NUM_CELLS; i++) {
+            dest[i] = src[i];
+        }
+    }
+
+    // Tile memory is filled with the constant value of the tile. Writes to
+    // different tiles may happen concurrently.
+    T *_allocateTile(int tidx) {
+        T *tile = new T[TILE_NUM_CELLS];
+        T value = _tileValues[tidx].value;
+        for (int i = 0; i < TILE_NUM_CELLS; i++) {
+            tile[i] = value;
+        }
+
+        _tiles[tidx] = tile;
+        return tile;
+    }
+
+    void _releaseTile(int tidx) {
+        if (_tiles[tidx] != NULL) {
+            delete[] _tiles[tidx];
+            _tiles[tidx] = NULL;
+        }
+    }
+
+    inline bool _isIndexInRange(int i, int j, int k) {
+        return i >= 0 && j >= 0 && k >= 0 && i < width && j < height && k < depth;
+    }
+
+    inline int _getTileFlatIndex(int i, int j, int k) {
+        return (i / TILE_SIZE) + _tileWidth*((j / TILE_SIZE) + _tileHeight*(k / TILE_SIZE));
+    }
+
+    inline int _getTileFlatIndexFromTile(GridIndex t) {
+        return t.i + _tileWidth*(t.j + _tileHeight*t.k);
+    }
+
+    inline int _getCellFlatIndex(int i, int j, int k) {
+        return (i % TILE_SIZE) + TILE_SIZE*((j % TILE_SIZE) + TILE_SIZE*(k % TILE_SIZE));
+    }
+
+    int _tileWidth = 0;
+    int _tileHeight = 0;
+    int _tileDepth = 0;
+
+    // Tile values are wrapped so that std::vector<bool> is never used. Each
+    // tile value has its own storage and can be set from a different thread.
+    struct TileValue {
+        T value;
+        TileValue() : value() {}
+    };
+
+    std::vector<T*> _tiles;
+    std::vector<TileValue> _tileValues;
+
+    bool _isOutOfRangeValueSet = false;
+    T _outOfRangeValue;
+};
@@ -24,6 +24,67 @@ TriangleMesh::TriangleMesh()
 {
 }
 
+TriangleMesh::TriangleMesh(const TriangleMesh &other) {
+    *this = other;
+}
+
+TriangleMesh::TriangleMesh(TriangleMesh &&other) {
+    *this = std::move(other);
+}
+
+TriangleMesh &TriangleMesh::operator=(const TriangleMesh &other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    vertices = other.vertices;
+    vertexcolors = other.vertexcolors;
+    normals = other.normals;
+    triangles = other.triangles;
+
+    _gridi = other._gridi;
+    _gridj = other._gridj;
+    _gridk = other._gridk;
+    _dx = other._dx;
+    _numAdjacencyThreads = other._numAdjacencyThreads;
+
+    _vertexTriangleOffsets = other._vertexTriangleOffsets;
+    _vertexTriangleIndices = other._vertexTriangleIndices;
+    _vertexNeighbourOffsets = other._vertexNeighbourOffsets;
+    _vertexNeighbourIndices = other._vertexNeighbourIndices;
+    _triangleAreas = other._triangleAreas;
+
+    return *this;
+}
+
+TriangleMesh &TriangleMesh::operator=(TriangleMesh &&other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    vertices = std::move(other.vertices);
+    vertexcolors = std::move(other.vertexcolors);
+    normals = std::move(other.normals);
+    triangles = std::move(other.triangles);
+
+    _gridi = other._gridi;
+    _gridj = other._gridj;
+    _gridk = other._gridk;
+    _dx = other._dx;
+    _numAdjacencyThreads = other._numAdjacencyThreads;
+
+    _vertexTriangleOffsets = std::move(other._vertexTriangleOffsets);
+    _vertexTriangleIndices = std::move(other._vertexTriangleIndices);
+    _vertexNeighbourOffsets = std::move(other._vertexNeighbourOffsets);
+    _vertexNeighbourIndices = std::move(other._vertexNeighbourIndices);
+    _triangleAreas = std::move(other._triangleAreas);
+
+    other.clear();
+    other._triangleAreas.clear();
+
+    return *this;
+}
+
 TriangleMesh::~TriangleMesh()
 {
 }
@@ -40,7 +101,7 @@ void TriangleMesh::clear() {
     vertices.clear();
     normals.clear();
     triangles.clear();
-    _vertexTriangles.clear();
+    _clearVertexAdjacency();
 }
 
 // method of loading OBJ from:
@@ -393,64 +454,273 @@ int TriangleMesh::_numDigitsInInteger(int num) {
     return count;
 }
 
-bool triangleSort(const Triangle &a, const Triangle &b)
-{
-    if (a.tri[0]==b.tri[0]) {
-        if (a.tri[1]==b.tri[1]) {
-            return a.tri[2] < b.tri[2];
-        } else {
-            return a.tri[1] < b.tri[1];
+/*
+    Triangles are compared by their indices rotated so that the smallest
+    index comes first. Rotations of the same triangle are duplicates while
+    triangles of opposite winding are not. The first occurrence of each
+    triangle is kept and the order of the remaining triangles is preserved.
+*/
+void TriangleMesh::removeDuplicateTriangles() {
+    int n = (int)triangles.size();
+    std::vector<HashKey> keys(n);
+    std::vector<int> partitions(n);
+
+    std::vector<int> startIndices, endIndices;
+    std::vector<std::thread> threads(_numAdjacencyThreads);
+    _getThreadIndexRanges(n, _numAdjacencyThreads, startIndices, endIndices);
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i] = std::thread(&TriangleMesh::_calculateTriangleKeys, this,
+                                 startIndices[i], endIndices[i], &keys, &partitions);
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    std::vector<int> firstIndices(n);
+    _findFirstKeyOccurrencesParallel(keys, partitions, firstIndices);
+
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (firstIndices[i] == i) {
+            triangles[count] = triangles[i];
+            count++;
         }
-    } else {
-        return a.tri[0] < b.tri[0];
     }
+    triangles.resize(count);
+
+    _clearVertexAdjacency();
+    _triangleAreas.clear();
 }
 
-void TriangleMesh::removeDuplicateTriangles() {
-    std::vector<Triangle> uniqueTriangles;
+void TriangleMesh::weldVertices(double tolerance) {
+    std::vector<int> remap;
+    weldVertices(tolerance, remap);
+}
+
+/*
+    Merges vertices whose positions quantize to the same key on a grid with
+    spacing tolerance. Each group is replaced by its lowest indexed vertex and 
+    remap[i] is set to the new index of old vertex i so that external per 
+    vertex data can follow. Vertex colours and normals are compacted along 
+    with the vertices. Triangles that collapse to a line or point and 
+    triangles that become duplicates are removed.
+*/
+void TriangleMesh::weldVertices(double tolerance, std::vector<int> &remap) {
+    assert(tolerance > 0.0);
+
+    int n = (int)vertices.size();
+    std::vector<HashKey> keys(n);
+    std::vector<int> partitions(n);
+
+    std::vector<int> startIndices, endIndices;
+    std::vector<std::thread> threads(_numAdjacencyThreads);
+    _getThreadIndexRanges(n, _numAdjacencyThreads, startIndices, endIndices);
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i] = std::thread(&TriangleMesh::_calculateVertexKeys, this,
+                                 startIndices[i], endIndices[i], 1.0 / tolerance,
+                                 &keys, &partitions);
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    std::vector<int> firstIndices(n);
+    _findFirstKeyOccurrencesParallel(keys, partitions, firstIndices);
+
+    bool isColorsSet = vertexcolors.size() == vertices.size();
+    bool isNormalsSet = normals.size() == vertices.size();
+
+    remap.assign(n, -1);
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        if (firstIndices[i] != i) {
+            remap[i] = remap[firstIndices[i]];
+            continue;
+        }
+
+        vertices[count] = vertices[i];
+        if (isColorsSet) {
+            vertexcolors[count] = vertexcolors[i];
+        }
+        if (isNormalsSet) {
+            normals[count] = normals[i];
+        }
+        remap[i] = count;
+        count++;
+    }
+
+    vertices.resize(count);
+    if (isColorsSet) {
+        vertexcolors.resize(count);
+    }
+    if (isNormalsSet) {
+        normals.resize(count);
+    }
+
+    _getThreadIndexRanges((int)triangles.size(), _numAdjacencyThreads, 
+                          startIndices, endIndices);
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i] = std::thread(&TriangleMesh::_remapTriangles, this,
+                                 startIndices[i], endIndices[i], &remap);
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
 
-    std::sort(triangles.begin(), triangles.end(), triangleSort);
-    Triangle last;
+    int tcount = 0;
+    Triangle t;
     for (unsigned int i = 0; i < triangles.size(); i++) {
-        Triangle t = triangles[i];
+        t = triangles[i];
+        if (t.tri[0] == t.tri[1] || t.tri[1] == t.tri[2] || t.tri[2] == t.tri[0]) {
+            continue;
+        }
+        triangles[tcount] = t;
+        tcount++;
+    }
+    triangles.resize(tcount);
 
-        if (!_trianglesEqual(t, last)) {
-            uniqueTriangles.push_back(t);
+    removeDuplicateTriangles();
+}
+
+void TriangleMesh::_calculateVertexKeys(int startidx, int endidx, double invTolerance,
+                                        std::vector<HashKey> *keys, 
+                                        std::vector<int> *partitions) {
+    HashKeyHasher hasher;
+    glm::vec3 v;
+    HashKey key;
+    for (int i = startidx; i <= endidx; i++) {
+        v = vertices[i];
+        key = HashKey((long long)floor(v.x*invTolerance + 0.5),
+                      (long long)floor(v.y*invTolerance + 0.5),
+                      (long long)floor(v.z*invTolerance + 0.5));
+        keys->at(i) = key;
+        partitions->at(i) = (int)(hasher(key) % (std::size_t)_numAdjacencyThreads);
+    }
+}
+
+void TriangleMesh::_calculateTriangleKeys(int startidx, int endidx,
+                                          std::vector<HashKey> *keys, 
+                                          std::vector<int> *partitions) {
+    HashKeyHasher hasher;
+    Triangle t;
+    HashKey key;
+    for (int i = startidx; i <= endidx; i++) {
+        t = triangles[i];
+        int first = 0;
+        if (t.tri[1] < t.tri[first]) { first = 1; }
+        if (t.tri[2] < t.tri[first]) { first = 2; }
+
+        key = HashKey(t.tri[first], t.tri[(first + 1) % 3], t.tri[(first + 2) % 3]);
+        keys->at(i) = key;
+        partitions->at(i) = (int)(hasher(key) % (std::size_t)_numAdjacencyThreads);
+    }
+}
+
+/*
+    Keys are split between threads by hash so that each thread owns a 
+    disjoint set of keys and can use its own map. Every thread scans the
+    keys in index order so the first occurrence found is the lowest index.
+*/
+void TriangleMesh::_findFirstKeyOccurrences(int partition, std::vector<HashKey> *keys,
+                                            std::vector<int> *partitions,
+                                            std::vector<int> *firstIndices) {
+    std::unordered_map<HashKey, int, HashKeyHasher> firstOccurrences;
+    std::unordered_map<HashKey, int, HashKeyHasher>::iterator it;
+    for (unsigned int i = 0; i < keys->size(); i++) {
+        if (partitions->at(i) != partition) {
+            continue;
+        }
+
+        it = firstOccurrences.find(keys->at(i));
+        if (it == firstOccurrences.end()) {
+            firstOccurrences.insert(std::pair<HashKey, int>(keys->at(i), i));
+            firstIndices->at(i) = i;
+        } else {
+            firstIndices->at(i) = it->second;
         }
-        last = t;
     }
+}
 
-    triangles.clear();
-    triangles.insert(triangles.end(), uniqueTriangles.begin(), uniqueTriangles.end());
+void TriangleMesh::_findFirstKeyOccurrencesParallel(std::vector<HashKey> &keys,
+                                                    std::vector<int> &partitions,
+                                                    std::vector<int> &firstIndices) {
+    std::vector<std::thread> threads(_numAdjacencyThreads);
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i] = std::thread(&TriangleMesh::_findFirstKeyOccurrences, this,
+                                 i, &keys, &partitions, &firstIndices);
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void TriangleMesh::_remapTriangles(int startidx, int endidx, std::vector<int> *remap) {
+    for (int i = startidx; i <= endidx; i++) {
+        triangles[i].tri[0] = remap->at(triangles[i].tri[0]);
+        triangles[i].tri[1] = remap->at(triangles[i].tri[1]);
+        triangles[i].tri[2] = remap->at(triangles[i].tri[2]);
+    }
 }
 
 void TriangleMesh::updateVertexNormals() {
-    normals.clear();
-    _updateVertexTriangles();
-    
-    std::vector<glm::vec3> facenormals;
-    facenormals.reserve((int)triangles.size());
+    _updateVertexAdjacency();
+    _updateVertexNormals();
+}
+
+void TriangleMesh::_updateVertexNormals() {
+    std::vector<glm::vec3> facenormals(triangles.size());
+    normals.assign(vertices.size(), glm::vec3(0.0, 0.0, 0.0));
+
+    std::vector<int> startIndices, endIndices;
+    std::vector<std::thread> threads(_numAdjacencyThreads);
+
+    _getThreadIndexRanges((int)triangles.size(), _numAdjacencyThreads,
+                          startIndices, endIndices);
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i] = std::thread(&TriangleMesh::_calculateFaceNormals, this,
+                                 startIndices[i], endIndices[i], &facenormals);
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    _getThreadIndexRanges((int)vertices.size(), _numAdjacencyThreads,
+                          startIndices, endIndices);
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i] = std::thread(&TriangleMesh::_calculateVertexNormals, this,
+                                 startIndices[i], endIndices[i], &facenormals);
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void TriangleMesh::_calculateFaceNormals(int startidx, int endidx,
+                                         std::vector<glm::vec3> *facenormals) {
     Triangle t;
     glm::vec3 v1, v2;
-    for (unsigned int i = 0; i < triangles.size(); i++) {
+    for (int i = startidx; i <= endidx; i++) {
         t = triangles[i];
 
         v1 = vertices[t.tri[1]] - vertices[t.tri[0]];
         v2 = vertices[t.tri[2]] - vertices[t.tri[0]];
-        glm::vec3 norm = glm::normalize(glm::cross(v1, v2));
-
-        facenormals.push_back(norm);
+        facenormals->at(i) = glm::normalize(glm::cross(v1, v2));
     }
+}
 
+void TriangleMesh::_calculateVertexNormals(int startidx, int endidx,
+                                           std::vector<glm::vec3> *facenormals) {
     glm::vec3 n;
-    for (unsigned int i = 0; i < _vertexTriangles.size(); i++) {
+    for (int i = startidx; i <= endidx; i++) {
+        int start = _vertexTriangleOffsets[i];
+        int end = _vertexTriangleOffsets[i + 1];
+
         n = glm::vec3(0.0, 0.0, 0.0);
-        for (unsigned int j = 0; j < _vertexTriangles[i].size(); j++) {
-            n += facenormals[_vertexTriangles[i][j]];
+        for (int j = start; j < end; j++) {
+            n += facenormals->at(_vertexTriangleIndices[j]);
         }
 
-        n = glm::normalize(n / (float)_vertexTriangles[i].size());
-        normals.push_back(n);
+        normals[i] = glm::normalize(n / (float)(end - start));
     }
 }
 
@@ -460,20 +730,22 @@ void TriangleMesh::getFaceNeighbours(unsigned int tidx, std::vector<int> &n) {
 }
 
 void TriangleMesh::getFaceNeighbours(Triangle t, std::vector<int> &n) {
-    assert(vertices.size() == _vertexTriangles.size());
+    assert(_vertexTriangleOffsets.size() == vertices.size() + 1);
 
-    std::vector<int> vn;
     for (int i = 1; i < 3; i++) {
-        vn = _vertexTriangles[t.tri[i]];
-        n.insert(n.end(), vn.begin(), vn.end());
+        int vidx = t.tri[i];
+        n.insert(n.end(), 
+                 _vertexTriangleIndices.begin() + _vertexTriangleOffsets[vidx],
+                 _vertexTriangleIndices.begin() + _vertexTriangleOffsets[vidx + 1]);
     }
 }
 
 void TriangleMesh::getVertexNeighbours(unsigned int vidx, std::vector<int> &n) {
-    assert(vertices.size() == _vertexTriangles.size());
+    assert(_vertexTriangleOffsets.size() == vertices.size() + 1);
     assert(vidx < vertices.size());
-    std::vector<int> vn = _vertexTriangles[vidx];
-    n.insert(n.end(), vn.begin(), vn.end());
+    n.insert(n.end(), 
+             _vertexTriangleIndices.begin() + _vertexTriangleOffsets[vidx],
+             _vertexTriangleIndices.begin() + _vertexTriangleOffsets[vidx + 1]);
 }
 
 double TriangleMesh::getTriangleArea(int tidx) {
@@ -510,22 +782,131 @@ bool TriangleMesh::isNeighbours(Triangle t1, Triangle t2) {
 }
 
 void TriangleMesh::_updateVertexTriangles() {
-    _vertexTriangles.clear();
-    _vertexTriangles.reserve(vertices.size());
+    _updateVertexAdjacency();
+}
 
-    for (unsigned int i = 0; i < vertices.size(); i++) {
-        std::vector<int> triangles;
-        triangles.reserve(14);  // 14 is the maximum number of adjacent triangles
-                                // to a vertex
-        _vertexTriangles.push_back(triangles);
-    }
+/*
+    Builds both CSR tables. Triangles are listed per vertex in increasing
+    index order. Vertex neighbours are gathered from the incident triangles
+    in two passes over vertex ranges: one to count the unique neighbours
+    of each vertex and one to write them out at their final offsets.
+*/
+void TriangleMesh::_updateVertexAdjacency() {
+    int nv = (int)vertices.size();
+    _vertexTriangleOffsets.assign(nv + 1, 0);
+    _vertexTriangleIndices.resize(3*triangles.size());
 
     Triangle t;
     for (unsigned int i = 0; i < triangles.size(); i++) {
         t = triangles[i];
-        _vertexTriangles[t.tri[0]].push_back(i);
-        _vertexTriangles[t.tri[1]].push_back(i);
-        _vertexTriangles[t.tri[2]].push_back(i);
+        _vertexTriangleOffsets[t.tri[0] + 1]++;
+        _vertexTriangleOffsets[t.tri[1] + 1]++;
+        _vertexTriangleOffsets[t.tri[2] + 1]++;
+    }
+    for (int i = 0; i < nv; i++) {
+        _vertexTriangleOffsets[i + 1] += _vertexTriangleOffsets[i];
+    }
+
+    std::vector<int> cursor(_vertexTriangleOffsets.begin(), 
+                            _vertexTriangleOffsets.end() - 1);
+    for (unsigned int i = 0; i < triangles.size(); i++) {
+        t = triangles[i];
+        _vertexTriangleIndices[cursor[t.tri[0]]++] = i;
+        _vertexTriangleIndices[cursor[t.tri[1]]++] = i;
+        _vertexTriangleIndices[cursor[t.tri[2]]++] = i;
+    }
+
+    _vertexNeighbourOffsets.assign(nv + 1, 0);
+
+    std::vector<int> startIndices, endIndices;
+    std::vector<std::thread> threads(_numAdjacencyThreads);
+    _getThreadIndexRanges(nv, _numAdjacencyThreads, startIndices, endIndices);
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i] = std::thread(&TriangleMesh::_countVertexNeighbours, this,
+                                 startIndices[i], endIndices[i]);
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < nv; i++) {
+        _vertexNeighbourOffsets[i + 1] += _vertexNeighbourOffsets[i];
+    }
+    _vertexNeighbourIndices.resize(_vertexNeighbourOffsets[nv]);
+
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i] = std::thread(&TriangleMesh::_fillVertexNeighbours, this,
+                                 startIndices[i], endIndices[i]);
+    }
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+void TriangleMesh::_clearVertexAdjacency() {
+    _vertexTriangleOffsets.clear();
+    _vertexTriangleIndices.clear();
+    _vertexNeighbourOffsets.clear();
+    _vertexNeighbourIndices.clear();
+    _vertexTriangleOffsets.shrink_to_fit();
+    _vertexTriangleIndices.shrink_to_fit();
+    _vertexNeighbourOffsets.shrink_to_fit();
+    _vertexNeighbourIndices.shrink_to_fit();
+}
+
+void TriangleMesh::_getThreadIndexRanges(int n, int numThreads,
+                                         std::vector<int> &startIndices,
+                                         std::vector<int> &endIndices) {
+    startIndices.clear();
+    endIndices.clear();
+
+    int chunksize = (int)floor((double)n / (double)numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        startIndices.push_back(i*chunksize);
+        endIndices.push_back(i*chunksize + chunksize - 1);
+    }
+    endIndices[numThreads - 1] = n - 1;
+}
+
+void TriangleMesh::_countVertexNeighbours(int startidx, int endidx) {
+    std::vector<int> neighbours;
+    neighbours.reserve(16);
+
+    Triangle t;
+    for (int i = startidx; i <= endidx; i++) {
+        neighbours.clear();
+        for (int j = _vertexTriangleOffsets[i]; j < _vertexTriangleOffsets[i + 1]; j++) {
+            t = triangles[_vertexTriangleIndices[j]];
+            for (int idx = 0; idx < 3; idx++) {
+                if (t.tri[idx] != i && !_isIntInVector(t.tri[idx], neighbours)) {
+                    neighbours.push_back(t.tri[idx]);
+                }
+            }
+        }
+        _vertexNeighbourOffsets[i + 1] = (int)neighbours.size();
+    }
+}
+
+void TriangleMesh::_fillVertexNeighbours(int startidx, int endidx) {
+    std::vector<int> neighbours;
+    neighbours.reserve(16);
+
+    Triangle t;
+    for (int i = startidx; i <= endidx; i++) {
+        neighbours.clear();
+        for (int j = _vertexTriangleOffsets[i]; j < _vertexTriangleOffsets[i + 1]; j++) {
+            t = triangles[_vertexTriangleIndices[j]];
+            for (int idx = 0; idx < 3; idx++) {
+                if (t.tri[idx] != i && !_isIntInVector(t.tri[idx], neighbours)) {
+                    neighbours.push_back(t.tri[idx]);
+                }
+            }
+        }
+
+        int offset = _vertexNeighbourOffsets[i];
+        for (unsigned int j = 0; j < neighbours.size(); j++) {
+            _vertexNeighbourIndices[offset + j] = neighbours[j];
+        }
     }
 }
 
@@ -622,7 +1003,7 @@ void TriangleMesh::_floodfill(GridIndex g, Array3d<bool> &cells) {
     }
 }
 
-void TriangleMesh::getTrianglePosition(unsigned int index, glm::vec3 tri[3]) {
+void TriangleMesh::getTrianglePosition(unsigned int index, glm::vec3 tri[3]) const {
     assert(index < triangles.size());
 
     Triangle t = triangles[index];
@@ -677,7 +1058,7 @@ glm::vec3 TriangleMesh::getTriangleNormalSmooth(unsigned int index, glm::vec3 p)
     return bary.x*normals[t.tri[0]] + bary.y*normals[t.tri[1]] + bary.z*normals[t.tri[2]];
 }
 
-glm::vec3 TriangleMesh::getTriangleFaceDirection(unsigned int index) {
+glm::vec3 TriangleMesh::getTriangleFaceDirection(unsigned int index) const {
     assert(index < triangles.size());
 
     Triangle t = triangles[index];
@@ -687,7 +1068,7 @@ glm::vec3 TriangleMesh::getTriangleFaceDirection(unsigned int index) {
     return normals[t.tri[0]] + normals[t.tri[1]] + normals[t.tri[2]];
 }
 
-glm::vec3 TriangleMesh::getTriangleCenter(unsigned int index) {
+glm::vec3 TriangleMesh::getTriangleCenter(unsigned int index) const {
     assert(index < triangles.size());
 
     Triangle t = triangles[index];
@@ -722,7 +1103,7 @@ bool TriangleMesh::_isTriangleInVector(int index, std::vector<int> &tris) {
 
 int TriangleMesh::_getIntersectingTrianglesInCell(GridIndex g, glm::vec3 p, glm::vec3 dir,
                                                   std::vector<int> &tris, bool *success) {
-    if (_triGrid(g).size() == 0) {
+    if (_triGrid.get(g).size() == 0) {
         *success = true;
         return 0;
     }
@@ -776,7 +1157,7 @@ bool TriangleMesh::_isCellInsideMesh(const GridIndex g) {
     // even intersections: outside
     // odd intersections: inside
     assert(Grid3d::isGridIndexInRange(g, _gridi, _gridj, _gridk));
-    assert(_triGrid(g).size() == 0);
+    assert(_triGrid.get(g).size() == 0);
 
     // Add a random jitter to the center position of the cell.
     // If the line position is exactly in the center, intersections
@@ -890,42 +1271,84 @@ void TriangleMesh::getCellsInsideMesh(std::vector<GridIndex> &cells) {
     _destroyTriangleGrid();
 }
 
-void TriangleMesh::_smoothTriangleMesh(double value, std::vector<bool> &isSmooth) {
-    std::vector<glm::vec3> newvertices;
-    newvertices.reserve(vertices.size());
+/*
+    Jacobi sweeps over a structure of arrays copy of the vertex positions
+    laid out as [x0..xn, y0..yn, z0..zn]. Each sweep reads from one buffer
+    and writes the other so that vertex ranges can be smoothed in parallel.
+*/
+void TriangleMesh::_smoothTriangleMesh(double value, int iterations,
+                                       std::vector<bool> &isSmooth) {
+    int n = (int)vertices.size();
+    if (n == 0) {
+        return;
+    }
 
-    glm::vec3 v;
-    glm::vec3 nv;
-    glm::vec3 avg;
-    Triangle t;
-    for (unsigned int i = 0; i < vertices.size(); i++) {
+    std::vector<float> src(3*n);
+    std::vector<float> dst(3*n);
+    for (int i = 0; i < n; i++) {
+        src[i] = vertices[i].x;
+        src[n + i] = vertices[i].y;
+        src[2*n + i] = vertices[i].z;
+    }
 
-        if (!isSmooth[i]) {
-            newvertices.push_back(vertices[i]);
+    std::vector<int> startIndices, endIndices;
+    std::vector<std::thread> threads(_numAdjacencyThreads);
+    _getThreadIndexRanges(n, _numAdjacencyThreads, startIndices, endIndices);
+    for (int iter = 0; iter < iterations; iter++) {
+        for (unsigned int i = 0; i < threads.size(); i++) {
+            threads[i] = std::thread(&TriangleMesh::_smoothVertexRange, this,
+                                     startIndices[i], endIndices[i], value,
+                                     &isSmooth, &src, &dst);
+        }
+        for (unsigned int i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+        src.swap(dst);
+    }
+
+    for (int i = 0; i < n; i++) {
+        vertices[i] = glm::vec3(src[i], src[n + i], src[2*n + i]);
+    }
+}
+
+void TriangleMesh::_smoothVertexRange(int startidx, int endidx, double value,
+                                      std::vector<bool> *isSmooth,
+                                      std::vector<float> *src, 
+                                      std::vector<float> *dst) {
+    int n = (int)vertices.size();
+    const float *sx = &(src->front());
+    const float *sy = sx + n;
+    const float *sz = sy + n;
+    float *dx = &(dst->front());
+    float *dy = dx + n;
+    float *dz = dy + n;
+
+    float fval = (float)value;
+    for (int i = startidx; i <= endidx; i++) {
+        int start = _vertexNeighbourOffsets[i];
+        int end = _vertexNeighbourOffsets[i + 1];
+        if (!isSmooth->at(i) || start == end) {
+            dx[i] = sx[i];
+            dy[i] = sy[i];
+            dz[i] = sz[i];
             continue;
         }
 
-        avg = glm::vec3(0.0, 0.0, 0.0);
-        for (unsigned int j = 0; j < _vertexTriangles[i].size(); j++) {
-            t = triangles[_vertexTriangles[i][j]];
-            if (t.tri[0] != i) {
-                avg += vertices[t.tri[0]];
-            }
-            if (t.tri[1] != i) {
-                avg += vertices[t.tri[1]];
-            }
-            if (t.tri[2] != i) {
-                avg += vertices[t.tri[2]];
-            }
+        float ax = 0.0f;
+        float ay = 0.0f;
+        float az = 0.0f;
+        for (int j = start; j < end; j++) {
+            int nidx = _vertexNeighbourIndices[j];
+            ax += sx[nidx];
+            ay += sy[nidx];
+            az += sz[nidx];
         }
 
-        avg /= ((float)_vertexTriangles[i].size()*2.0);
-        v = vertices[i];
-        nv = v + (float)value * (avg - v);
-        newvertices.push_back(nv);
+        float inv = 1.0f / (float)(end - start);
+        dx[i] = sx[i] + fval*(ax*inv - sx[i]);
+        dy[i] = sy[i] + fval*(ay*inv - sy[i]);
+        dz[i] = sz[i] + fval*(az*inv - sz[i]);
     }
-
-    vertices = newvertices;
 }
 
 void TriangleMesh::_getBoolVectorOfSmoothedVertices(std::vector<int> &verts, 
@@ -955,14 +1378,9 @@ void TriangleMesh::smooth(double value, int iterations,
     std::vector<bool> isVertexSmooth;
     _getBoolVectorOfSmoothedVertices(verts, isVertexSmooth);
 
-    _vertexTriangles.clear();
-    _updateVertexTriangles();
-    for (int i = 0; i < iterations; i++) {
-        _smoothTriangleMesh(value, isVertexSmooth);
-    }
-    _vertexTriangles.clear();
-
-    updateVertexNormals();
+    _updateVertexAdjacency();
+    _smoothTriangleMesh(value, iterations, isVertexSmooth);
+    _updateVertexNormals();
 }
 
 void TriangleMesh::updateVertexTriangles() {
@@ -970,7 +1388,7 @@ void TriangleMesh::updateVertexTriangles() {
 }
 
 void TriangleMesh::clearVertexTriangles() {
-    _vertexTriangles.clear();
+    _clearVertexAdjacency();
 }
 
 void TriangleMesh::updateTriangleAreas() {
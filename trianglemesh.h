@@ -23,6 +23,10 @@ freely, subject to the following restrictions:
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <thread>
+#include <unordered_map>
+#include <memory>
+#include <utility>
 #include <assert.h>
 
 #include "triangle.h"
@@ -37,6 +41,10 @@ class TriangleMesh
 {
 public:
     TriangleMesh();
+    TriangleMesh(const TriangleMesh &other);
+    TriangleMesh(TriangleMesh &&other);
+    TriangleMesh &operator=(const TriangleMesh &other);
+    TriangleMesh &operator=(TriangleMesh &&other);
     ~TriangleMesh();
 
     bool loadOBJ(std::string OBJFilename) {
@@ -58,6 +66,8 @@ public:
     void writeMeshToSTL(std::string filename);
     void writeMeshToPLY(std::string filename);
     void removeDuplicateTriangles();
+    void weldVertices(double tolerance);
+    void weldVertices(double tolerance, std::vector<int> &remap);
     void updateVertexNormals();
     void updateVertexTriangles();
     void clearVertexTriangles();
@@ -71,11 +81,11 @@ public:
     void getVertexNeighbours(unsigned int vidx, std::vector<int> &n);
     bool isNeighbours(Triangle t1, Triangle t2);
     void getCellsInsideMesh(std::vector<GridIndex> &cells);
-    void getTrianglePosition(unsigned int index, glm::vec3 tri[3]);
+    void getTrianglePosition(unsigned int index, glm::vec3 tri[3]) const;
     glm::vec3 getTriangleNormal(unsigned int index);
     glm::vec3 getTriangleNormalSmooth(unsigned int index, glm::vec3 p);
-    glm::vec3 getTriangleFaceDirection(unsigned int index);
-    glm::vec3 getTriangleCenter(unsigned int index);
+    glm::vec3 getTriangleFaceDirection(unsigned int index) const;
+    glm::vec3 getTriangleCenter(unsigned int index) const;
     glm::vec3 getBarycentricCoordinates(unsigned int index, glm::vec3 p);
 
     void setGridDimensions(int i, int j, int k, double dx) {
@@ -88,7 +98,39 @@ public:
     std::vector<Triangle> triangles;
 
 private:
+    struct HashKey {
+        long long i, j, k;
+
+        HashKey() : i(0), j(0), k(0) {}
+        HashKey(long long ii, long long jj, long long kk) : i(ii), j(jj), k(kk) {}
+
+        bool operator==(const HashKey &other) const { 
+            return i == other.i && j == other.j && k == other.k;
+        }
+    };
+
+    struct HashKeyHasher {
+        std::size_t operator()(const HashKey &key) const {
+            std::size_t h = std::hash<long long>()(key.i);
+            h ^= std::hash<long long>()(key.j) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= std::hash<long long>()(key.k) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
     void _updateVertexTriangles();
+    void _updateVertexAdjacency();
+    void _updateVertexNormals();
+    void _clearVertexAdjacency();
+    void _getThreadIndexRanges(int n, int numThreads,
+                               std::vector<int> &startIndices,
+                               std::vector<int> &endIndices);
+    void _countVertexNeighbours(int startidx, int endidx);
+    void _fillVertexNeighbours(int startidx, int endidx);
+    void _calculateFaceNormals(int startidx, int endidx,
+                               std::vector<glm::vec3> *facenormals);
+    void _calculateVertexNormals(int startidx, int endidx,
+                                 std::vector<glm::vec3> *facenormals);
     bool _trianglesEqual(Triangle &t1, Triangle &t2);
     bool _isOnTriangleEdge(double u, double v);
     bool _isTriangleInVector(int index, std::vector<int> &tris);
@@ -101,7 +143,21 @@ private:
     void _destroyTriangleGrid();
     void _getTriangleGridCellOverlap(Triangle t, std::vector<GridIndex> &cells);
     void _getSurfaceCells(std::vector<GridIndex> &cells);
-    void _smoothTriangleMesh(double value, std::vector<bool> &isSmooth);
+    void _calculateVertexKeys(int startidx, int endidx, double invTolerance,
+                              std::vector<HashKey> *keys, std::vector<int> *partitions);
+    void _calculateTriangleKeys(int startidx, int endidx,
+                                std::vector<HashKey> *keys, std::vector<int> *partitions);
+    void _findFirstKeyOccurrences(int partition, std::vector<HashKey> *keys,
+                                  std::vector<int> *partitions,
+                                  std::vector<int> *firstIndices);
+    void _findFirstKeyOccurrencesParallel(std::vector<HashKey> &keys,
+                                          std::vector<int> &partitions,
+                                          std::vector<int> &firstIndices);
+    void _remapTriangles(int startidx, int endidx, std::vector<int> *remap);
+    void _smoothTriangleMesh(double value, int iterations, std::vector<bool> &isSmooth);
+    void _smoothVertexRange(int startidx, int endidx, double value,
+                            std::vector<bool> *isSmooth,
+                            std::vector<float> *src, std::vector<float> *dst);
     void _getBoolVectorOfSmoothedVertices(std::vector<int> &verts, 
                                           std::vector<bool> &isSmooth);
     int _numDigitsInInteger(int num);
@@ -115,9 +171,31 @@ private:
     int _gridk = 0;
     double _dx = 0;
 
-    std::vector<std::vector<int> > _vertexTriangles;
+    /*
+        Compressed sparse row adjacency. The triangles incident to vertex i
+        are _vertexTriangleIndices[_vertexTriangleOffsets[i]] up to
+        _vertexTriangleOffsets[i + 1], and likewise for the unique vertex
+        neighbours of vertex i in _vertexNeighbourIndices.
+    */
+    std::vector<int> _vertexTriangleOffsets;
+    std::vector<int> _vertexTriangleIndices;
+    std::vector<int> _vertexNeighbourOffsets;
+    std::vector<int> _vertexNeighbourIndices;
+    int _numAdjacencyThreads = 8;
     std::vector<double> _triangleAreas;
 
+    // Only exists during getCellsInsideMesh and is not copied
     Array3d<std::vector<int>> _triGrid;
 };
 
+/*
+    A mesh that is shared by several readers without being copied. Once a
+    mesh is wrapped in a snapshot it is not modified. A reader that needs
+    to change the mesh makes its own copy with TriangleMesh mesh = *snapshot.
+*/
+typedef std::shared_ptr<const TriangleMesh> TriangleMeshSnapshot;
+
+inline TriangleMeshSnapshot makeTriangleMeshSnapshot(TriangleMesh &&mesh) {
+    return std::make_shared<const TriangleMesh>(std::move(mesh));
+}
+